@@ -1,8 +1,52 @@
 @echo off
 if not exist bin mkdir bin
+if /i "%1"=="fuzz" goto fuzz
+if /i "%1"=="bench" goto bench
+if /i "%1"=="lexer" goto lexer
+if /i "%1"=="render" goto render
 g++ -std=c++20 -Wall -Wextra -I include -I src src/*.cpp src/modules/*.cpp -o bin/wshell.exe -static -lpsapi -liphlpapi -lws2_32
 if %errorlevel% equ 0 (
     echo Build successful: bin/wshell.exe
 ) else (
     echo Build failed
-)
\ No newline at end of file
+)
+goto :eof
+
+:fuzz
+rem Differential test of the scanner's SSE2/AVX2 paths against the scalar one.
+g++ -std=c++20 -O2 -Wall -Wextra -I include -I src tests/scanner_fuzz.cpp src/scanner.cpp -o bin/scanner_fuzz.exe
+if %errorlevel% neq 0 (
+    echo Build failed
+    exit /b 1
+)
+bin\scanner_fuzz.exe %2 %3
+goto :eof
+
+:bench
+rem Parser time and allocations per line against the pre-string_view parser.
+g++ -std=c++20 -O2 -Wall -Wextra -I include -I src tests/parser_bench.cpp src/parser.cpp src/scanner.cpp -o bin/parser_bench.exe
+if %errorlevel% neq 0 (
+    echo Build failed
+    exit /b 1
+)
+bin\parser_bench.exe %2
+goto :eof
+
+:lexer
+rem Incremental Parser::lex against a fresh parser over random edits.
+g++ -std=c++20 -O2 -Wall -Wextra -I include -I src tests/lexer_diff.cpp src/parser.cpp src/scanner.cpp -o bin/lexer_diff.exe
+if %errorlevel% neq 0 (
+    echo Build failed
+    exit /b 1
+)
+bin\lexer_diff.exe %2 %3
+goto :eof
+
+:render
+rem LineRenderer output played on a VT screen emulator.
+g++ -std=c++20 -O2 -Wall -Wextra -I include -I src tests/renderer_vt.cpp src/renderer.cpp src/linebuffer.cpp -o bin/renderer_vt.exe
+if %errorlevel% neq 0 (
+    echo Build failed
+    exit /b 1
+)
+bin\renderer_vt.exe %2 %3
@@ -0,0 +1,346 @@
+#include "bench.hpp"
+#include "renderer.hpp"
+#include <fstream>
+#include <cmath>
+
+namespace WaleedShell {
+
+// Benchmarked output goes to NUL unless the command redirects it itself.
+static void silence(CommandList& list) {
+    for (auto& item : list.items) {
+        if (item.group) {
+            silence(*item.group);
+        } else if (!item.pipeline.commands.empty()) {
+            Redirect& redirect = item.pipeline.commands.back().outputRedirect;
+            if (redirect.type == RedirectType::None) {
+                redirect.type = RedirectType::Output;
+                redirect.filename = "NUL";
+            }
+        }
+    }
+}
+
+static std::string formatDuration(double seconds) {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    if (seconds < 1e-3) {
+        ss << seconds * 1e6 << " us";
+    } else if (seconds < 1.0) {
+        ss << seconds * 1e3 << " ms";
+    } else {
+        ss << std::setprecision(3) << seconds << " s";
+    }
+    return ss.str();
+}
+
+static std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        switch (c) {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    escaped += buffer;
+                } else {
+                    escaped += c;
+                }
+        }
+    }
+    return escaped;
+}
+
+static double medianOf(std::vector<double> values) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    return (values.size() % 2) ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+}
+
+int Benchmark::run(const std::vector<std::string>& args, std::ostream& out) {
+    if (!args.empty() && args[0] == "--edits") {
+        size_t length = 80;
+        if (args.size() > 1) {
+            char* end = nullptr;
+            length = std::strtoul(args[1].c_str(), &end, 10);
+            if (*end != '\0' || length == 0) {
+                std::cerr << "bench: invalid length '" << args[1] << "'\n";
+                return 1;
+            }
+        }
+        return lineEdits(length, out);
+    }
+    
+    size_t runs = 10;
+    size_t warmup = 0;
+    std::string jsonPath, csvPath;
+    std::vector<std::string> commands;
+    
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        bool takesValue = arg == "-n" || arg == "-w" || arg == "--export-json" || arg == "--export-csv";
+        if (takesValue && i + 1 >= args.size()) {
+            std::cerr << "bench: " << arg << " needs a value\n";
+            return 1;
+        }
+        if (arg == "-n" || arg == "-w") {
+            char* end = nullptr;
+            unsigned long value = std::strtoul(args[i + 1].c_str(), &end, 10);
+            if (*end != '\0' || (arg == "-n" && value == 0)) {
+                std::cerr << "bench: invalid count '" << args[i + 1] << "'\n";
+                return 1;
+            }
+            (arg == "-n" ? runs : warmup) = value;
+            ++i;
+        } else if (arg == "--export-json") {
+            jsonPath = args[++i];
+        } else if (arg == "--export-csv") {
+            csvPath = args[++i];
+        } else {
+            commands.push_back(arg);
+        }
+    }
+    
+    if (commands.empty()) {
+        std::cerr << "Usage: bench [-n runs] [-w warmup] [--export-json file] [--export-csv file] \"<cmd>\" ...\n";
+        std::cerr << "       bench --edits [chars]\n";
+        return 1;
+    }
+    
+    std::vector<BenchResult> results;
+    for (const auto& command : commands) {
+        BenchResult result;
+        if (!measure(command, runs, warmup, result)) return 1;
+        summarize(result);
+        print(result, out);
+        results.push_back(std::move(result));
+    }
+    printComparison(results, out);
+    
+    int status = 0;
+    if (!jsonPath.empty() && !exportJson(jsonPath, results)) status = 1;
+    if (!csvPath.empty() && !exportCsv(csvPath, results)) status = 1;
+    return status;
+}
+
+bool Benchmark::measure(const std::string& commandLine, size_t runs, size_t warmup, BenchResult& result) {
+    CommandList list = m_parser.parseList(commandLine);
+    if (!list.isValid) {
+        std::cerr << "bench: " << (list.error.empty() ? "empty command" : list.error) << "\n";
+        return false;
+    }
+    silence(list);
+    result.command = commandLine;
+    
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    double tickSeconds = 1.0 / static_cast<double>(frequency.QuadPart);
+    
+    for (size_t i = 0; i < warmup; ++i) {
+        m_executor.execute(list);
+    }
+    
+    double overhead = 0;
+    for (size_t i = 0; i < runs; ++i) {
+        LARGE_INTEGER start, end;
+        LONGLONG stageBefore = m_executor.stageTicks();
+        QueryPerformanceCounter(&start);
+        int status = m_executor.execute(list);
+        QueryPerformanceCounter(&end);
+        LONGLONG stage = m_executor.stageTicks() - stageBefore;
+        
+        double wall = static_cast<double>(end.QuadPart - start.QuadPart) * tickSeconds;
+        double work = static_cast<double>(stage) * tickSeconds;
+        result.times.push_back(work);
+        result.exitCodes.push_back(status);
+        overhead += wall - work;
+    }
+    result.overhead = overhead / static_cast<double>(runs);
+    return true;
+}
+
+// `bench --edits`: what the line renderer writes for common edits on a line
+// of the given length, against redrawing the whole line. The renderer only
+// composes its output here; nothing reaches the console.
+int Benchmark::lineEdits(size_t length, std::ostream& out) {
+    static const std::string prefix = "> ";
+    static const size_t width = 120;
+    static const size_t edits = 64;
+    
+    std::string text;
+    for (size_t i = 0; i < length; ++i) {
+        text += (i % 8 == 7) ? ' ' : (char)('a' + i % 26);
+    }
+    std::string other(text.rbegin(), text.rend());
+    
+    LineRenderer renderer(INVALID_HANDLE_VALUE);
+    auto measure = [&](const char* name, const std::string& start, size_t cursor, size_t count,
+                       const std::function<void(GapBuffer&, size_t&, size_t)>& edit) {
+        GapBuffer line(start);
+        renderer.reset(prefix, width, true);
+        renderer.compose(prefix, line, cursor);
+        
+        uint64_t bytes = 0;
+        uint64_t redraw = 0;
+        for (size_t i = 0; i < count; ++i) {
+            edit(line, cursor, i);
+            bytes += renderer.compose(prefix, line, cursor).size();
+            redraw += 1 + prefix.size() + line.size();
+        }
+        out << "  " << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(10) << (double)bytes / (double)count
+            << std::setw(14) << (double)redraw / (double)count << "\n";
+    };
+    
+    out << "Line edits on a " << length << "-character line (" << width << " columns)\n";
+    out << "  Edit                Bytes/edit   Full redraw\n";
+    measure("type at end", "", 0, length, [&](GapBuffer& line, size_t& cursor, size_t i) {
+        line.insert(cursor++, text[i]);
+    });
+    measure("type in middle", text, length / 2, edits, [](GapBuffer& line, size_t& cursor, size_t) {
+        line.insert(cursor++, 'x');
+    });
+    measure("backspace in middle", text, length / 2, std::min(edits, length / 2), [](GapBuffer& line, size_t& cursor, size_t) {
+        line.erase(--cursor, 1);
+    });
+    measure("cursor left", text, length, std::min(edits, length), [](GapBuffer&, size_t& cursor, size_t) {
+        cursor--;
+    });
+    measure("home / end", text, length, edits, [&](GapBuffer&, size_t& cursor, size_t i) {
+        cursor = (i % 2 == 0) ? 0 : length;
+    });
+    measure("history recall", text, length, edits, [&](GapBuffer& line, size_t& cursor, size_t i) {
+        line.assign(i % 2 == 0 ? other : text);
+        cursor = length;
+    });
+    return 0;
+}
+
+// Outliers use the modified Z-score (median absolute deviation), which a
+// single slow run cannot drag along the way it drags the mean.
+void Benchmark::summarize(BenchResult& result) {
+    const auto& times = result.times;
+    double n = static_cast<double>(times.size());
+    
+    result.mean = 0;
+    for (double t : times) result.mean += t;
+    result.mean /= n;
+    
+    double variance = 0;
+    for (double t : times) variance += (t - result.mean) * (t - result.mean);
+    result.stddev = times.size() > 1 ? std::sqrt(variance / (n - 1)) : 0;
+    
+    result.median = medianOf(times);
+    result.min = *std::min_element(times.begin(), times.end());
+    result.max = *std::max_element(times.begin(), times.end());
+    
+    std::vector<double> deviations;
+    for (double t : times) deviations.push_back(std::fabs(t - result.median));
+    double mad = medianOf(deviations);
+    
+    result.outliers = 0;
+    if (mad > 0) {
+        for (double t : times) {
+            if (std::fabs(0.6745 * (t - result.median) / mad) > 3.5) ++result.outliers;
+        }
+    }
+}
+
+void Benchmark::print(const BenchResult& result, std::ostream& out) {
+    out << "Benchmark: " << result.command << "\n";
+    out << "  Time (mean +- sd):   " << formatDuration(result.mean) << " +- " << formatDuration(result.stddev) << "\n";
+    out << "  Median:              " << formatDuration(result.median) << "\n";
+    out << "  Range (min .. max):  " << formatDuration(result.min) << " .. " << formatDuration(result.max)
+        << "    " << result.times.size() << " runs\n";
+    out << "  Shell + spawn:       " << formatDuration(result.overhead) << " per run (subtracted)\n";
+    
+    size_t failures = std::count_if(result.exitCodes.begin(), result.exitCodes.end(),
+                                    [](int code) { return code != 0; });
+    if (failures > 0) {
+        out << "  Warning: " << failures << " run(s) exited with a non-zero status.\n";
+    }
+    if (result.outliers > 0) {
+        out << "  Warning: " << result.outliers << " statistical outlier(s) detected. "
+            << "Consider more warmup runs (-w) or a quieter system.\n";
+    }
+    out << "\n";
+}
+
+void Benchmark::printComparison(const std::vector<BenchResult>& results, std::ostream& out) {
+    if (results.size() < 2) return;
+    
+    auto fastest = std::min_element(results.begin(), results.end(),
+        [](const BenchResult& a, const BenchResult& b) { return a.mean < b.mean; });
+    if (fastest->mean <= 0) return;
+    
+    out << "Summary\n";
+    out << "  " << fastest->command << " ran\n";
+    for (const auto& result : results) {
+        if (&result == &*fastest) continue;
+        double ratio = result.mean / fastest->mean;
+        double error = ratio * std::sqrt(std::pow(result.stddev / result.mean, 2) +
+                                         std::pow(fastest->stddev / fastest->mean, 2));
+        out << std::fixed << std::setprecision(2)
+            << "    " << ratio << " +- " << error << " times faster than " << result.command << "\n";
+        out.unsetf(std::ios::floatfield);
+    }
+    out << "\n";
+}
+
+bool Benchmark::exportJson(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "bench: cannot write '" << path << "'\n";
+        return false;
+    }
+    
+    file << std::setprecision(9) << "{\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        file << "    {\n";
+        file << "      \"command\": \"" << jsonEscape(r.command) << "\",\n";
+        file << "      \"mean\": " << r.mean << ",\n";
+        file << "      \"stddev\": " << r.stddev << ",\n";
+        file << "      \"median\": " << r.median << ",\n";
+        file << "      \"min\": " << r.min << ",\n";
+        file << "      \"max\": " << r.max << ",\n";
+        file << "      \"overhead\": " << r.overhead << ",\n";
+        file << "      \"outliers\": " << r.outliers << ",\n";
+        file << "      \"times\": [";
+        for (size_t j = 0; j < r.times.size(); ++j) {
+            file << (j ? ", " : "") << r.times[j];
+        }
+        file << "],\n      \"exit_codes\": [";
+        for (size_t j = 0; j < r.exitCodes.size(); ++j) {
+            file << (j ? ", " : "") << r.exitCodes[j];
+        }
+        file << "]\n    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+    return static_cast<bool>(file);
+}
+
+bool Benchmark::exportCsv(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "bench: cannot write '" << path << "'\n";
+        return false;
+    }
+    
+    file << std::setprecision(9) << "command,mean,stddev,median,min,max,overhead\n";
+    for (const auto& r : results) {
+        std::string quoted = r.command;
+        for (size_t pos = 0; (pos = quoted.find('"', pos)) != std::string::npos; pos += 2) {
+            quoted.insert(pos, 1, '"');
+        }
+        file << "\"" << quoted << "\"," << r.mean << "," << r.stddev << "," << r.median << ","
+             << r.min << "," << r.max << "," << r.overhead << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "common.hpp"
+#include "parser.hpp"
+#include "executor.hpp"
+
+namespace WaleedShell {
+
+struct BenchResult {
+    std::string command;
+    std::vector<double> times;
+    std::vector<int> exitCodes;
+    double overhead = 0;
+    double mean = 0;
+    double stddev = 0;
+    double median = 0;
+    double min = 0;
+    double max = 0;
+    size_t outliers = 0;
+};
+
+// `bench`: runs each command line repeatedly through the executor with
+// its output sent to NUL and reports timing statistics. The executor's
+// stage ticks give the time spent in the commands themselves, counted
+// from the moment the first process exists; the rest of each run, which
+// is parsing, dispatch and spawning that process, is reported as
+// overhead and left out of the stats.
+class Benchmark {
+public:
+    explicit Benchmark(Executor& executor) : m_executor(executor) {}
+    int run(const std::vector<std::string>& args, std::ostream& out);
+
+private:
+    Executor& m_executor;
+    Parser m_parser;
+
+    bool measure(const std::string& commandLine, size_t runs, size_t warmup, BenchResult& result);
+    void summarize(BenchResult& result);
+    void print(const BenchResult& result, std::ostream& out);
+    void printComparison(const std::vector<BenchResult>& results, std::ostream& out);
+    int lineEdits(size_t length, std::ostream& out);
+    bool exportJson(const std::string& path, const std::vector<BenchResult>& results);
+    bool exportCsv(const std::string& path, const std::vector<BenchResult>& results);
+};
+
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include "common.hpp"
+#include <array>
+#include <string_view>
+
+namespace WaleedShell {
+
+// Every command the shell runs itself. Shell keeps one handler per value
+// before Cmd, in this order.
+enum class Builtin : uint8_t {
+    Exit, Help, Clear, Cd,
+    Ps, Kill, Start, Pinfo, Jobs, Wait,
+    Ls, Grep, Sort, Uniq, Head, Tail, Wc,
+    Cat, Touch, Rm, Mkdir, Rmdir, Cp, Mv, Find, Finfo,
+    Sysinfo, Meminfo, Diskinfo, Uptime,
+    Reg,
+    Netstat, Adapters, Ping, Resolve,
+    Services, Svc,
+    Pwd, History, Alias, Unalias, Which, Hash, Env, Export, Cache, Bench,
+    // A cmd.exe internal, run by CmdManager when it supports the arguments
+    // and by cmd.exe otherwise.
+    Cmd,
+    // A record operator. It only runs folded into the stage before it;
+    // see foldRecordStages().
+    RecordOp
+};
+
+// Reads or changes the shell's own state (directory, aliases, jobs,
+// history, environment), so it runs only on the shell thread and never
+// in a background job. Every other builtin runs live on a stage thread.
+constexpr uint8_t BUILTIN_SHELL_STATE = 1 << 0;
+// Also an internal command of cmd.exe.
+constexpr uint8_t BUILTIN_CMD = 1 << 1;
+// Can emit typed records for record operators to work on.
+constexpr uint8_t BUILTIN_RECORDS = 1 << 2;
+// Works on the records of the stage before it.
+constexpr uint8_t BUILTIN_RECORD_OP = 1 << 3;
+
+struct BuiltinName {
+    std::string_view name;
+    Builtin id;
+    uint8_t flags;
+};
+
+// The one list of builtin names, used for dispatch, by the executor, and
+// for completion and highlighting.
+constexpr BuiltinName BUILTIN_NAMES[] = {
+    {"exit", Builtin::Exit, BUILTIN_SHELL_STATE}, {"quit", Builtin::Exit, BUILTIN_SHELL_STATE},
+    {"help", Builtin::Help, 0}, {"clear", Builtin::Clear, BUILTIN_SHELL_STATE},
+    {"cls", Builtin::Clear, BUILTIN_SHELL_STATE}, {"cd", Builtin::Cd, BUILTIN_SHELL_STATE},
+    {"ps", Builtin::Ps, BUILTIN_RECORDS}, {"kill", Builtin::Kill, 0}, {"start", Builtin::Start, 0},
+    {"pinfo", Builtin::Pinfo, 0}, {"jobs", Builtin::Jobs, BUILTIN_SHELL_STATE},
+    {"wait", Builtin::Wait, BUILTIN_SHELL_STATE}, {"fg", Builtin::Wait, BUILTIN_SHELL_STATE},
+    {"ls", Builtin::Ls, BUILTIN_RECORDS}, {"grep", Builtin::Grep, 0}, {"sort", Builtin::Sort, 0},
+    {"uniq", Builtin::Uniq, 0}, {"head", Builtin::Head, 0}, {"tail", Builtin::Tail, 0}, {"wc", Builtin::Wc, 0},
+    {"cat", Builtin::Cat, 0}, {"touch", Builtin::Touch, 0}, {"rm", Builtin::Rm, 0},
+    {"mkdir", Builtin::Mkdir, BUILTIN_CMD}, {"rmdir", Builtin::Rmdir, BUILTIN_CMD}, {"cp", Builtin::Cp, 0},
+    {"mv", Builtin::Mv, 0}, {"find", Builtin::Find, 0}, {"finfo", Builtin::Finfo, 0},
+    {"sysinfo", Builtin::Sysinfo, 0}, {"meminfo", Builtin::Meminfo, 0}, {"diskinfo", Builtin::Diskinfo, 0},
+    {"uptime", Builtin::Uptime, 0}, {"reg", Builtin::Reg, 0}, {"netstat", Builtin::Netstat, BUILTIN_RECORDS},
+    {"adapters", Builtin::Adapters, BUILTIN_RECORDS}, {"ping", Builtin::Ping, 0},
+    {"resolve", Builtin::Resolve, 0}, {"services", Builtin::Services, BUILTIN_RECORDS},
+    {"svc", Builtin::Svc, 0}, {"pwd", Builtin::Pwd, BUILTIN_SHELL_STATE},
+    {"history", Builtin::History, BUILTIN_SHELL_STATE}, {"alias", Builtin::Alias, BUILTIN_SHELL_STATE},
+    {"unalias", Builtin::Unalias, BUILTIN_SHELL_STATE}, {"which", Builtin::Which, 0},
+    {"hash", Builtin::Hash, 0}, {"env", Builtin::Env, 0}, {"export", Builtin::Export, BUILTIN_SHELL_STATE},
+    {"cache", Builtin::Cache, BUILTIN_SHELL_STATE}, {"bench", Builtin::Bench, BUILTIN_SHELL_STATE},
+    {"dir", Builtin::Cmd, BUILTIN_CMD}, {"echo", Builtin::Cmd, BUILTIN_CMD},
+    {"type", Builtin::Cmd, BUILTIN_CMD}, {"copy", Builtin::Cmd, BUILTIN_CMD},
+    {"move", Builtin::Cmd, BUILTIN_CMD}, {"del", Builtin::Cmd, BUILTIN_CMD}, {"ren", Builtin::Cmd, BUILTIN_CMD},
+    {"md", Builtin::Cmd, BUILTIN_CMD}, {"rd", Builtin::Cmd, BUILTIN_CMD},
+    {"set", Builtin::Cmd, BUILTIN_CMD | BUILTIN_SHELL_STATE}, {"ver", Builtin::Cmd, BUILTIN_CMD},
+    {"vol", Builtin::Cmd, BUILTIN_CMD}, {"date", Builtin::Cmd, BUILTIN_CMD},
+    {"time", Builtin::Cmd, BUILTIN_CMD}, {"path", Builtin::Cmd, BUILTIN_CMD | BUILTIN_SHELL_STATE},
+    {"title", Builtin::Cmd, BUILTIN_CMD | BUILTIN_SHELL_STATE}, {"erase", Builtin::Cmd, BUILTIN_CMD},
+    {"rename", Builtin::Cmd, BUILTIN_CMD}, {"where", Builtin::RecordOp, BUILTIN_RECORD_OP},
+    {"sort-by", Builtin::RecordOp, BUILTIN_RECORD_OP}, {"select", Builtin::RecordOp, BUILTIN_RECORD_OP},
+    {"group-by", Builtin::RecordOp, BUILTIN_RECORD_OP}, {"first", Builtin::RecordOp, BUILTIN_RECORD_OP}
+};
+
+// Names are found through a perfect hash: a seeded FNV-1a whose top bits
+// index a slot table, with the seed searched for at compile time so that
+// no two names share a slot. A lookup is one hash, one probe and one
+// compare, with no allocation.
+constexpr unsigned BUILTIN_HASH_BITS = 9;
+constexpr size_t BUILTIN_SLOTS = size_t(1) << BUILTIN_HASH_BITS;
+constexpr uint8_t BUILTIN_NO_SLOT = 0xFF;
+static_assert(std::size(BUILTIN_NAMES) < BUILTIN_NO_SLOT, "slot table holds 8-bit indices");
+
+constexpr size_t builtinSlot(std::string_view name, uint32_t seed) {
+    uint32_t hash = seed;
+    for (char c : name) {
+        hash ^= (uint8_t)c;
+        hash *= 16777619u;
+    }
+    return hash >> (32 - BUILTIN_HASH_BITS);
+}
+
+constexpr uint32_t findBuiltinSeed() {
+    for (uint32_t seed = 2166136261u; seed != 2166136261u + 100000; ++seed) {
+        bool used[BUILTIN_SLOTS] = {};
+        bool unique = true;
+        for (const BuiltinName& builtin : BUILTIN_NAMES) {
+            size_t slot = builtinSlot(builtin.name, seed);
+            unique = unique && !used[slot];
+            used[slot] = true;
+        }
+        if (unique) return seed;
+    }
+    return 0;
+}
+
+constexpr uint32_t BUILTIN_SEED = findBuiltinSeed();
+static_assert(BUILTIN_SEED != 0, "no collision-free seed for the builtin names");
+
+constexpr std::array<uint8_t, BUILTIN_SLOTS> makeBuiltinSlots() {
+    std::array<uint8_t, BUILTIN_SLOTS> slots{};
+    for (uint8_t& slot : slots) {
+        slot = BUILTIN_NO_SLOT;
+    }
+    for (size_t i = 0; i < std::size(BUILTIN_NAMES); ++i) {
+        slots[builtinSlot(BUILTIN_NAMES[i].name, BUILTIN_SEED)] = (uint8_t)i;
+    }
+    return slots;
+}
+
+constexpr std::array<uint8_t, BUILTIN_SLOTS> BUILTIN_SLOT_TABLE = makeBuiltinSlots();
+
+// The entry for `name`, matched exactly, or nullptr.
+constexpr const BuiltinName* findBuiltin(std::string_view name) {
+    uint8_t index = BUILTIN_SLOT_TABLE[builtinSlot(name, BUILTIN_SEED)];
+    if (index == BUILTIN_NO_SLOT || BUILTIN_NAMES[index].name != name) return nullptr;
+    return &BUILTIN_NAMES[index];
+}
+
+static_assert(findBuiltin("grep") && findBuiltin("grep")->id == Builtin::Grep, "registry lookup");
+static_assert(!findBuiltin("gre") && !findBuiltin("Grep"), "registry lookup");
+
+}
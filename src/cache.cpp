@@ -0,0 +1,71 @@
+#include "cache.hpp"
+
+namespace WaleedShell {
+
+uint64_t PipelineCache::makeKey(const std::string& line, uint64_t aliasVersion) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : line) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    hash ^= aliasVersion + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+std::shared_ptr<CommandList> PipelineCache::find(const std::string& line, uint64_t aliasVersion) {
+    auto it = m_index.find(makeKey(line, aliasVersion));
+    if (it == m_index.end() ||
+        it->second->aliasVersion != aliasVersion ||
+        it->second->line != line) {
+        m_misses++;
+        return nullptr;
+    }
+    m_hits++;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->list;
+}
+
+void PipelineCache::insert(const std::string& line, uint64_t aliasVersion, std::shared_ptr<CommandList> list) {
+    if (m_capacity == 0) return;
+
+    uint64_t key = makeKey(line, aliasVersion);
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        m_entries.erase(it->second);
+        m_index.erase(it);
+    }
+
+    if (m_entries.size() >= m_capacity) {
+        m_index.erase(m_entries.back().key);
+        m_entries.pop_back();
+    }
+
+    m_entries.push_front({key, aliasVersion, line, std::move(list)});
+    m_index[key] = m_entries.begin();
+}
+
+void PipelineCache::forgetResolvedPaths(CommandList& list) {
+    for (auto& item : list.items) {
+        if (item.group) {
+            forgetResolvedPaths(*item.group);
+        }
+        for (auto& cmd : item.pipeline.commands) {
+            cmd.resolvedPath.clear();
+        }
+    }
+}
+
+void PipelineCache::forgetResolvedPaths() {
+    for (auto& entry : m_entries) {
+        forgetResolvedPaths(*entry.list);
+    }
+}
+
+void PipelineCache::clear() {
+    m_entries.clear();
+    m_index.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "common.hpp"
+#include "parser.hpp"
+#include <list>
+
+namespace WaleedShell {
+
+// LRU cache of parsed command lists keyed by the line as typed and the
+// alias table version it was expanded against. Entries are shared with
+// the executor, which records resolved executable paths in them.
+class PipelineCache {
+public:
+    explicit PipelineCache(size_t capacity = 128) : m_capacity(capacity) {}
+
+    std::shared_ptr<CommandList> find(const std::string& line, uint64_t aliasVersion);
+    void insert(const std::string& line, uint64_t aliasVersion, std::shared_ptr<CommandList> list);
+    void forgetResolvedPaths();
+    void clear();
+
+    size_t size() const { return m_entries.size(); }
+    size_t capacity() const { return m_capacity; }
+    uint64_t hits() const { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+
+private:
+    struct Entry {
+        uint64_t key;
+        uint64_t aliasVersion;
+        std::string line;
+        std::shared_ptr<CommandList> list;
+    };
+
+    size_t m_capacity;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    std::list<Entry> m_entries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> m_index;
+
+    static void forgetResolvedPaths(CommandList& list);
+    static uint64_t makeKey(const std::string& line, uint64_t aliasVersion);
+};
+
+}
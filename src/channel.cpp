@@ -0,0 +1,100 @@
+#include "channel.hpp"
+
+namespace WaleedShell {
+
+Channel::Channel(size_t capacity)
+    : m_ring(capacity), m_head(0), m_size(0), m_writerClosed(false), m_readerClosed(false) {}
+
+bool Channel::write(const char* data, size_t size) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    while (size > 0) {
+        m_writable.wait(lock, [this] { return m_readerClosed || m_size < m_ring.size(); });
+        if (m_readerClosed) return false;
+        
+        size_t tail = (m_head + m_size) % m_ring.size();
+        size_t chunk = std::min(size, m_ring.size() - m_size);
+        chunk = std::min(chunk, m_ring.size() - tail);
+        std::memcpy(m_ring.data() + tail, data, chunk);
+        m_size += chunk;
+        data += chunk;
+        size -= chunk;
+        m_readable.notify_one();
+    }
+    return true;
+}
+
+size_t Channel::read(char* data, size_t size) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_readable.wait(lock, [this] { return m_writerClosed || m_size > 0; });
+    
+    size_t chunk = std::min(size, m_size);
+    chunk = std::min(chunk, m_ring.size() - m_head);
+    std::memcpy(data, m_ring.data() + m_head, chunk);
+    m_head = (m_head + chunk) % m_ring.size();
+    m_size -= chunk;
+    if (chunk > 0) m_writable.notify_one();
+    return chunk;
+}
+
+void Channel::closeWriter() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_writerClosed = true;
+    m_readable.notify_all();
+}
+
+void Channel::closeReader() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_readerClosed = true;
+    m_writable.notify_all();
+}
+
+ChannelWriteBuf::ChannelWriteBuf(Channel& channel, size_t bufferSize)
+    : m_channel(channel), m_buffer(bufferSize) {
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+}
+
+ChannelWriteBuf::~ChannelWriteBuf() {
+    flushBuffer();
+    m_channel.closeWriter();
+}
+
+bool ChannelWriteBuf::flushBuffer() {
+    size_t pending = static_cast<size_t>(pptr() - pbase());
+    bool ok = pending == 0 || m_channel.write(pbase(), pending);
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    return ok;
+}
+
+ChannelWriteBuf::int_type ChannelWriteBuf::overflow(int_type ch) {
+    if (!flushBuffer()) return traits_type::eof();
+    if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+    
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+int ChannelWriteBuf::sync() {
+    return flushBuffer() ? 0 : -1;
+}
+
+ChannelReadBuf::ChannelReadBuf(Channel& channel, size_t bufferSize)
+    : m_channel(channel), m_buffer(bufferSize) {
+    setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+}
+
+ChannelReadBuf::~ChannelReadBuf() {
+    m_channel.closeReader();
+}
+
+ChannelReadBuf::int_type ChannelReadBuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    
+    size_t count = m_channel.read(m_buffer.data(), m_buffer.size());
+    if (count == 0) return traits_type::eof();
+    setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + count);
+    return traits_type::to_int_type(*gptr());
+}
+
+}
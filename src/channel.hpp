@@ -0,0 +1,69 @@
+#pragma once
+#include "common.hpp"
+#include <mutex>
+#include <condition_variable>
+
+namespace WaleedShell {
+
+// Bounded in-memory pipe between two builtin stages running on separate
+// threads of the shell. The writer blocks while the ring is full and the
+// reader while it is empty. Once the reader closes its end every write
+// fails, which is how `head` stops the stages in front of it.
+class Channel {
+public:
+    explicit Channel(size_t capacity = 256 * 1024);
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+
+    bool write(const char* data, size_t size);
+    size_t read(char* data, size_t size);
+    void closeWriter();
+    void closeReader();
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_readable;
+    std::condition_variable m_writable;
+    std::vector<char> m_ring;
+    size_t m_head;
+    size_t m_size;
+    bool m_writerClosed;
+    bool m_readerClosed;
+};
+
+// Stream buffers over either end of a Channel. Each closes its end when
+// destroyed, so a stage finishing always releases its neighbours.
+class ChannelWriteBuf : public std::streambuf {
+public:
+    explicit ChannelWriteBuf(Channel& channel, size_t bufferSize = 16 * 1024);
+    ~ChannelWriteBuf() override;
+    ChannelWriteBuf(const ChannelWriteBuf&) = delete;
+    ChannelWriteBuf& operator=(const ChannelWriteBuf&) = delete;
+
+protected:
+    int_type overflow(int_type ch) override;
+    int sync() override;
+
+private:
+    Channel& m_channel;
+    std::vector<char> m_buffer;
+
+    bool flushBuffer();
+};
+
+class ChannelReadBuf : public std::streambuf {
+public:
+    explicit ChannelReadBuf(Channel& channel, size_t bufferSize = 16 * 1024);
+    ~ChannelReadBuf() override;
+    ChannelReadBuf(const ChannelReadBuf&) = delete;
+    ChannelReadBuf& operator=(const ChannelReadBuf&) = delete;
+
+protected:
+    int_type underflow() override;
+
+private:
+    Channel& m_channel;
+    std::vector<char> m_buffer;
+};
+
+}
@@ -0,0 +1,156 @@
+#include "completer.hpp"
+#include "builtins.hpp"
+#include <unordered_set>
+
+namespace WaleedShell {
+
+namespace {
+
+// A batch goes out when it holds this many names or has waited this long.
+constexpr size_t kBatchSize = 64;
+constexpr ULONGLONG kBatchIntervalMs = 20;
+
+}
+
+CompletionWorker::CompletionWorker()
+    : m_hasRequest(false), m_stopping(false), m_current(0), m_resultsId(0), m_done(true),
+      m_executables(nullptr) {
+    m_ready = CreateEventA(NULL, FALSE, FALSE, NULL);
+    m_thread = std::thread(&CompletionWorker::workLoop, this);
+}
+
+CompletionWorker::~CompletionWorker() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_current++;
+    }
+    m_wakeup.notify_all();
+    m_thread.join();
+    CloseHandle(m_ready);
+}
+
+uint64_t CompletionWorker::start(const std::string& partial, bool commandPosition) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t id = ++m_current;
+    m_request = {id, partial, commandPosition};
+    m_hasRequest = true;
+    m_resultsId = id;
+    m_results.clear();
+    m_done = false;
+    ResetEvent(m_ready);
+    m_wakeup.notify_all();
+    return id;
+}
+
+void CompletionWorker::cancel() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_current++;
+    m_hasRequest = false;
+}
+
+bool CompletionWorker::poll(uint64_t id, size_t from, std::vector<std::string>& items) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (id != m_resultsId) return true;
+    for (size_t i = from; i < m_results.size(); ++i) {
+        items.push_back(m_results[i]);
+    }
+    return m_done;
+}
+
+bool CompletionWorker::publish(uint64_t id, std::vector<std::string>& batch, bool done) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (id != m_current.load() || id != m_resultsId) return false;
+        m_results.insert(m_results.end(), std::make_move_iterator(batch.begin()),
+                         std::make_move_iterator(batch.end()));
+        m_done = done;
+    }
+    batch.clear();
+    SetEvent(m_ready);
+    return true;
+}
+
+void CompletionWorker::workLoop() {
+    while (true) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeup.wait(lock, [this] { return m_stopping || m_hasRequest; });
+            if (m_stopping) return;
+            request = m_request;
+            m_hasRequest = false;
+        }
+        run(request);
+    }
+}
+
+void CompletionWorker::run(const Request& request) {
+    std::vector<std::string> batch;
+    std::unordered_set<std::string> seen;
+    ULONGLONG lastPublish = GetTickCount64();
+
+    auto add = [&](std::string completion) {
+        if (!seen.insert(completion).second) return true;
+        batch.push_back(std::move(completion));
+        ULONGLONG now = GetTickCount64();
+        if (batch.size() >= kBatchSize || now - lastPublish >= kBatchIntervalMs) {
+            lastPublish = now;
+            return publish(request.id, batch, false);
+        }
+        return true;
+    };
+
+    // Directory entries are not filtered here: the word's last component
+    // is a fuzzy query that the input loop narrows as the user types, so
+    // every name in the directory is a candidate.
+    const std::string& partial = request.partial;
+    std::string prefix;
+
+    size_t lastSlash = partial.find_last_of("\\/");
+    if (lastSlash != std::string::npos) {
+        prefix = partial.substr(0, lastSlash + 1);
+    }
+
+    std::string searchDir = prefix.empty() ? "." : prefix;
+    std::string pattern = searchDir + "\\*";
+
+    WIN32_FIND_DATAA fd;
+    HANDLE hFind = FindFirstFileA(pattern.c_str(), &fd);
+
+    if (hFind != INVALID_HANDLE_VALUE) {
+        do {
+            if (cancelled(request.id)) break;
+            std::string name = fd.cFileName;
+            if (name == "." || name == "..") continue;
+
+            std::string completion = prefix + name;
+            if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                completion += "\\";
+            }
+            if (!add(std::move(completion))) break;
+        } while (FindNextFileA(hFind, &fd));
+        FindClose(hFind);
+    }
+
+    if (request.commandPosition && prefix.empty() && !cancelled(request.id)) {
+        if (m_executables) {
+            // Most words are typed as a plain prefix, which the trie answers
+            // without a walk over all of PATH; only a word that starts no
+            // command name leaves the fuzzy matcher the full list.
+            std::vector<std::string> names = m_executables->complete(partial);
+            if (names.empty()) names = m_executables->complete("");
+            for (auto& name : names) {
+                if (!add(std::move(name))) break;
+            }
+        }
+
+        for (const BuiltinName& builtin : BUILTIN_NAMES) {
+            if (!add(std::string(builtin.name))) break;
+        }
+    }
+
+    publish(request.id, batch, true);
+}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "common.hpp"
+#include "pathindex.hpp"
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+namespace WaleedShell {
+
+// Enumerates Tab completions on a background thread so a slow share or a
+// huge directory never stalls the keystroke loop. There is at most one
+// live request: starting another or calling cancel() retires it, and the
+// enumeration notices between directory entries. Results are published
+// in batches as they are found and the ready event is signalled after
+// each batch and once more when the request finishes, so the input loop
+// can wait on it alongside the console handle.
+class CompletionWorker {
+public:
+    CompletionWorker();
+    ~CompletionWorker();
+    CompletionWorker(const CompletionWorker&) = delete;
+    CompletionWorker& operator=(const CompletionWorker&) = delete;
+
+    void setExecutableIndex(ExecutableIndex* index) { m_executables = index; }
+    HANDLE readyEvent() const { return m_ready; }
+
+    // Every name in the word's directory is returned unfiltered; executables
+    // and builtin names are added in command position when the word has no
+    // directory part.
+    uint64_t start(const std::string& partial, bool commandPosition);
+    void cancel();
+    // Appends the results of request `id` past the first `from` to `items`
+    // and reports whether the request has finished.
+    bool poll(uint64_t id, size_t from, std::vector<std::string>& items);
+
+private:
+    struct Request {
+        uint64_t id = 0;
+        std::string partial;
+        bool commandPosition = false;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    Request m_request;
+    bool m_hasRequest;
+    bool m_stopping;
+    std::atomic<uint64_t> m_current;
+
+    uint64_t m_resultsId;
+    std::vector<std::string> m_results;
+    bool m_done;
+
+    HANDLE m_ready;
+    ExecutableIndex* m_executables;
+    std::thread m_thread;
+
+    void workLoop();
+    void run(const Request& request);
+    bool publish(uint64_t id, std::vector<std::string>& batch, bool done);
+    bool cancelled(uint64_t id) const { return m_current.load() != id; }
+};
+
+}
@@ -1,55 +1,113 @@
 #include "executor.hpp"
 #include "shell.hpp"
+#include "builtins.hpp"
+#include "records.hpp"
+#include "handlestream.hpp"
+#include "channel.hpp"
+#include "sink.hpp"
+#include <psapi.h>
 
 namespace WaleedShell {
 
+static LONGLONG now() {
+    LARGE_INTEGER ticks;
+    QueryPerformanceCounter(&ticks);
+    return ticks.QuadPart;
+}
+
+static LONGLONG fileTimeValue(const FILETIME& ft) {
+    ULARGE_INTEGER value;
+    value.LowPart = ft.dwLowDateTime;
+    value.HighPart = ft.dwHighDateTime;
+    return static_cast<LONGLONG>(value.QuadPart);
+}
+
+// When `process` came to exist, in performance-counter ticks. Its creation
+// time, read through the handle, is moved onto the counter by comparing
+// it with the system time now. Creation times can be as coarse as the
+// clock tick, so the result is kept within the CreateProcess call
+// (`callStart` to now) that made the process.
+static LONGLONG processStartTicks(HANDLE process, LONGLONG callStart) {
+    LONGLONG callEnd = now();
+    FILETIME created, exited, kernel, user, current;
+    if (!GetProcessTimes(process, &created, &exited, &kernel, &user)) return callEnd;
+    GetSystemTimePreciseAsFileTime(&current);
+    
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    LONGLONG age = fileTimeValue(current) - fileTimeValue(created);
+    LONGLONG start = callEnd - static_cast<LONGLONG>(static_cast<double>(age) * static_cast<double>(frequency.QuadPart) / 1e7);
+    return std::clamp(start, callStart, callEnd);
+}
+
+// cmd.exe matches its internals case-insensitively. No builtin name is
+// longer than the buffer, so longer programs are not looked up at all.
 bool Executor::isCmdBuiltin(const std::string& program) {
-    static std::vector<std::string> cmdBuiltins = {
-        "dir", "echo", "type", "copy", "move", "del", "ren", "mkdir", "rmdir",
-        "md", "rd", "set", "ver", "vol", "date", "time", "path", "title"
-    };
-    std::string lower = program;
-    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-    return std::find(cmdBuiltins.begin(), cmdBuiltins.end(), lower) != cmdBuiltins.end();
+    char lower[16];
+    if (program.size() > sizeof(lower)) return false;
+    for (size_t i = 0; i < program.size(); ++i) {
+        lower[i] = (char)tolower((unsigned char)program[i]);
+    }
+    const BuiltinName* builtin = findBuiltin(std::string_view(lower, program.size()));
+    return builtin && (builtin->flags & BUILTIN_CMD);
 }
 
+static bool namesPath(const std::string& program) {
+    return program.find('\\') != std::string::npos || 
+           program.find('/') != std::string::npos ||
+           program.find(':') != std::string::npos;
+}
+
+// Expects the index to have been refreshed by the caller.
 std::string Executor::findExecutable(const std::string& program) {
-    if (program.find('\\') != std::string::npos || 
-        program.find('/') != std::string::npos ||
-        program.find(':') != std::string::npos) {
+    if (namesPath(program)) {
         return program;
     }
     
-    std::vector<std::string> extensions = {"", ".exe", ".cmd", ".bat", ".com"};
-    
-    char pathEnv[32767];
-    GetEnvironmentVariableA("PATH", pathEnv, 32767);
+    std::string local = ExecutableIndex::findLocal(program);
+    if (!local.empty()) return local;
     
-    std::vector<std::string> paths;
-    paths.push_back(".");
+    std::string path = m_executables ? m_executables->lookup(program) : "";
+    return path.empty() ? program : path;
+}
+
+// The index is refreshed once per command. A resolution cached on the
+// command stays good for PATH while the generation holds, but the current
+// directory comes first and is not watched, so a plain name is probed
+// there again on every launch.
+void Executor::resolveExecutable(Command& cmd) {
+    if (isCmdBuiltin(cmd.program)) return;
     
-    std::stringstream ss(pathEnv);
-    std::string path;
-    while (std::getline(ss, path, ';')) {
-        if (!path.empty()) {
-            paths.push_back(path);
-        }
+    uint64_t generation = 0;
+    if (m_executables) {
+        m_executables->refresh();
+        generation = m_executables->generation();
     }
-    
-    for (const auto& dir : paths) {
-        for (const auto& ext : extensions) {
-            std::string fullPath = dir + "\\" + program + ext;
-            if (GetFileAttributesA(fullPath.c_str()) != INVALID_FILE_ATTRIBUTES) {
-                return fullPath;
-            }
+    bool cached = !cmd.resolvedPath.empty() && cmd.resolvedGeneration == generation;
+    if (cached && !namesPath(cmd.program)) {
+        std::string local = ExecutableIndex::findLocal(cmd.program);
+        if (!local.empty()) {
+            cmd.resolvedPath = local;
+            return;
         }
+        // The local file it was resolved to is gone; fall back to PATH.
+        cached = cmd.resolvedPath.compare(0, 2, ".\\") != 0;
+    }
+    if (!cached) {
+        cmd.resolvedPath = findExecutable(cmd.program);
+        cmd.resolvedGeneration = generation;
     }
-    
-    return program;
 }
 
 std::string Executor::buildCommandLine(Command& cmd) {
     std::string cmdLine = cmd.program;
+    if (!cmd.resolvedPath.empty() && cmd.resolvedPath != cmd.program) {
+        if (cmd.resolvedPath.find(' ') != std::string::npos) {
+            cmdLine = "\"" + cmd.resolvedPath + "\"";
+        } else {
+            cmdLine = cmd.resolvedPath;
+        }
+    }
     
     for (const auto& arg : cmd.args) {
         cmdLine += " ";
@@ -63,251 +121,509 @@ std::string Executor::buildCommandLine(Command& cmd) {
     return cmdLine;
 }
 
-int Executor::executeSingle(Command& cmd) {
-    std::string cmdLine;
-    
-    if (isCmdBuiltin(cmd.program)) {
-        cmdLine = "cmd.exe /c " + buildCommandLine(cmd);
-    } else {
-        cmdLine = buildCommandLine(cmd);
-    }
-    
-    SECURITY_ATTRIBUTES sa;
-    sa.nLength = sizeof(SECURITY_ATTRIBUTES);
-    sa.bInheritHandle = TRUE;
-    sa.lpSecurityDescriptor = NULL;
-    
-    HANDLE hInputRead = NULL;
-    HANDLE hOutputWrite = NULL;
-    
-    if (cmd.inputRedirect.type == RedirectType::Input) {
-        hInputRead = CreateFileA(
-            cmd.inputRedirect.filename.c_str(),
-            GENERIC_READ,
-            FILE_SHARE_READ,
-            &sa,
-            OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL,
-            NULL
-        );
-        if (hInputRead == INVALID_HANDLE_VALUE) {
-            std::cerr << "Error: Cannot open input file '" << cmd.inputRedirect.filename << "'\n";
-            return 1;
+std::string Executor::describePipeline(Pipeline& pipeline) {
+    std::string text;
+    for (auto& cmd : pipeline.commands) {
+        if (!text.empty()) text += " | ";
+        text += cmd.program;
+        for (const auto& arg : cmd.args) {
+            text += " " + arg;
+        }
+        for (const auto& op : cmd.recordOps) {
+            text += " | " + op.program;
+            for (const auto& arg : op.args) {
+                text += " " + arg;
+            }
         }
     }
+    return text;
+}
+
+HANDLE Executor::openRedirect(const Redirect& redirect, SECURITY_ATTRIBUTES* sa) {
+    HANDLE hFile = INVALID_HANDLE_VALUE;
     
-    if (cmd.outputRedirect.type == RedirectType::Output) {
-        hOutputWrite = CreateFileA(
-            cmd.outputRedirect.filename.c_str(),
-            GENERIC_WRITE,
-            0,
-            &sa,
-            CREATE_ALWAYS,
-            FILE_ATTRIBUTE_NORMAL,
-            NULL
-        );
-        if (hOutputWrite == INVALID_HANDLE_VALUE) {
-            std::cerr << "Error: Cannot create output file '" << cmd.outputRedirect.filename << "'\n";
-            if (hInputRead) CloseHandle(hInputRead);
-            return 1;
+    if (redirect.type == RedirectType::Input) {
+        hFile = CreateFileA(redirect.filename.c_str(), GENERIC_READ, FILE_SHARE_READ, sa,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (hFile == INVALID_HANDLE_VALUE) {
+            std::cerr << "Error: Cannot open input file '" << redirect.filename << "'\n";
+        }
+    } else if (redirect.type == RedirectType::Output) {
+        hFile = CreateFileA(redirect.filename.c_str(), GENERIC_WRITE, 0, sa,
+                            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (hFile == INVALID_HANDLE_VALUE) {
+            std::cerr << "Error: Cannot create output file '" << redirect.filename << "'\n";
         }
-    } else if (cmd.outputRedirect.type == RedirectType::Append) {
-        hOutputWrite = CreateFileA(
-            cmd.outputRedirect.filename.c_str(),
-            FILE_APPEND_DATA,
-            0,
-            &sa,
-            OPEN_ALWAYS,
-            FILE_ATTRIBUTE_NORMAL,
-            NULL
-        );
-        if (hOutputWrite == INVALID_HANDLE_VALUE) {
-            std::cerr << "Error: Cannot open output file '" << cmd.outputRedirect.filename << "'\n";
-            if (hInputRead) CloseHandle(hInputRead);
-            return 1;
+    } else if (redirect.type == RedirectType::Append) {
+        hFile = CreateFileA(redirect.filename.c_str(), FILE_APPEND_DATA, 0, sa,
+                            OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (hFile == INVALID_HANDLE_VALUE) {
+            std::cerr << "Error: Cannot open output file '" << redirect.filename << "'\n";
         }
     }
     
-    STARTUPINFOA si;
-    PROCESS_INFORMATION pi;
-    ZeroMemory(&si, sizeof(si));
-    si.cb = sizeof(si);
-    ZeroMemory(&pi, sizeof(pi));
-    
-    if (hInputRead || hOutputWrite) {
-        si.dwFlags |= STARTF_USESTDHANDLES;
-        si.hStdInput = hInputRead ? hInputRead : GetStdHandle(STD_INPUT_HANDLE);
-        si.hStdOutput = hOutputWrite ? hOutputWrite : GetStdHandle(STD_OUTPUT_HANDLE);
-        si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
-    }
-    
-    BOOL success = CreateProcessA(
-        NULL,
-        const_cast<char*>(cmdLine.c_str()),
-        NULL,
-        NULL,
-        TRUE,
-        0,
-        NULL,
-        NULL,
-        &si,
-        &pi
-    );
-    
-    if (!success) {
-        std::cerr << "Error: Command not found or failed to execute: " << cmd.program << "\n";
-        if (hInputRead) CloseHandle(hInputRead);
-        if (hOutputWrite) CloseHandle(hOutputWrite);
-        return 1;
+    return hFile;
+}
+
+namespace {
+
+// Everything a builtin stage thread needs. The thread owns the input
+// handle and, unless it is the console, the output handle.
+struct BuiltinStage {
+    Shell* shell = nullptr;
+    Command cmd;
+    bool consoleInput = false;
+    HANDLE input = NULL;
+    HANDLE output = NULL;
+    bool ownsOutput = false;
+};
+
+DWORD WINAPI runBuiltinStage(LPVOID param) {
+    std::unique_ptr<BuiltinStage> stage(static_cast<BuiltinStage*>(param));
+    DWORD status = 0;
+    {
+        std::unique_ptr<HandleReadBuf> inBuffer;
+        if (stage->input) inBuffer = std::make_unique<HandleReadBuf>(stage->input);
+        std::istream in(inBuffer ? inBuffer.get() : stage->consoleInput ? std::cin.rdbuf() : nullptr);
+        
+        auto sink = OutputSink::forHandle(stage->output, stage->ownsOutput);
+        status = static_cast<DWORD>(stage->shell->runBuiltin(stage->cmd, in, sink->stream()));
     }
+    if (stage->input) CloseHandle(stage->input);
+    return status;
+}
+
+}
+
+// Runs a builtin as a pipeline stage on its own thread, reading and
+// writing the stage's handles while the other stages run. The stage owns
+// a copy of its command; builtins that read more of the shell than that
+// never get here in a background job (see launchPipeline()).
+HANDLE Executor::startBuiltinStage(Command& cmd, HANDLE input, HANDLE output, bool ownsOutput, bool background) {
+    auto stage = std::make_unique<BuiltinStage>();
+    stage->shell = m_shell;
+    stage->cmd = cmd;
+    stage->consoleInput = !background;
+    stage->input = input;
+    stage->output = output;
+    stage->ownsOutput = ownsOutput;
     
-    WaitForSingleObject(pi.hProcess, INFINITE);
-    
-    DWORD exitCode;
-    GetExitCodeProcess(pi.hProcess, &exitCode);
-    
-    CloseHandle(pi.hProcess);
-    CloseHandle(pi.hThread);
-    if (hInputRead) CloseHandle(hInputRead);
-    if (hOutputWrite) CloseHandle(hOutputWrite);
+    // Only this thread may hold these ends, or a child could keep the
+    // pipe open after the builtin is done.
+    if (input) SetHandleInformation(input, HANDLE_FLAG_INHERIT, 0);
+    if (ownsOutput) SetHandleInformation(output, HANDLE_FLAG_INHERIT, 0);
     
-    return static_cast<int>(exitCode);
+    HANDLE thread = CreateThread(NULL, 0, runBuiltinStage, stage.get(), 0, NULL);
+    if (!thread) {
+        std::cerr << "Error: Failed to start builtin: " << cmd.program << "\n";
+        if (input) CloseHandle(input);
+        if (ownsOutput) CloseHandle(output);
+        return NULL;
+    }
+    stage.release();
+    return thread;
 }
 
-int Executor::executePipeline(Pipeline& pipeline) {
-    if (pipeline.commands.size() == 1) {
-        return executeSingle(pipeline.commands[0]);
+// A pipeline made only of builtins never leaves the shell process: the
+// stages run on threads connected by in-memory channels, and the last
+// one runs on the calling thread.
+int Executor::runBuiltinPipeline(Pipeline& pipeline) {
+    size_t numCmds = pipeline.commands.size();
+    std::vector<std::unique_ptr<Channel>> channels;
+    for (size_t i = 0; i + 1 < numCmds; ++i) {
+        channels.push_back(std::make_unique<Channel>());
+    }
+    std::vector<int> status(numCmds, 0);
+    LONGLONG startTicks = now();
+    
+    auto runStage = [&](size_t i) {
+        Command& cmd = pipeline.commands[i];
+        HANDLE hInputFile = NULL;
+        HANDLE hOutputFile = NULL;
+        
+        if (cmd.inputRedirect.type != RedirectType::None) {
+            hInputFile = openRedirect(cmd.inputRedirect, NULL);
+        }
+        if (hInputFile != INVALID_HANDLE_VALUE && cmd.outputRedirect.type != RedirectType::None) {
+            hOutputFile = openRedirect(cmd.outputRedirect, NULL);
+        }
+        
+        if (hInputFile != INVALID_HANDLE_VALUE && hOutputFile != INVALID_HANDLE_VALUE) {
+            std::unique_ptr<std::streambuf> inBuffer;
+            if (hInputFile) {
+                inBuffer = std::make_unique<HandleReadBuf>(hInputFile);
+            } else if (i > 0) {
+                inBuffer = std::make_unique<ChannelReadBuf>(*channels[i - 1]);
+            }
+            
+            std::unique_ptr<OutputSink> sink;
+            if (hOutputFile) {
+                sink = OutputSink::forHandle(hOutputFile, true);
+                hOutputFile = NULL;
+            } else if (i + 1 < numCmds) {
+                sink = OutputSink::forChannel(*channels[i]);
+            } else {
+                sink = OutputSink::console();
+            }
+            
+            std::istream in(inBuffer ? inBuffer.get() : std::cin.rdbuf());
+            status[i] = m_shell->runBuiltin(cmd, in, sink->stream());
+        } else {
+            status[i] = 1;
+        }
+        
+        // A redirected stage never attaches to its channels; close them
+        // anyway so its neighbours see end of stream.
+        if (i > 0) channels[i - 1]->closeReader();
+        if (i + 1 < numCmds) channels[i]->closeWriter();
+        if (hInputFile && hInputFile != INVALID_HANDLE_VALUE) CloseHandle(hInputFile);
+        if (hOutputFile && hOutputFile != INVALID_HANDLE_VALUE) CloseHandle(hOutputFile);
+    };
+    
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i + 1 < numCmds; ++i) {
+        threads.emplace_back(runStage, i);
+    }
+    runStage(numCmds - 1);
+    for (auto& thread : threads) {
+        thread.join();
     }
     
+    m_stageTicks += now() - startTicks;
+    return status.back();
+}
+
+bool Executor::launchPipeline(Pipeline& pipeline, bool background, std::vector<HANDLE>& processes) {
     size_t numCmds = pipeline.commands.size();
-    std::vector<HANDLE> processes;
     HANDLE hPrevReadPipe = NULL;
     
-    Command& firstCmd = pipeline.commands[0];
-    bool firstIsShellBuiltin = m_shell && m_shell->isBuiltin(firstCmd.program);
+    SECURITY_ATTRIBUTES sa;
+    sa.nLength = sizeof(SECURITY_ATTRIBUTES);
+    sa.bInheritHandle = TRUE;
+    sa.lpSecurityDescriptor = NULL;
     
-    if (firstIsShellBuiltin) {
-        std::string output = m_shell->executeBuiltinCapture(firstCmd);
-        
-        SECURITY_ATTRIBUTES sa;
-        sa.nLength = sizeof(SECURITY_ATTRIBUTES);
-        sa.bInheritHandle = TRUE;
-        sa.lpSecurityDescriptor = NULL;
-        
-        HANDLE hReadPipe, hWritePipe;
-        if (!CreatePipe(&hReadPipe, &hWritePipe, &sa, 0)) {
-            std::cerr << "Error: Failed to create pipe\n";
-            return 1;
+    // A background job outlives the command line, and its builtin stages
+    // run on their own threads while the shell goes on; one that reads or
+    // changes the shell's state would race the prompt.
+    if (background && m_shell) {
+        for (const Command& cmd : pipeline.commands) {
+            if (m_shell->isBuiltin(cmd) && m_shell->usesShellState(cmd.program)) {
+                std::cerr << cmd.program << ": cannot run in a background job\n";
+                return false;
+            }
         }
-        
-        DWORD written;
-        WriteFile(hWritePipe, output.c_str(), static_cast<DWORD>(output.size()), &written, NULL);
-        CloseHandle(hWritePipe);
-        
-        hPrevReadPipe = hReadPipe;
     }
     
-    size_t startIdx = firstIsShellBuiltin ? 1 : 0;
+    // Background jobs must not compete with the prompt for console input.
+    Command& firstCmd = pipeline.commands[0];
+    HANDLE hNulInput = NULL;
+    if (background && firstCmd.inputRedirect.type == RedirectType::None) {
+        hNulInput = CreateFileA("NUL", GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, &sa,
+                                OPEN_EXISTING, 0, NULL);
+        if (hNulInput == INVALID_HANDLE_VALUE) hNulInput = NULL;
+    }
+    
+    bool ok = true;
     
-    for (size_t i = startIdx; i < numCmds; ++i) {
+    for (size_t i = 0; i < numCmds; ++i) {
         Command& cmd = pipeline.commands[i];
         
-        SECURITY_ATTRIBUTES sa;
-        sa.nLength = sizeof(SECURITY_ATTRIBUTES);
-        sa.bInheritHandle = TRUE;
-        sa.lpSecurityDescriptor = NULL;
-        
         HANDLE hReadPipe = NULL;
         HANDLE hWritePipe = NULL;
+        HANDLE hInputFile = NULL;
+        HANDLE hOutputFile = NULL;
         
         if (i < numCmds - 1) {
             if (!CreatePipe(&hReadPipe, &hWritePipe, &sa, 0)) {
                 std::cerr << "Error: Failed to create pipe\n";
-                return 1;
+                ok = false;
+                break;
             }
         }
         
-        STARTUPINFOA si;
-        PROCESS_INFORMATION pi;
-        ZeroMemory(&si, sizeof(si));
-        si.cb = sizeof(si);
-        si.dwFlags = STARTF_USESTDHANDLES;
-        ZeroMemory(&pi, sizeof(pi));
-        
-        if (i == startIdx && !firstIsShellBuiltin) {
-            si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
-        } else {
-            si.hStdInput = hPrevReadPipe;
+        if (cmd.inputRedirect.type != RedirectType::None) {
+            hInputFile = openRedirect(cmd.inputRedirect, &sa);
         }
-        
-        if (i == numCmds - 1) {
-            si.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
-        } else {
-            si.hStdOutput = hWritePipe;
+        if (hInputFile != INVALID_HANDLE_VALUE && cmd.outputRedirect.type != RedirectType::None) {
+            hOutputFile = openRedirect(cmd.outputRedirect, &sa);
         }
         
-        si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+        bool success = false;
+        bool builtinStage = m_shell && m_shell->isBuiltin(cmd);
+        HANDLE hStarted = NULL;
         
-        std::string cmdLine;
-        if (isCmdBuiltin(cmd.program)) {
-            cmdLine = "cmd.exe /c " + buildCommandLine(cmd);
-        } else {
-            cmdLine = buildCommandLine(cmd);
+        if (hInputFile != INVALID_HANDLE_VALUE && hOutputFile != INVALID_HANDLE_VALUE && builtinStage) {
+            HANDLE input = hInputFile ? hInputFile : hPrevReadPipe;
+            HANDLE output = hOutputFile ? hOutputFile : hWritePipe;
+            bool ownsOutput = output != NULL;
+            if (!output) output = GetStdHandle(STD_OUTPUT_HANDLE);
+            
+            // The stage thread takes over these handles, even on failure.
+            if (input == hInputFile) hInputFile = NULL; else hPrevReadPipe = NULL;
+            if (output == hOutputFile) hOutputFile = NULL;
+            if (output == hWritePipe) hWritePipe = NULL;
+            
+            if (i == 0) m_launchTicks = now();
+            hStarted = startBuiltinStage(cmd, input, output, ownsOutput, background);
+            success = hStarted != NULL;
+        } else if (hInputFile != INVALID_HANDLE_VALUE && hOutputFile != INVALID_HANDLE_VALUE) {
+            LaunchSpec spec;
+            
+            if (hInputFile) {
+                spec.stdInput = hInputFile;
+            } else if (i > 0) {
+                spec.stdInput = hPrevReadPipe;
+            } else {
+                spec.stdInput = hNulInput ? hNulInput : GetStdHandle(STD_INPUT_HANDLE);
+            }
+            
+            if (hOutputFile) {
+                spec.stdOutput = hOutputFile;
+            } else if (i < numCmds - 1) {
+                spec.stdOutput = hWritePipe;
+            } else {
+                spec.stdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+            }
+            
+            spec.stdError = GetStdHandle(STD_ERROR_HANDLE);
+            
+            resolveExecutable(cmd);
+            if (isCmdBuiltin(cmd.program)) {
+                spec.commandLine = "cmd.exe /c " + buildCommandLine(cmd);
+            } else {
+                if (cmd.resolvedPath != cmd.program) {
+                    spec.imagePath = cmd.resolvedPath;
+                }
+                spec.commandLine = buildCommandLine(cmd);
+            }
+            
+            // A foreground pipeline's time starts when its first process
+            // exists, so PATH lookup and process creation are left out.
+            LaunchedProcess launched;
+            LONGLONG callStart = now();
+            success = m_launcher.launch(spec, launched);
+            hStarted = launched.process;
+            if (i == 0) m_launchTicks = success ? processStartTicks(hStarted, callStart) : now();
+            
+            if (!success) {
+                std::cerr << "Error: Command not found or failed to execute: " << cmd.program << "\n";
+            }
         }
         
-        BOOL success = CreateProcessA(
-            NULL,
-            const_cast<char*>(cmdLine.c_str()),
-            NULL,
-            NULL,
-            TRUE,
-            0,
-            NULL,
-            NULL,
-            &si,
-            &pi
-        );
-        
         if (hPrevReadPipe) {
             CloseHandle(hPrevReadPipe);
             hPrevReadPipe = NULL;
         }
-        
-        if (hWritePipe) {
-            CloseHandle(hWritePipe);
-            hWritePipe = NULL;
-        }
+        if (hWritePipe) CloseHandle(hWritePipe);
+        if (hInputFile && hInputFile != INVALID_HANDLE_VALUE) CloseHandle(hInputFile);
+        if (hOutputFile && hOutputFile != INVALID_HANDLE_VALUE) CloseHandle(hOutputFile);
         
         if (!success) {
-            std::cerr << "Error: Failed to execute: " << cmd.program << "\n";
             if (hReadPipe) CloseHandle(hReadPipe);
-            for (auto h : processes) CloseHandle(h);
-            return 1;
+            ok = false;
+            break;
         }
         
-        processes.push_back(pi.hProcess);
-        CloseHandle(pi.hThread);
+        // Job entries track processes only; a background builtin stage
+        // finishes on its own, and the process it feeds sees end of input.
+        if (background && builtinStage) {
+            CloseHandle(hStarted);
+        } else {
+            processes.push_back(hStarted);
+        }
         
         hPrevReadPipe = hReadPipe;
     }
     
-    WaitForMultipleObjects(static_cast<DWORD>(processes.size()), processes.data(), TRUE, INFINITE);
+    if (hPrevReadPipe) CloseHandle(hPrevReadPipe);
+    if (hNulInput) CloseHandle(hNulInput);
+    return ok;
+}
+
+static double toSeconds(const FILETIME& ft) {
+    ULARGE_INTEGER value;
+    value.LowPart = ft.dwLowDateTime;
+    value.HighPart = ft.dwHighDateTime;
+    return static_cast<double>(value.QuadPart) / 1e7;
+}
+
+// Reads the counters of a finished stage. Process handles stay queryable
+// until closed, so this costs a few system calls and no waiting.
+static StageUsage measureStage(HANDLE handle) {
+    StageUsage usage;
+    FILETIME created, exited, kernel, user;
     
+    if (GetProcessTimes(handle, &created, &exited, &kernel, &user)) {
+        usage.pid = GetProcessId(handle);
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(handle, &counters, sizeof(counters))) {
+            usage.peakWorkingSet = counters.PeakWorkingSetSize;
+        }
+    } else if (!GetThreadTimes(handle, &created, &exited, &kernel, &user)) {
+        return usage;
+    }
+    usage.userSeconds = toSeconds(user);
+    usage.kernelSeconds = toSeconds(kernel);
+    return usage;
+}
+
+static std::string formatBytes(SIZE_T bytes) {
+    const char* units[] = {"B", "KB", "MB", "GB"};
+    double size = static_cast<double>(bytes);
+    int unit = 0;
+    while (size >= 1024 && unit < 3) {
+        size /= 1024;
+        unit++;
+    }
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1) << size << " " << units[unit];
+    return ss.str();
+}
+
+int Executor::waitForProcesses(std::vector<HANDLE>& processes, std::vector<StageUsage>* usage) {
     DWORD exitCode = 0;
-    GetExitCodeProcess(processes.back(), &exitCode);
+    
+    for (auto h : processes) {
+        WaitForSingleObject(h, INFINITE);
+    }
+    if (!processes.empty()) {
+        if (!GetExitCodeProcess(processes.back(), &exitCode)) {
+            // A builtin last stage is a thread, not a process.
+            GetExitCodeThread(processes.back(), &exitCode);
+        }
+    }
+    if (usage) {
+        for (auto h : processes) {
+            usage->push_back(measureStage(h));
+        }
+    }
     
     for (auto h : processes) {
         CloseHandle(h);
     }
+    processes.clear();
     
     return static_cast<int>(exitCode);
 }
 
-int Executor::execute(Pipeline& pipeline) {
+int Executor::executePipeline(Pipeline& pipeline, bool background, std::vector<StageUsage>* usage) {
+    std::vector<HANDLE> processes;
+    
+    if (!launchPipeline(pipeline, background, processes)) {
+        // Let the stages that did start finish before reporting failure.
+        waitForProcesses(processes);
+        return 1;
+    }
+    
+    if (background) {
+        int id = m_jobs.add(describePipeline(pipeline), processes);
+        std::cout << "[" << id << "]";
+        for (auto h : processes) {
+            std::cout << " " << GetProcessId(h);
+        }
+        std::cout << "\n";
+        return 0;
+    }
+    
+    int status = waitForProcesses(processes, usage);
+    m_stageTicks += now() - m_launchTicks;
+    if (usage) {
+        for (size_t i = 0; i < usage->size() && i < pipeline.commands.size(); ++i) {
+            Command& cmd = pipeline.commands[i];
+            (*usage)[i].command = cmd.program;
+            for (const auto& arg : cmd.args) {
+                (*usage)[i].command += " " + arg;
+            }
+        }
+    }
+    return status;
+}
+
+void Executor::reportTiming(double wallSeconds, const std::vector<StageUsage>& usage) {
+    double user = 0;
+    double kernel = 0;
+    for (const auto& stage : usage) {
+        user += stage.userSeconds;
+        kernel += stage.kernelSeconds;
+    }
+    
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "\nreal  " << std::setw(9) << wallSeconds << "s\n";
+    ss << "user  " << std::setw(9) << user << "s\n";
+    ss << "sys   " << std::setw(9) << kernel << "s\n";
+    
+    if (!usage.empty()) {
+        ss << "\n" << std::right << std::setw(8) << "PID" << std::setw(11) << "User"
+           << std::setw(11) << "Sys" << std::setw(11) << "Peak" << "  Command\n";
+        for (const auto& stage : usage) {
+            ss << std::setw(8) << (stage.pid ? std::to_string(stage.pid) : "-")
+               << std::setw(10) << stage.userSeconds << "s"
+               << std::setw(10) << stage.kernelSeconds << "s"
+               << std::setw(11) << (stage.peakWorkingSet ? formatBytes(stage.peakWorkingSet) : "-")
+               << "  " << stage.command << "\n";
+        }
+    }
+    std::cerr << ss.str();
+}
+
+int Executor::execute(Pipeline& pipeline, bool background) {
     if (!pipeline.isValid || pipeline.commands.empty()) {
         return 1;
     }
-    return executePipeline(pipeline);
+    foldRecordStages(pipeline);
+    
+    // A background pipeline finishes after the prompt returns, so there
+    // is nothing to time it against.
+    bool timed = pipeline.timed && !background;
+    std::vector<StageUsage> usage;
+    LARGE_INTEGER frequency, start, end;
+    if (timed) {
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&start);
+    }
+    
+    // Builtins run inside the shell process, so '&' has nothing to detach.
+    // Their stages share the shell's counters, which are reported as one.
+    int status;
+    bool allBuiltins = m_shell && std::all_of(pipeline.commands.begin(), pipeline.commands.end(),
+        [this](const Command& cmd) { return m_shell->isBuiltin(cmd); });
+    if (allBuiltins) {
+        StageUsage before = timed ? measureStage(GetCurrentProcess()) : StageUsage();
+        status = runBuiltinPipeline(pipeline);
+        if (timed) {
+            StageUsage after = measureStage(GetCurrentProcess());
+            after.userSeconds -= before.userSeconds;
+            after.kernelSeconds -= before.kernelSeconds;
+            after.command = describePipeline(pipeline);
+            usage.push_back(after);
+        }
+    } else {
+        status = executePipeline(pipeline, background, timed ? &usage : nullptr);
+    }
+    
+    if (timed) {
+        QueryPerformanceCounter(&end);
+        double wall = static_cast<double>(end.QuadPart - start.QuadPart) / static_cast<double>(frequency.QuadPart);
+        reportTiming(wall, usage);
+    }
+    return status;
 }
 
-}
\ No newline at end of file
+int Executor::execute(CommandList& list) {
+    if (!list.isValid) {
+        return 1;
+    }
+    
+    int status = 0;
+    for (auto& item : list.items) {
+        if (m_shell && !m_shell->isRunning()) break;
+        if (item.op == ListOp::And && status != 0) continue;
+        if (item.op == ListOp::Or && status == 0) continue;
+        
+        status = item.group ? execute(*item.group) : execute(item.pipeline, item.background);
+    }
+    return status;
+}
+
+}
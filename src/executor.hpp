@@ -1,25 +1,61 @@
 #pragma once
 #include "common.hpp"
 #include "parser.hpp"
+#include "jobs.hpp"
+#include "pathindex.hpp"
+#include "launcher.hpp"
 
 namespace WaleedShell {
 
 class Shell;
 
+// Resources used by one pipeline stage, reported by `time`. Builtin
+// stages run as threads of the shell and have no pid or peak of their own.
+struct StageUsage {
+    std::string command;
+    DWORD pid = 0;
+    double userSeconds = 0;
+    double kernelSeconds = 0;
+    SIZE_T peakWorkingSet = 0;
+};
+
 class Executor {
 public:
-    Executor() : m_shell(nullptr) {}
+    Executor() : m_shell(nullptr), m_executables(nullptr), m_stageTicks(0), m_launchTicks(0) {}
     void setShell(Shell* shell) { m_shell = shell; }
-    int execute(Pipeline& pipeline);
+    void setExecutableIndex(ExecutableIndex* index) { m_executables = index; }
+    int execute(CommandList& list);
+    int execute(Pipeline& pipeline, bool background = false);
+    JobTable& jobs() { return m_jobs; }
+    // Internal commands of cmd.exe, which run through `cmd.exe /c`.
+    bool isCmdBuiltin(const std::string& program);
+    
+    // Performance-counter ticks from the first stage of each foreground
+    // pipeline existing (its process created, or its builtin thread
+    // starting) to its last stage finishing, summed over all runs.
+    // Whatever else a run costs, including PATH lookup and creating the
+    // first process, is the shell's own overhead.
+    LONGLONG stageTicks() const { return m_stageTicks; }
     
 private:
     Shell* m_shell;
+    ExecutableIndex* m_executables;
+    JobTable m_jobs;
+    ProcessLauncher m_launcher;
+    LONGLONG m_stageTicks;
+    LONGLONG m_launchTicks;
     
-    int executeSingle(Command& cmd);
-    int executePipeline(Pipeline& pipeline);
+    int executePipeline(Pipeline& pipeline, bool background, std::vector<StageUsage>* usage);
+    bool launchPipeline(Pipeline& pipeline, bool background, std::vector<HANDLE>& processes);
+    int runBuiltinPipeline(Pipeline& pipeline);
+    HANDLE startBuiltinStage(Command& cmd, HANDLE input, HANDLE output, bool ownsOutput, bool background);
+    int waitForProcesses(std::vector<HANDLE>& processes, std::vector<StageUsage>* usage = nullptr);
+    void reportTiming(double wallSeconds, const std::vector<StageUsage>& usage);
+    HANDLE openRedirect(const Redirect& redirect, SECURITY_ATTRIBUTES* sa);
+    std::string describePipeline(Pipeline& pipeline);
     std::string buildCommandLine(Command& cmd);
     std::string findExecutable(const std::string& program);
-    bool isCmdBuiltin(const std::string& program);
+    void resolveExecutable(Command& cmd);
 };
 
 }
\ No newline at end of file
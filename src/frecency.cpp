@@ -0,0 +1,80 @@
+#include "frecency.hpp"
+#include <chrono>
+
+namespace WaleedShell {
+
+// How many of the newest history entries seed the table.
+static const size_t FRECENCY_SEED_ENTRIES = 10000;
+
+Frecency::Frecency(HistoryStore& store) : m_store(store), m_newestSequence(0) {}
+
+std::string Frecency::normalizePath(const std::string& path) {
+    std::string key = path;
+    std::replace(key.begin(), key.end(), '/', '\\');
+    while (key.size() > 3 && key.back() == '\\') {
+        key.pop_back();
+    }
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+    return key;
+}
+
+// "git", "GIT.EXE" and "C:\Tools\git.exe" are all one program.
+std::string Frecency::programKey(const std::string& program) {
+    size_t slash = program.find_last_of("\\/");
+    std::string key = slash == std::string::npos ? program : program.substr(slash + 1);
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+    static const char* const extensions[] = {".exe", ".cmd", ".bat", ".com"};
+    for (const char* ext : extensions) {
+        size_t len = std::strlen(ext);
+        if (key.size() > len && key.compare(key.size() - len, len, ext) == 0) {
+            key.resize(key.size() - len);
+            break;
+        }
+    }
+    return key;
+}
+
+void Frecency::record(std::unordered_map<std::string, Usage>& table, const std::string& key, int64_t when) {
+    if (key.empty()) return;
+    Usage& usage = table[key];
+    usage.count++;
+    usage.lastUsed = std::max(usage.lastUsed, when);
+}
+
+void Frecency::update() {
+    m_store.refresh();
+
+    HistoryEntry entry;
+    size_t back = 0;
+    uint64_t newest = m_newestSequence;
+    size_t limit = m_newestSequence == 0 ? FRECENCY_SEED_ENTRIES : SIZE_MAX;
+    while (back < limit && m_store.entry(back, entry) && entry.sequence > m_newestSequence) {
+        newest = std::max(newest, entry.sequence);
+        size_t end = entry.command.find_first_of(" \t|;&<>");
+        record(m_commands, programKey(entry.command.substr(0, end)), entry.timestamp);
+        record(m_directories, normalizePath(entry.cwd), entry.timestamp);
+        back++;
+    }
+    m_newestSequence = newest;
+}
+
+double Frecency::weigh(const std::unordered_map<std::string, Usage>& table, const std::string& key) {
+    auto it = table.find(key);
+    if (it == table.end()) return 0.0;
+
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    int64_t age = now - it->second.lastUsed;
+    double factor = age < 3600 ? 4.0 : age < 86400 ? 2.0 : age < 7 * 86400 ? 0.5 : 0.25;
+    return it->second.count * factor;
+}
+
+double Frecency::command(const std::string& program) const {
+    return weigh(m_commands, programKey(program));
+}
+
+double Frecency::directory(const std::string& path) const {
+    return weigh(m_directories, normalizePath(path));
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "common.hpp"
+#include "history.hpp"
+
+namespace WaleedShell {
+
+// Frequency-and-recency weights for commands and directories, learned
+// from the history store: every entry counts one use of its program and
+// one visit to the directory it ran in. In the manner of z/zoxide a
+// weight is the use count scaled by how long ago the last use was, so a
+// directory visited twice this hour outranks one visited ten times last
+// month. Only the newest entries are read when the table is first built;
+// later calls add whatever the store has gained since.
+class Frecency {
+public:
+    explicit Frecency(HistoryStore& store);
+
+    void update();
+    double command(const std::string& program) const;
+    double directory(const std::string& path) const;
+
+    static std::string normalizePath(const std::string& path);
+    static std::string programKey(const std::string& program);
+
+private:
+    struct Usage {
+        uint32_t count = 0;
+        int64_t lastUsed = 0;
+    };
+
+    HistoryStore& m_store;
+    uint64_t m_newestSequence;
+    std::unordered_map<std::string, Usage> m_commands;
+    std::unordered_map<std::string, Usage> m_directories;
+
+    static void record(std::unordered_map<std::string, Usage>& table, const std::string& key, int64_t when);
+    static double weigh(const std::unordered_map<std::string, Usage>& table, const std::string& key);
+};
+
+}
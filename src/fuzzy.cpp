@@ -0,0 +1,213 @@
+#include "fuzzy.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WSHELL_FUZZY_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace WaleedShell {
+
+static const int SCORE_MATCH = 16;
+static const int SCORE_GAP_START = -3;
+static const int SCORE_GAP_EXTENSION = -1;
+static const int BONUS_BOUNDARY = 8;
+static const int BONUS_CAMEL = 7;
+static const int BONUS_CONSECUTIVE = 4;
+
+static char lowerChar(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+// Letters fold to one bit each, digits to ten more, everything else
+// shares the remaining bits.
+uint64_t FuzzyMatcher::charMask(std::string_view text) {
+    uint64_t mask = 0;
+    for (char raw : text) {
+        unsigned char c = (unsigned char)lowerChar(raw);
+        if (c >= 'a' && c <= 'z') {
+            mask |= 1ull << (c - 'a');
+        } else if (c >= '0' && c <= '9') {
+            mask |= 1ull << (26 + c - '0');
+        } else {
+            mask |= 1ull << (36 + c % 28);
+        }
+    }
+    return mask;
+}
+
+// First index at or after pos holding `lower` in either case, or size.
+static size_t findCaseless(const char* data, size_t size, size_t pos, char lower) {
+    char upper = (lower >= 'a' && lower <= 'z') ? (char)(lower - ('a' - 'A')) : lower;
+#ifdef WSHELL_FUZZY_SSE2
+    __m128i lo = _mm_set1_epi8(lower);
+    __m128i up = _mm_set1_epi8(upper);
+    while (pos + 16 <= size) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, lo), _mm_cmpeq_epi8(chunk, up));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+        if (mask) {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return pos + index;
+#else
+            return pos + static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+        }
+        pos += 16;
+    }
+#endif
+    while (pos < size && data[pos] != lower && data[pos] != upper) {
+        ++pos;
+    }
+    return pos;
+}
+
+static int boundaryBonus(std::string_view text, size_t i, size_t from) {
+    if (i == from) return BONUS_BOUNDARY;
+    char prev = text[i - 1];
+    char cur = text[i];
+    if (std::strchr("\\/_-. ", prev) != nullptr) return BONUS_BOUNDARY;
+    if (prev >= 'a' && prev <= 'z' && cur >= 'A' && cur <= 'Z') return BONUS_CAMEL;
+    return 0;
+}
+
+// Finds the leftmost match end, walks back from it to the latest start,
+// then scores that window, in the manner of fzf's first algorithm.
+int FuzzyMatcher::score(std::string_view query, std::string_view text, size_t from) {
+    if (query.empty()) return 0;
+    if (from > text.size()) return -1;
+
+    size_t pos = from;
+    size_t end = 0;
+    for (char q : query) {
+        pos = findCaseless(text.data(), text.size(), pos, q);
+        if (pos == text.size()) return -1;
+        end = pos++;
+    }
+
+    size_t start = end;
+    size_t k = query.size();
+    for (size_t i = end + 1; i-- > from;) {
+        if (lowerChar(text[i]) == query[k - 1]) {
+            if (--k == 0) {
+                start = i;
+                break;
+            }
+        }
+    }
+
+    int total = 0;
+    int runBonus = 0;
+    bool inRun = false;
+    bool inGap = false;
+    k = 0;
+    for (size_t i = start; i <= end; ++i) {
+        if (k < query.size() && lowerChar(text[i]) == query[k]) {
+            int bonus = boundaryBonus(text, i, from);
+            if (inRun) {
+                bonus = std::max(bonus, std::max(runBonus, BONUS_CONSECUTIVE));
+            } else {
+                runBonus = bonus;
+            }
+            total += SCORE_MATCH + (k == 0 ? bonus * 2 : bonus);
+            inRun = true;
+            inGap = false;
+            ++k;
+        } else {
+            total += inGap ? SCORE_GAP_EXTENSION : SCORE_GAP_START;
+            inGap = true;
+            inRun = false;
+        }
+    }
+    return total;
+}
+
+void FuzzyMatcher::clear() {
+    m_text.clear();
+    m_entries.clear();
+    m_masks.clear();
+    m_lastQuery.clear();
+    m_lastSize = 0;
+    m_lastMatches.clear();
+}
+
+void FuzzyMatcher::add(std::string_view text, size_t matchFrom, int boost) {
+    matchFrom = std::min(matchFrom, text.size());
+    m_entries.push_back({(uint32_t)m_text.size(), (uint32_t)text.size(), (uint32_t)matchFrom, boost});
+    m_masks.push_back(charMask(text.substr(matchFrom)));
+    m_text.append(text);
+}
+
+// Appends every index whose mask holds all bits of `need`.
+void FuzzyMatcher::prefilter(uint64_t need, std::vector<uint32_t>& candidates) const {
+    size_t i = 0;
+#ifdef WSHELL_FUZZY_SSE2
+    // SSE2 has no 64-bit compare: a lane passes when both of its 32-bit
+    // halves of (mask & need) ^ need are zero.
+    __m128i want = _mm_set1_epi64x((long long)need);
+    __m128i zero = _mm_setzero_si128();
+    for (; i + 2 <= m_masks.size(); i += 2) {
+        __m128i masks = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_masks.data() + i));
+        __m128i missing = _mm_xor_si128(_mm_and_si128(masks, want), want);
+        unsigned hits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi32(missing, zero)));
+        if ((hits & 0x00FF) == 0x00FF) candidates.push_back((uint32_t)i);
+        if ((hits & 0xFF00) == 0xFF00) candidates.push_back((uint32_t)i + 1);
+    }
+#endif
+    for (; i < m_masks.size(); ++i) {
+        if ((m_masks[i] & need) == need) candidates.push_back((uint32_t)i);
+    }
+}
+
+std::vector<size_t> FuzzyMatcher::filter(std::string_view query, size_t limit) {
+    std::string lower(query);
+    std::transform(lower.begin(), lower.end(), lower.begin(), lowerChar);
+    uint64_t need = charMask(lower);
+
+    // Candidates added since the last query were never tried against it,
+    // so they are checked along with its matches.
+    bool narrowing = !m_lastQuery.empty() && lower.compare(0, m_lastQuery.size(), m_lastQuery) == 0;
+    std::vector<uint32_t> candidates;
+    if (narrowing) {
+        candidates.swap(m_lastMatches);
+        for (size_t i = m_lastSize; i < m_entries.size(); ++i) {
+            candidates.push_back((uint32_t)i);
+        }
+    } else {
+        prefilter(need, candidates);
+    }
+
+    std::vector<std::pair<int, size_t>> ranked;
+    m_lastMatches.clear();
+    for (uint32_t i : candidates) {
+        int s = score(lower, text(i), m_entries[i].matchFrom);
+        if (s < 0) continue;
+        ranked.emplace_back(s + m_entries[i].boost, i);
+        m_lastMatches.push_back(i);
+    }
+    m_lastQuery = lower;
+    m_lastSize = m_entries.size();
+
+    size_t count = std::min(limit, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(),
+                      [this](const auto& a, const auto& b) {
+                          if (a.first != b.first) return a.first > b.first;
+                          std::string_view ta = text(a.second);
+                          std::string_view tb = text(b.second);
+                          if (ta.size() != tb.size()) return ta.size() < tb.size();
+                          return ta < tb;
+                      });
+
+    std::vector<size_t> result;
+    result.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        result.push_back(ranked[i].second);
+    }
+    return result;
+}
+
+}
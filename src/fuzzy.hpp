@@ -0,0 +1,58 @@
+#pragma once
+#include "common.hpp"
+#include <string_view>
+
+namespace WaleedShell {
+
+// fzf-style subsequence matcher over a fixed candidate set, for the Tab
+// menu. A query matches when its characters appear in order, ignoring
+// case. Matched characters score more at word boundaries (start of the
+// name, after a separator, camelCase humps) and in runs; gaps cost a
+// little. Each candidate carries a boost that is added to its score, so
+// frecency can lift familiar names.
+//
+// Filtering runs on every keystroke, so a candidate must first pass a
+// 64-bit character-class mask computed when it was added, checked two
+// candidates per instruction over a packed array of masks, then a
+// subsequence scan that finds each query character 16 bytes at a time.
+// Only survivors are scored. Texts live back to back in one buffer, and
+// a query that extends the previous one is only tried against that
+// query's matches.
+class FuzzyMatcher {
+public:
+    void clear();
+    // `matchFrom` skips a leading part of the text that the query is not
+    // compared against, such as the directory of a path candidate.
+    void add(std::string_view text, size_t matchFrom, int boost);
+
+    // Indices of matching candidates, best first, at most `limit`.
+    std::vector<size_t> filter(std::string_view query, size_t limit);
+
+    std::string_view text(size_t index) const {
+        return std::string_view(m_text).substr(m_entries[index].offset, m_entries[index].length);
+    }
+    size_t size() const { return m_entries.size(); }
+
+    // Score of `query` (lowercase) against text[from..], or -1 if it does
+    // not match.
+    static int score(std::string_view query, std::string_view text, size_t from);
+    static uint64_t charMask(std::string_view text);
+    void prefilter(uint64_t need, std::vector<uint32_t>& candidates) const;
+
+private:
+    struct Entry {
+        uint32_t offset;
+        uint32_t length;
+        uint32_t matchFrom;
+        int boost;
+    };
+
+    std::string m_text;
+    std::vector<Entry> m_entries;
+    std::vector<uint64_t> m_masks;
+    std::string m_lastQuery;
+    size_t m_lastSize = 0;
+    std::vector<uint32_t> m_lastMatches;
+};
+
+}
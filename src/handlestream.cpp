@@ -0,0 +1,88 @@
+#include "handlestream.hpp"
+
+namespace WaleedShell {
+
+HandleStreamBuf::HandleStreamBuf(HANDLE handle, size_t bufferSize, bool lineBuffered)
+    : m_handle(handle), m_buffer(bufferSize), m_broken(false), m_lineBuffered(lineBuffered) {
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+}
+
+HandleStreamBuf::~HandleStreamBuf() {
+    flushBuffer();
+}
+
+bool HandleStreamBuf::writeAll(const char* data, size_t count) {
+    while (count > 0 && !m_broken) {
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(count, 1u << 30));
+        DWORD written = 0;
+        if (!WriteFile(m_handle, data, chunk, &written, NULL) || written == 0) {
+            m_broken = true;
+            break;
+        }
+        data += written;
+        count -= written;
+    }
+    return !m_broken;
+}
+
+bool HandleStreamBuf::flushBuffer() {
+    size_t pending = static_cast<size_t>(pptr() - pbase());
+    bool ok = pending == 0 || writeAll(pbase(), pending);
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    return ok;
+}
+
+HandleStreamBuf::int_type HandleStreamBuf::overflow(int_type ch) {
+    if (!flushBuffer()) return traits_type::eof();
+    if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+    
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    if (m_lineBuffered && ch == '\n' && !flushBuffer()) return traits_type::eof();
+    return ch;
+}
+
+std::streamsize HandleStreamBuf::xsputn(const char* data, std::streamsize count) {
+    size_t size = static_cast<size_t>(count);
+    size_t room = static_cast<size_t>(epptr() - pptr());
+    
+    if (size <= room) {
+        std::memcpy(pptr(), data, size);
+        pbump(static_cast<int>(size));
+        if (m_lineBuffered && std::memchr(data, '\n', size) && !flushBuffer()) return 0;
+        return count;
+    }
+    
+    // Large writes skip the buffer rather than being split across it.
+    if (!flushBuffer()) return 0;
+    if (size >= m_buffer.size()) {
+        return writeAll(data, size) ? count : 0;
+    }
+    std::memcpy(pptr(), data, size);
+    pbump(static_cast<int>(size));
+    if (m_lineBuffered && std::memchr(data, '\n', size) && !flushBuffer()) return 0;
+    return count;
+}
+
+int HandleStreamBuf::sync() {
+    return flushBuffer() ? 0 : -1;
+}
+
+HandleReadBuf::HandleReadBuf(HANDLE handle, size_t bufferSize)
+    : m_handle(handle), m_buffer(bufferSize) {
+    setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+}
+
+HandleReadBuf::int_type HandleReadBuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    
+    DWORD bytesRead = 0;
+    if (!ReadFile(m_handle, m_buffer.data(), static_cast<DWORD>(m_buffer.size()), &bytesRead, NULL) ||
+        bytesRead == 0) {
+        return traits_type::eof();
+    }
+    setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + bytesRead);
+    return traits_type::to_int_type(*gptr());
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "common.hpp"
+
+namespace WaleedShell {
+
+// Output stream buffer that writes straight to a Win32 handle through a
+// fixed-size buffer. Builtins running as pipeline stages write through it,
+// so their output reaches the next stage as it is produced instead of
+// being collected in memory first. Once the reader goes away every further
+// write fails and the owning ostream turns bad. A line-buffered stream
+// also writes out every completed line, for output someone is watching.
+class HandleStreamBuf : public std::streambuf {
+public:
+    explicit HandleStreamBuf(HANDLE handle, size_t bufferSize = 64 * 1024, bool lineBuffered = false);
+    ~HandleStreamBuf() override;
+    HandleStreamBuf(const HandleStreamBuf&) = delete;
+    HandleStreamBuf& operator=(const HandleStreamBuf&) = delete;
+
+    bool broken() const { return m_broken; }
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* data, std::streamsize count) override;
+    int sync() override;
+
+private:
+    HANDLE m_handle;
+    std::vector<char> m_buffer;
+    bool m_broken;
+    bool m_lineBuffered;
+
+    bool writeAll(const char* data, size_t count);
+    bool flushBuffer();
+};
+
+// Input counterpart: reads a pipe or file handle in fixed-size chunks.
+// End of file and a closed writer both read as end of stream.
+class HandleReadBuf : public std::streambuf {
+public:
+    explicit HandleReadBuf(HANDLE handle, size_t bufferSize = 64 * 1024);
+    HandleReadBuf(const HandleReadBuf&) = delete;
+    HandleReadBuf& operator=(const HandleReadBuf&) = delete;
+
+protected:
+    int_type underflow() override;
+
+private:
+    HANDLE m_handle;
+    std::vector<char> m_buffer;
+};
+
+}
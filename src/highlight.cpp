@@ -0,0 +1,176 @@
+#include "highlight.hpp"
+#include "builtins.hpp"
+
+namespace WaleedShell {
+
+// Tried after a program name, in the order running it probes them.
+static const char* const PROGRAM_EXTENSIONS[] = {"", ".exe", ".cmd", ".bat", ".com"};
+
+static bool isRedirect(TokenKind kind) {
+    return kind == TokenKind::Input || kind == TokenKind::Output || kind == TokenKind::Append;
+}
+
+const std::vector<Ink>& Highlighter::colour(const std::string& line, const std::string& cwd) {
+    const std::vector<LexSpan>& spans = m_parser.lex(line);
+    m_inks.assign(line.size(), Ink::Default);
+    m_waiting = false;
+
+    // Words are read the way the parser reads them: the first of each
+    // pipeline stage is the command, and a redirect takes the next word,
+    // except in a `where` after a stage with records, which compares.
+    bool commandPosition = true;
+    TokenKind redirect = TokenKind::Word;
+    bool recordsIn = false;
+    bool recordsOut = false;
+    bool comparison = false;
+    size_t stageWords = 0;
+    for (size_t i = 0; i < spans.size(); ++i) {
+        const LexSpan& span = spans[i];
+        auto first = m_inks.begin() + span.start;
+        auto last = first + span.length;
+
+        if (span.kind != TokenKind::Word) {
+            if (isRedirect(span.kind) && comparison && stageWords == 1) {
+                std::fill(first, last, Ink::Operator);
+            } else if (isRedirect(span.kind)) {
+                std::fill(first, last, Ink::Redirect);
+                redirect = span.kind;
+            } else {
+                std::fill(first, last, Ink::Operator);
+                commandPosition = span.kind != TokenKind::RParen;
+                redirect = TokenKind::Word;
+                recordsIn = span.kind == TokenKind::Pipe && recordsOut;
+                recordsOut = false;
+            }
+            continue;
+        }
+
+        std::string_view text(line.data() + span.start, span.length);
+        std::string word = unquote(text);
+        Ink ink = Ink::Default;
+        if (redirect != TokenKind::Word) {
+            // Output files are created, so only input has to exist.
+            if (redirect == TokenKind::Input && !word.empty() &&
+                stat(absolutePath(word, cwd)) == StatCache::State::Missing) {
+                ink = Ink::Missing;
+            }
+            redirect = TokenKind::Word;
+        } else if (commandPosition) {
+            // `time` in front of a command times it and is no command itself.
+            bool timed = i + 1 < spans.size() && spans[i + 1].kind == TokenKind::Word &&
+                         Parser::isTimePrefix(word, unquote(std::string_view(line.data() + spans[i + 1].start,
+                                                                             spans[i + 1].length)));
+            ink = timed ? Ink::Command : commandInk(word, cwd);
+            commandPosition = timed;
+            const BuiltinName* builtin = findBuiltin(word);
+            bool recordOp = recordsIn && builtin && (builtin->flags & BUILTIN_RECORD_OP);
+            recordsOut = builtin && ((builtin->flags & BUILTIN_RECORDS) || recordOp);
+            comparison = recordOp && word == "where";
+            stageWords = 0;
+        } else {
+            ++stageWords;
+            if (!comparison && looksLikePath(word) && stat(absolutePath(word, cwd)) == StatCache::State::Missing) {
+                ink = Ink::Missing;
+            }
+        }
+        std::fill(first, last, ink);
+
+        if (span.quoted && ink == Ink::Default) {
+            size_t pos = 0;
+            while ((pos = text.find_first_of("\"'", pos)) != std::string_view::npos) {
+                size_t close = text.find(text[pos], pos + 1);
+                size_t end = close == std::string_view::npos ? text.size() : close + 1;
+                std::fill(first + pos, first + end, Ink::String);
+                pos = end;
+            }
+        }
+    }
+    return m_inks;
+}
+
+Ink Highlighter::commandInk(const std::string& word, const std::string& cwd) {
+    if (word.empty()) return Ink::Default;
+
+    StatCache::State state;
+    if (word.find_first_of("\\/:") != std::string::npos) {
+        state = statProgram(absolutePath(word, cwd));
+    } else {
+        if ((m_isCommand && m_isCommand(word)) || (m_executables && m_executables->contains(word))) {
+            return Ink::Command;
+        }
+        // The current directory is searched before PATH. Until PATH has
+        // been indexed a miss there proves nothing.
+        state = statProgram(absolutePath(word, cwd));
+        if (state == StatCache::State::Missing && !(m_executables && m_executables->built())) {
+            return Ink::Default;
+        }
+    }
+    return state == StatCache::State::File ? Ink::Command
+         : state == StatCache::State::Missing ? Ink::Unknown
+         : Ink::Default;
+}
+
+StatCache::State Highlighter::stat(const std::string& path) {
+    StatCache::State state = m_stats.lookup(path);
+    if (state == StatCache::State::Unknown) m_waiting = true;
+    return state;
+}
+
+StatCache::State Highlighter::statProgram(const std::string& path) {
+    bool unknown = false;
+    for (const char* ext : PROGRAM_EXTENSIONS) {
+        StatCache::State state = stat(path + ext);
+        if (state == StatCache::State::File) return state;
+        if (state == StatCache::State::Unknown) unknown = true;
+    }
+    return unknown ? StatCache::State::Unknown : StatCache::State::Missing;
+}
+
+// Joins `word` to `cwd` and folds "." and ".." with GetFullPathNameA,
+// which works on the string alone, so one file is one cache entry.
+std::string Highlighter::absolutePath(const std::string& word, const std::string& cwd) {
+    std::string path = word;
+    std::replace(path.begin(), path.end(), '/', '\\');
+    bool absolute = (path.size() >= 2 && path[1] == ':') || path.compare(0, 2, "\\\\") == 0;
+    if (!absolute && !path.empty() && path[0] == '\\') {
+        path = cwd.substr(0, 2) + path;
+    } else if (!absolute) {
+        path = (cwd.empty() || cwd.back() == '\\') ? cwd + path : cwd + "\\" + path;
+    }
+
+    char buffer[MAX_PATH];
+    DWORD length = GetFullPathNameA(path.c_str(), MAX_PATH, buffer, NULL);
+    return (length > 0 && length < MAX_PATH) ? std::string(buffer, length) : path;
+}
+
+std::string Highlighter::unquote(std::string_view text) {
+    std::string word;
+    size_t i = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (c != '"' && c != '\'') {
+            word += c;
+            ++i;
+            continue;
+        }
+        size_t close = text.find(c, i + 1);
+        size_t end = close == std::string_view::npos ? text.size() : close;
+        word.append(text.substr(i + 1, end - i - 1));
+        i = close == std::string_view::npos ? text.size() : close + 1;
+    }
+    return word;
+}
+
+// Only words that are clearly paths are checked: a drive, a backslash, or
+// a forward slash that does not start a switch such as /s. Switches,
+// wildcards, variables and URLs are left alone.
+bool Highlighter::looksLikePath(const std::string& word) {
+    if (word.empty() || word[0] == '-' || word.find_first_of("*?%") != std::string::npos ||
+        word.find("://") != std::string::npos) {
+        return false;
+    }
+    if ((word.size() >= 2 && word[1] == ':') || word.find('\\') != std::string::npos) return true;
+    return word[0] != '/' && word.find('/') != std::string::npos;
+}
+
+}
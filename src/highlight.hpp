@@ -0,0 +1,45 @@
+#pragma once
+#include "common.hpp"
+#include "parser.hpp"
+#include "pathindex.hpp"
+#include "renderer.hpp"
+#include "statcache.hpp"
+
+namespace WaleedShell {
+
+// Colours the line being edited: commands by whether they can run, quoted
+// text, pipes and list operators, redirects, and path arguments that do
+// not exist. Tokens come from Parser::lex(), so a keystroke re-lexes only
+// what it touched, and paths go through a StatCache, so nothing here waits
+// on the disk. A path still being checked is left uncoloured and waiting()
+// says so; the line should be coloured again when readyEvent() fires.
+class Highlighter {
+public:
+    Highlighter() : m_executables(nullptr), m_waiting(false) {}
+
+    void setExecutableIndex(ExecutableIndex* index) { m_executables = index; }
+    // Names the shell runs itself: builtins, cmd internals and aliases.
+    void setCommandCheck(std::function<bool(const std::string&)> check) { m_isCommand = std::move(check); }
+
+    // One ink per character of `line`, relative paths taken from `cwd`.
+    const std::vector<Ink>& colour(const std::string& line, const std::string& cwd);
+    bool waiting() const { return m_waiting; }
+    HANDLE readyEvent() const { return m_stats.readyEvent(); }
+
+private:
+    Parser m_parser;
+    StatCache m_stats;
+    ExecutableIndex* m_executables;
+    std::function<bool(const std::string&)> m_isCommand;
+    std::vector<Ink> m_inks;
+    bool m_waiting;
+
+    Ink commandInk(const std::string& word, const std::string& cwd);
+    StatCache::State stat(const std::string& path);
+    StatCache::State statProgram(const std::string& path);
+    static std::string absolutePath(const std::string& word, const std::string& cwd);
+    static std::string unquote(std::string_view word);
+    static bool looksLikePath(const std::string& word);
+};
+
+}
@@ -0,0 +1,338 @@
+#include "history.hpp"
+#include <chrono>
+
+namespace WaleedShell {
+
+namespace {
+
+constexpr char kFileMagic[8] = {'W', 'S', 'H', 'I', 'S', 'T', '\x01', '\0'};
+constexpr uint64_t kFileHeaderSize = 16;
+constexpr uint32_t kRecordMagic = 0x52485357; // "WSHR"
+
+// Every record is this header, the cwd and command bytes, padding to a
+// multiple of 8 and a trailing copy of `size`.
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t size;
+    uint64_t sequence;
+    int64_t timestamp;
+    uint64_t hash;
+    int32_t exitCode;
+    uint32_t cwdLength;
+    uint32_t commandLength;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(RecordHeader) == 48, "history record header must stay packed");
+
+}
+
+HistoryStore::HistoryStore()
+    : m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr), m_view(nullptr), m_mappedSize(0),
+      m_floor(0), m_indexedEnd(0), m_complete(false) {}
+
+HistoryStore::~HistoryStore() {
+    close();
+}
+
+void HistoryStore::close() {
+    if (m_view) UnmapViewOfFile(m_view);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+    m_view = nullptr;
+    m_mapping = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+    m_mappedSize = 0;
+    m_offsets.clear();
+    m_floor = 0;
+    m_indexedEnd = 0;
+    m_complete = false;
+}
+
+std::string HistoryStore::defaultPath() {
+    char buffer[MAX_PATH];
+    DWORD len = GetEnvironmentVariableA("WSHELL_HISTFILE", buffer, sizeof(buffer));
+    if (len > 0 && len < sizeof(buffer)) {
+        return std::string(buffer, len);
+    }
+    len = GetEnvironmentVariableA("USERPROFILE", buffer, sizeof(buffer));
+    if (len > 0 && len < sizeof(buffer)) {
+        return std::string(buffer, len) + "\\.wshell_history";
+    }
+    return "";
+}
+
+uint64_t HistoryStore::hashCommand(const std::string& command) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : command) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// The lock covers one byte far past any real end of file, so it never
+// overlaps data other sessions are reading through their mappings.
+bool HistoryStore::lock(OVERLAPPED& region, bool exclusive) {
+    ZeroMemory(&region, sizeof(region));
+    region.OffsetHigh = 0x40000000;
+    return LockFileEx(m_file, exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0, 1, 0, &region) != 0;
+}
+
+void HistoryStore::unlock(OVERLAPPED& region) {
+    UnlockFileEx(m_file, 0, 1, 0, &region);
+}
+
+bool HistoryStore::open(const std::string& path) {
+    close();
+    if (path.empty()) return false;
+
+    m_file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                         FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                         NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m_file == INVALID_HANDLE_VALUE) return false;
+
+    OVERLAPPED region;
+    if (!lock(region, true)) {
+        close();
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    bool ok = GetFileSizeEx(m_file, &size) != 0;
+    if (ok && size.QuadPart == 0) {
+        char header[kFileHeaderSize] = {};
+        std::memcpy(header, kFileMagic, sizeof(kFileMagic));
+        OVERLAPPED at = {};
+        DWORD written = 0;
+        ok = WriteFile(m_file, header, sizeof(header), &written, &at) && written == sizeof(header);
+        size.QuadPart = kFileHeaderSize;
+    } else if (ok) {
+        // Refuse anything that is not a history file rather than append to it.
+        char header[kFileHeaderSize] = {};
+        OVERLAPPED at = {};
+        DWORD read = 0;
+        ok = size.QuadPart >= (LONGLONG)kFileHeaderSize &&
+             ReadFile(m_file, header, sizeof(header), &read, &at) && read == sizeof(header) &&
+             std::memcmp(header, kFileMagic, sizeof(kFileMagic)) == 0;
+    }
+    unlock(region);
+
+    if (!ok || !remap((uint64_t)size.QuadPart)) {
+        close();
+        return false;
+    }
+
+    m_path = path;
+    m_floor = m_mappedSize;
+    m_indexedEnd = m_mappedSize;
+    return true;
+}
+
+// The old view stays in place until the new one exists, so offsets
+// already indexed remain readable if mapping the larger file fails.
+bool HistoryStore::remap(uint64_t size) {
+    HANDLE mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY,
+                                        (DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFF), NULL);
+    if (!mapping) return false;
+    const char* view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!view) {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    if (m_view) UnmapViewOfFile(m_view);
+    if (m_mapping) CloseHandle(m_mapping);
+    m_mapping = mapping;
+    m_view = view;
+    m_mappedSize = size;
+    return true;
+}
+
+bool HistoryStore::validRecord(uint64_t offset, uint64_t limit) const {
+    if (offset < kFileHeaderSize || offset % 8 != 0) return false;
+    if (limit > m_mappedSize || offset + sizeof(RecordHeader) + sizeof(uint32_t) > limit) return false;
+
+    RecordHeader header;
+    std::memcpy(&header, m_view + offset, sizeof(header));
+    if (header.magic != kRecordMagic || header.size % 8 != 0) return false;
+    if (header.size > limit - offset) return false;
+    if ((uint64_t)sizeof(RecordHeader) + header.cwdLength + header.commandLength + sizeof(uint32_t) > header.size) {
+        return false;
+    }
+
+    uint32_t trailer;
+    std::memcpy(&trailer, m_view + offset + header.size - sizeof(trailer), sizeof(trailer));
+    return trailer == header.size;
+}
+
+void HistoryStore::indexForward(uint64_t from, uint64_t to, std::vector<uint64_t>& offsets) const {
+    uint64_t pos = from;
+    while (pos + sizeof(RecordHeader) <= to) {
+        if (validRecord(pos, to)) {
+            uint32_t size;
+            std::memcpy(&size, m_view + pos + offsetof(RecordHeader, size), sizeof(size));
+            offsets.push_back(pos);
+            pos += size;
+        } else {
+            pos += 8;
+        }
+    }
+}
+
+bool HistoryStore::extendBackward() {
+    if (m_complete || !m_view) return false;
+    if (m_floor < kFileHeaderSize + sizeof(RecordHeader) + sizeof(uint32_t)) {
+        m_complete = true;
+        return false;
+    }
+
+    uint32_t size;
+    std::memcpy(&size, m_view + m_floor - sizeof(size), sizeof(size));
+    if (size <= m_floor - kFileHeaderSize && validRecord(m_floor - size, m_floor)) {
+        m_floor -= size;
+        m_offsets.push_front(m_floor);
+        return true;
+    }
+
+    // Damaged record: index everything below the floor the slow way.
+    std::vector<uint64_t> older;
+    indexForward(kFileHeaderSize, m_floor, older);
+    m_offsets.insert(m_offsets.begin(), older.begin(), older.end());
+    m_floor = kFileHeaderSize;
+    m_complete = true;
+    return !older.empty();
+}
+
+void HistoryStore::refresh() {
+    if (!isPersistent()) return;
+
+    OVERLAPPED region;
+    if (!lock(region, false)) return;
+    LARGE_INTEGER size;
+    bool ok = GetFileSizeEx(m_file, &size) != 0;
+    unlock(region);
+
+    if (ok && (uint64_t)size.QuadPart > m_mappedSize) {
+        catchUp((uint64_t)size.QuadPart);
+    }
+}
+
+void HistoryStore::catchUp(uint64_t size) {
+    if (!remap(size)) return;
+    std::vector<uint64_t> newer;
+    indexForward(m_indexedEnd, m_mappedSize, newer);
+    m_offsets.insert(m_offsets.end(), newer.begin(), newer.end());
+    m_indexedEnd = m_mappedSize;
+}
+
+void HistoryStore::decode(uint64_t offset, HistoryEntry& result) const {
+    RecordHeader header;
+    std::memcpy(&header, m_view + offset, sizeof(header));
+    const char* data = m_view + offset + sizeof(header);
+    result.sequence = header.sequence;
+    result.timestamp = header.timestamp;
+    result.exitCode = header.exitCode;
+    result.hash = header.hash;
+    result.cwd.assign(data, header.cwdLength);
+    result.command.assign(data + header.cwdLength, header.commandLength);
+}
+
+bool HistoryStore::entry(size_t back, HistoryEntry& result) {
+    if (!isPersistent()) {
+        if (back >= m_memory.size()) return false;
+        result = m_memory[m_memory.size() - 1 - back];
+        return true;
+    }
+
+    while (m_offsets.size() <= back) {
+        if (!extendBackward()) return false;
+    }
+    decode(m_offsets[m_offsets.size() - 1 - back], result);
+    return true;
+}
+
+size_t HistoryStore::count() {
+    if (!isPersistent()) return m_memory.size();
+    while (extendBackward()) {}
+    return m_offsets.size();
+}
+
+bool HistoryStore::append(const std::string& command, const std::string& cwd, int exitCode) {
+    if (command.empty()) return true;
+
+    uint64_t hash = hashCommand(command);
+    int64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    if (!isPersistent()) {
+        if (!m_memory.empty() && m_memory.back().hash == hash) return true;
+        HistoryEntry& added = m_memory.emplace_back();
+        added.sequence = m_memory.size();
+        added.timestamp = timestamp;
+        added.exitCode = exitCode;
+        added.hash = hash;
+        added.cwd = cwd;
+        added.command = command;
+        return true;
+    }
+
+    OVERLAPPED region;
+    if (!lock(region, true)) return false;
+
+    // With the lock held the end of the file is stable: index up to it so
+    // the newest record, possibly from another session, is known.
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size)) {
+        unlock(region);
+        return false;
+    }
+    uint64_t end = (uint64_t)size.QuadPart;
+    if (end > m_mappedSize) catchUp(end);
+    if (m_offsets.empty()) extendBackward();
+
+    RecordHeader header = {};
+    header.sequence = 1;
+    if (!m_offsets.empty()) {
+        RecordHeader newest;
+        std::memcpy(&newest, m_view + m_offsets.back(), sizeof(newest));
+        if (newest.hash == hash) {
+            unlock(region);
+            return true;
+        }
+        header.sequence = newest.sequence + 1;
+    }
+
+    size_t payload = sizeof(RecordHeader) + cwd.size() + command.size() + sizeof(uint32_t);
+    size_t recordSize = (payload + 7) & ~(size_t)7;
+    header.magic = kRecordMagic;
+    header.size = (uint32_t)recordSize;
+    header.timestamp = timestamp;
+    header.hash = hash;
+    header.exitCode = exitCode;
+    header.cwdLength = (uint32_t)cwd.size();
+    header.commandLength = (uint32_t)command.size();
+
+    std::vector<char> record(recordSize, 0);
+    std::memcpy(record.data(), &header, sizeof(header));
+    std::memcpy(record.data() + sizeof(header), cwd.data(), cwd.size());
+    std::memcpy(record.data() + sizeof(header) + cwd.size(), command.data(), command.size());
+    std::memcpy(record.data() + recordSize - sizeof(uint32_t), &header.size, sizeof(uint32_t));
+
+    // A torn tail left by a crash is not aligned; start past it so the new
+    // record stays reachable by the backward walk.
+    uint64_t at = (end + 7) & ~(uint64_t)7;
+    OVERLAPPED position = {};
+    position.Offset = (DWORD)(at & 0xFFFFFFFF);
+    position.OffsetHigh = (DWORD)(at >> 32);
+    DWORD written = 0;
+    // A short write is a torn tail like any other: the next append starts
+    // past it and readers skip it.
+    bool ok = WriteFile(m_file, record.data(), (DWORD)record.size(), &written, &position) &&
+              written == record.size();
+
+    unlock(region);
+    return ok;
+}
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "common.hpp"
+#include <deque>
+
+namespace WaleedShell {
+
+struct HistoryEntry {
+    uint64_t sequence = 0;
+    int64_t timestamp = 0;
+    int exitCode = 0;
+    uint64_t hash = 0;
+    std::string cwd;
+    std::string command;
+};
+
+// Command history shared by every shell instance through one append-only
+// file, mapped read-only into each of them. Records carry a trailing copy
+// of their size, so the newest entries are found by walking back from the
+// end of the file and opening it costs the same however long it has grown;
+// older offsets are indexed only when navigation reaches them. Appends
+// happen under an exclusive lock on a byte range past the end of the file
+// and go out in a single write. A record that fails validation (a write
+// torn by a crash) makes the index fall back to a forward scan that skips
+// to the next intact record. Without a usable file the history is kept in
+// memory for the session.
+class HistoryStore {
+public:
+    HistoryStore();
+    ~HistoryStore();
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    bool open(const std::string& path);
+    bool isPersistent() const { return m_file != INVALID_HANDLE_VALUE; }
+    const std::string& path() const { return m_path; }
+
+    // Skips the record if its hash matches the newest entry in the file,
+    // whichever session wrote that. False if the record could not be
+    // written to the file.
+    bool append(const std::string& command, const std::string& cwd, int exitCode);
+
+    // Picks up entries other sessions appended since the last call. Entry
+    // numbering below is relative to the state seen by the last refresh.
+    void refresh();
+    bool entry(size_t back, HistoryEntry& result);
+    // Indexes every record back to the start of the file and returns the
+    // number of entries. Reads the whole file the first time.
+    size_t count();
+
+    static uint64_t hashCommand(const std::string& command);
+    static std::string defaultPath();
+
+private:
+    HANDLE m_file;
+    HANDLE m_mapping;
+    const char* m_view;
+    uint64_t m_mappedSize;
+    std::string m_path;
+
+    // Offsets of a contiguous run of records ending at m_indexedEnd, oldest
+    // first. m_floor is where the next backward step continues from.
+    std::deque<uint64_t> m_offsets;
+    uint64_t m_floor;
+    uint64_t m_indexedEnd;
+    bool m_complete;
+
+    std::vector<HistoryEntry> m_memory;
+
+    void close();
+    bool remap(uint64_t size);
+    void catchUp(uint64_t size);
+    bool validRecord(uint64_t offset, uint64_t limit) const;
+    bool extendBackward();
+    void indexForward(uint64_t from, uint64_t to, std::vector<uint64_t>& offsets) const;
+    void decode(uint64_t offset, HistoryEntry& result) const;
+    bool lock(OVERLAPPED& region, bool exclusive);
+    void unlock(OVERLAPPED& region);
+};
+
+}
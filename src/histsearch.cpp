@@ -0,0 +1,245 @@
+#include "histsearch.hpp"
+#include <bit>
+
+namespace WaleedShell {
+
+namespace {
+
+// How many history entries the newest-first walk looks at before handing
+// the query to the index.
+constexpr size_t kRecentWalkLimit = 2048;
+
+}
+
+HistorySearch::HistorySearch(HistoryStore& store)
+    : m_store(store), m_complete(!store.isPersistent()), m_builtReady(false), m_stopping(false) {
+    if (!m_complete) {
+        m_builder = std::thread(&HistorySearch::buildLoop, this, store.path());
+    }
+}
+
+HistorySearch::~HistorySearch() {
+    m_stopping = true;
+    if (m_builder.joinable()) m_builder.join();
+}
+
+// Reads the file through a store of its own, since HistoryStore is not
+// shared between threads, and hands the finished index to update(). A
+// file it cannot open yields an empty index, which update() then fills
+// from the shell's store.
+void HistorySearch::buildLoop(std::string path) {
+    Index index;
+    HistoryStore store;
+    if (store.open(path)) {
+        HistoryEntry entry;
+        for (size_t back = store.count(); back-- > 0 && !m_stopping;) {
+            if (store.entry(back, entry)) index.add(entry);
+        }
+    }
+    if (m_stopping) return;
+
+    std::lock_guard<std::mutex> lock(m_buildMutex);
+    m_built = std::move(index);
+    m_builtReady = true;
+}
+
+// Bigram and trigram keys share one table; the length tag keeps them apart.
+uint32_t HistorySearch::gram(const char* text, size_t length) {
+    uint32_t key = (uint32_t)length << 24;
+    for (size_t i = 0; i < length; ++i) {
+        key |= (uint32_t)(unsigned char)text[i] << (8 * (length - 1 - i));
+    }
+    return key;
+}
+
+bool HistorySearch::containsLower(const std::string& text, const std::string& lowerNeedle) {
+    auto it = std::search(text.begin(), text.end(), lowerNeedle.begin(), lowerNeedle.end(),
+                          [](char a, char b) { return (char)::tolower((unsigned char)a) == b; });
+    return it != text.end();
+}
+
+void HistorySearch::Index::add(const HistoryEntry& entry) {
+    newestSequence = std::max(newestSequence, entry.sequence);
+
+    auto found = byHash.find(entry.hash);
+    if (found != byHash.end()) {
+        Doc& doc = docs[found->second];
+        doc.lastSequence = std::max(doc.lastSequence, entry.sequence);
+        doc.count++;
+        maxCount = std::max(maxCount, doc.count);
+        log.emplace_back(entry.sequence, found->second);
+        return;
+    }
+
+    uint32_t id = (uint32_t)docs.size();
+    docs.push_back({entry.command, entry.sequence, 1});
+    byHash.emplace(entry.hash, id);
+    maxCount = std::max(maxCount, 1u);
+    log.emplace_back(entry.sequence, id);
+
+    std::string lower = entry.command;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    std::vector<uint32_t> grams;
+    for (size_t length = 2; length <= 3; ++length) {
+        for (size_t i = 0; i + length <= lower.size(); ++i) {
+            grams.push_back(gram(lower.data() + i, length));
+        }
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    // Ids only grow, so every posting list stays sorted.
+    for (uint32_t key : grams) {
+        postings[key].push_back(id);
+    }
+}
+
+void HistorySearch::update() {
+    bool replaced = false;
+    if (!m_complete) {
+        std::unique_lock<std::mutex> lock(m_buildMutex, std::try_to_lock);
+        if (lock.owns_lock() && m_builtReady) {
+            m_index = std::move(m_built);
+            m_complete = true;
+            replaced = true;
+        }
+    }
+    if (replaced) m_builder.join();
+
+    m_store.refresh();
+
+    // The store hands out entries newest first; collect the ones not yet
+    // indexed and add them oldest first so sequence order is preserved.
+    // Until the full index arrives only the newest entries are indexed,
+    // as many as the walk would look at.
+    size_t limit = m_complete ? SIZE_MAX : kRecentWalkLimit;
+    std::vector<HistoryEntry> fresh;
+    HistoryEntry entry;
+    while (fresh.size() < limit && m_store.entry(fresh.size(), entry) &&
+           entry.sequence > m_index.newestSequence) {
+        fresh.push_back(std::move(entry));
+    }
+    if (fresh.empty() && !replaced) return;
+
+    for (auto it = fresh.rbegin(); it != fresh.rend(); ++it) {
+        m_index.add(*it);
+    }
+    m_lastQuery.clear();
+    m_lastMatches.clear();
+}
+
+double HistorySearch::score(const Doc& doc) const {
+    double age = (double)(m_index.newestSequence - doc.lastSequence);
+    return (double)std::bit_width(doc.count) / (1.0 + age / 64.0);
+}
+
+bool HistorySearch::ranksAbove(uint32_t a, uint32_t b) const {
+    double scoreA = score(m_index.docs[a]);
+    double scoreB = score(m_index.docs[b]);
+    if (scoreA != scoreB) return scoreA > scoreB;
+    return m_index.docs[a].lastSequence > m_index.docs[b].lastSequence;
+}
+
+// Every command not yet seen was last used no later than the entry being
+// visited, so its score is at most the best count bonus over that age.
+// Once the weakest of `limit` matches beats that bound the walk is done.
+bool HistorySearch::matchRecent(const std::string& lowerQuery, size_t limit, std::vector<uint32_t>& result) {
+    result.clear();
+    double maxBonus = (double)std::bit_width(m_index.maxCount);
+
+    size_t visited = 0;
+    for (size_t i = m_index.log.size(); i-- > 0;) {
+        if (++visited > kRecentWalkLimit) return false;
+        auto [sequence, id] = m_index.log[i];
+
+        if (result.size() == limit) {
+            double bound = maxBonus / (1.0 + (double)(m_index.newestSequence - sequence) / 64.0);
+            if (score(m_index.docs[result.back()]) >= bound) return true;
+        }
+
+        const Doc& doc = m_index.docs[id];
+        if (doc.lastSequence != sequence || !containsLower(doc.command, lowerQuery)) continue;
+
+        auto pos = std::upper_bound(result.begin(), result.end(), id,
+                                    [this](uint32_t a, uint32_t b) { return ranksAbove(a, b); });
+        if ((size_t)(pos - result.begin()) >= limit) continue;
+        result.insert(pos, id);
+        if (result.size() > limit) result.pop_back();
+    }
+    return true;
+}
+
+void HistorySearch::match(const std::string& lowerQuery, std::vector<uint32_t>& result) {
+    result.clear();
+
+    if (!m_lastQuery.empty() && lowerQuery.compare(0, m_lastQuery.size(), m_lastQuery) == 0) {
+        for (uint32_t id : m_lastMatches) {
+            if (containsLower(m_index.docs[id].command, lowerQuery)) result.push_back(id);
+        }
+        return;
+    }
+
+    if (lowerQuery.size() < 2) {
+        for (uint32_t id = 0; id < m_index.docs.size(); ++id) {
+            if (containsLower(m_index.docs[id].command, lowerQuery)) result.push_back(id);
+        }
+        return;
+    }
+
+    std::vector<const std::vector<uint32_t>*> lists;
+    size_t length = std::min<size_t>(lowerQuery.size(), 3);
+    for (size_t i = 0; i + length <= lowerQuery.size(); ++i) {
+        auto found = m_index.postings.find(gram(lowerQuery.data() + i, length));
+        if (found == m_index.postings.end()) return;
+        lists.push_back(&found->second);
+    }
+    std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+    // Walk the shortest list and probe the others, which keeps the cost
+    // proportional to the rarest n-gram of the query.
+    for (uint32_t id : *lists[0]) {
+        bool inAll = true;
+        for (size_t i = 1; i < lists.size() && inAll; ++i) {
+            inAll = std::binary_search(lists[i]->begin(), lists[i]->end(), id);
+        }
+        if (inAll && (lowerQuery.size() == length || containsLower(m_index.docs[id].command, lowerQuery))) {
+            result.push_back(id);
+        }
+    }
+}
+
+std::vector<std::string> HistorySearch::search(const std::string& query, size_t limit) {
+    std::vector<std::string> results;
+    if (query.empty() || limit == 0) return results;
+
+    std::string lower = query;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+    // A query that extends one the index answered is narrowed from that
+    // answer straight away; the walk already failed for the shorter query.
+    bool narrowing = !m_lastQuery.empty() && lower.compare(0, m_lastQuery.size(), m_lastQuery) == 0;
+    std::vector<uint32_t> matches;
+    if (!narrowing && matchRecent(lower, limit, matches)) {
+        // The walk saw only part of the matches; the next keystroke cannot
+        // narrow from it.
+        m_lastQuery.clear();
+        m_lastMatches.clear();
+    } else {
+        match(lower, matches);
+        m_lastQuery = lower;
+        m_lastMatches = matches;
+
+        size_t count = std::min(limit, matches.size());
+        std::partial_sort(matches.begin(), matches.begin() + count, matches.end(),
+                          [this](uint32_t a, uint32_t b) { return ranksAbove(a, b); });
+        matches.resize(count);
+    }
+
+    results.reserve(matches.size());
+    for (uint32_t id : matches) {
+        results.push_back(m_index.docs[id].command);
+    }
+    return results;
+}
+
+}
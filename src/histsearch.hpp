@@ -0,0 +1,85 @@
+#pragma once
+#include "common.hpp"
+#include "history.hpp"
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace WaleedShell {
+
+// Case-insensitive substring search over every distinct command in a
+// HistoryStore, for Ctrl-R. Since ranking favours recent commands, a
+// query first walks the history newest first and stops as soon as no
+// older command could outrank the matches already found, which settles
+// common queries after a few hundred entries. Rare queries, where that
+// walk gives up, go to the index: each command is filed once under the
+// bigrams and trigrams of its lowercased text, a query intersects the
+// posting lists of its own n-grams and only the survivors are compared
+// byte by byte. Typing one more character then narrows the previous
+// match set instead of starting over.
+//
+// A persistent history can run to millions of entries, so the full index
+// is built on a thread of its own, from a second HistoryStore on the same
+// file, as soon as the search is created. Until it is handed over,
+// update() indexes only the newest entries, enough for the walk. After
+// that, update() extends the index with whatever the store has gained,
+// so it also picks up other sessions.
+class HistorySearch {
+public:
+    explicit HistorySearch(HistoryStore& store);
+    ~HistorySearch();
+    HistorySearch(const HistorySearch&) = delete;
+    HistorySearch& operator=(const HistorySearch&) = delete;
+
+    void update();
+    // Best matches first: recently used commands rank highest, and among
+    // commands of similar age the frequently used ones come first.
+    std::vector<std::string> search(const std::string& query, size_t limit);
+
+    size_t size() const { return m_index.docs.size(); }
+    // Whether the index covers the whole history yet.
+    bool complete() const { return m_complete; }
+
+private:
+    struct Doc {
+        std::string command;
+        uint64_t lastSequence;
+        uint32_t count;
+    };
+
+    struct Index {
+        std::vector<Doc> docs;
+        std::unordered_map<uint64_t, uint32_t> byHash;
+        std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+        std::vector<std::pair<uint64_t, uint32_t>> log;
+        uint64_t newestSequence = 0;
+        uint32_t maxCount = 0;
+
+        void add(const HistoryEntry& entry);
+    };
+
+    HistoryStore& m_store;
+    Index m_index;
+    bool m_complete;
+
+    std::string m_lastQuery;
+    std::vector<uint32_t> m_lastMatches;
+
+    // The background build. m_built is filled in and m_builtReady set
+    // under m_buildMutex; update() takes it over without waiting.
+    std::mutex m_buildMutex;
+    Index m_built;
+    bool m_builtReady;
+    std::atomic<bool> m_stopping;
+    std::thread m_builder;
+
+    void buildLoop(std::string path);
+    bool matchRecent(const std::string& lowerQuery, size_t limit, std::vector<uint32_t>& result);
+    void match(const std::string& lowerQuery, std::vector<uint32_t>& result);
+    double score(const Doc& doc) const;
+    bool ranksAbove(uint32_t a, uint32_t b) const;
+    static uint32_t gram(const char* text, size_t length);
+    static bool containsLower(const std::string& text, const std::string& lowerNeedle);
+};
+
+}
@@ -1,164 +1,338 @@
 #include "input.hpp"
+#include <unordered_set>
+#include <cmath>
 
 namespace WaleedShell {
 
-InputHandler::InputHandler() : m_historyIndex(0) {
+// How long a Tab waits for the full answer before opening the menu.
+static const ULONGLONG COMPLETION_DEADLINE_MS = 150;
+// Matches listed at once in the completion menu.
+static const size_t MENU_ROWS = 8;
+// Frecency boost: points per doubling of a candidate's weight, and the
+// most it can add, so a familiar name never buries a much better match.
+static const double FRECENCY_BOOST_SCALE = 12.0;
+static const int FRECENCY_BOOST_MAX = 48;
+
+InputHandler::InputHandler()
+    : m_history(nullptr), m_keys(GetStdHandle(STD_INPUT_HANDLE)),
+      m_renderer(GetStdHandle(STD_OUTPUT_HANDLE)), m_executables(nullptr) {
     m_hInput = GetStdHandle(STD_INPUT_HANDLE);
-    m_hOutput = GetStdHandle(STD_OUTPUT_HANDLE);
 }
 
-void InputHandler::clearLine(size_t promptLen, size_t lineLen) {
-    std::cout << '\r';
-    for (size_t i = 0; i < promptLen + lineLen + 5; ++i) {
-        std::cout << ' ';
-    }
-    std::cout << '\r';
+void InputHandler::setHistory(HistoryStore* history) {
+    m_history = history;
+    m_search = history ? std::make_unique<HistorySearch>(*history) : nullptr;
+    m_frecency = history ? std::make_unique<Frecency>(*history) : nullptr;
+    m_suggest = history ? std::make_unique<HistorySuggest>(*history) : nullptr;
 }
 
-void InputHandler::refreshLine(const std::string& prompt, const std::string& line, size_t cursorPos) {
-    std::cout << '\r' << prompt << line;
+// Ctrl-R: every keystroke re-runs the query against the history index and
+// shows the best match; Ctrl-R again steps to the next one. Enter runs the
+// match, Esc or Ctrl-G restores the line, any other key keeps the match
+// for editing. Returns true when the line should run.
+bool InputHandler::reverseSearch(GapBuffer& line, size_t& cursorPos) {
+    GapBuffer original = line;
+    std::string query;
+    std::vector<std::string> matches;
+    size_t selected = 0;
     
-    size_t totalLen = prompt.size() + line.size();
-    for (size_t i = 0; i < 5; ++i) std::cout << ' ';
-    for (size_t i = 0; i < 5; ++i) std::cout << '\b';
+    m_search->update();
+    
+    auto render = [&]() {
+        std::string label = (!query.empty() && matches.empty()) ? "(failed reverse-i-search)`" : "(reverse-i-search)`";
+        GapBuffer shown(matches.empty() ? std::string() : matches[selected]);
+        m_renderer.render(label + query + "': ", shown, shown.size());
+    };
+    render();
     
-    if (cursorPos < line.size()) {
-        size_t moveBack = line.size() - cursorPos;
-        for (size_t i = 0; i < moveBack; ++i) {
-            std::cout << '\b';
+    bool run = false;
+    while (true) {
+        INPUT_RECORD record;
+        if (!m_keys.read(record)) {
+            break;
+        }
+        if (record.EventType != KEY_EVENT || !record.Event.KeyEvent.bKeyDown) {
+            continue;
+        }
+        
+        WORD vk = record.Event.KeyEvent.wVirtualKeyCode;
+        char ch = record.Event.KeyEvent.uChar.AsciiChar;
+        
+        if (ch == 0x12) {
+            if (selected + 1 < matches.size()) selected++;
+            render();
+            continue;
         }
+        if (vk == VK_BACK) {
+            if (!query.empty()) {
+                query.pop_back();
+                matches = m_search->search(query, 64);
+                selected = 0;
+            }
+            render();
+            continue;
+        }
+        if (ch >= 32 && ch < 127) {
+            query += ch;
+            matches = m_search->search(query, 64);
+            selected = 0;
+            render();
+            continue;
+        }
+        if (vk == VK_ESCAPE || ch == 0x07) {
+            line = original;
+            break;
+        }
+        if (vk == VK_SHIFT || vk == VK_CONTROL || vk == VK_MENU) {
+            continue;
+        }
+        
+        if (!matches.empty()) {
+            line.assign(matches[selected]);
+        }
+        run = (vk == VK_RETURN);
+        break;
     }
-    std::cout.flush();
+    
+    cursorPos = line.size();
+    refreshLine(line, cursorPos);
+    return run;
 }
 
-std::vector<std::string> InputHandler::getPathCompletions(const std::string& partial) {
-    std::vector<std::string> completions;
-    
-    std::string searchPath = partial;
-    std::string prefix;
+void InputHandler::setExecutableIndex(ExecutableIndex* index) {
+    m_executables = index;
+    m_completer.setExecutableIndex(index);
+    m_highlighter.setExecutableIndex(index);
+}
+
+// Draws the line as edited, coloured by the highlighter. With the cursor
+// at the end it is followed by the history suggestion, kept in m_hint for
+// Right or End to accept. Both need VT output.
+void InputHandler::refreshLine(const GapBuffer& line, size_t cursorPos) {
+    m_hint.clear();
+    if (!m_renderer.hasVt()) {
+        m_renderer.render(line, cursorPos);
+        return;
+    }
     
-    size_t lastSlash = partial.find_last_of("\\/");
-    if (lastSlash != std::string::npos) {
-        prefix = partial.substr(0, lastSlash + 1);
-        searchPath = partial.substr(lastSlash + 1);
+    std::string text = line.str();
+    if (m_suggest && !text.empty() && cursorPos == text.size()) {
+        std::string suggestion = m_suggest->suggest(text, m_currentDir);
+        if (suggestion.size() > text.size()) m_hint = suggestion.substr(text.size());
     }
+    m_renderer.render(line, cursorPos, m_hint, m_highlighter.colour(text, m_currentDir));
+}
+
+// Executables are offered for the first word of a command: at the start
+// of the line or after a pipe, list operator or opening parenthesis.
+void InputHandler::startCompletion(const GapBuffer& buffer, size_t cursorPos) {
+    std::string line = buffer.str();
+    size_t wordStart = line.find_last_of(" ", cursorPos - 1);
+    wordStart = (wordStart == std::string::npos) ? 0 : wordStart + 1;
+    std::string partial = line.substr(wordStart, cursorPos - wordStart);
     
-    std::string searchDir = prefix.empty() ? "." : prefix;
-    std::string pattern = searchDir + "\\*";
+    m_completer.cancel();
+    m_pending = PendingCompletion{};
+    if (partial.empty()) return;
     
-    WIN32_FIND_DATAA fd;
-    HANDLE hFind = FindFirstFileA(pattern.c_str(), &fd);
+    size_t before = wordStart == 0 ? std::string::npos : line.find_last_not_of(" ", wordStart - 1);
+    bool commandPosition = before == std::string::npos || std::strchr("|;&(", line[before]) != nullptr;
+    size_t lastSlash = partial.find_last_of("\\/");
     
-    if (hFind != INVALID_HANDLE_VALUE) {
-        do {
-            std::string name = fd.cFileName;
-            if (name == "." || name == "..") continue;
-            
-            std::string lowerName = name;
-            std::string lowerSearch = searchPath;
-            std::transform(lowerName.begin(), lowerName.end(), lowerName.begin(), ::tolower);
-            std::transform(lowerSearch.begin(), lowerSearch.end(), lowerSearch.begin(), ::tolower);
-            
-            if (lowerName.find(lowerSearch) == 0) {
-                std::string completion = prefix + name;
-                if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-                    completion += "\\";
-                }
-                completions.push_back(completion);
-            }
-        } while (FindNextFileA(hFind, &fd));
-        FindClose(hFind);
-    }
+    m_matcher.clear();
+    if (m_frecency) m_frecency->update();
     
-    return completions;
+    m_pending.active = true;
+    m_pending.id = m_completer.start(partial, commandPosition);
+    m_pending.wordStart = wordStart;
+    m_pending.queryStart = wordStart + (lastSlash == std::string::npos ? 0 : lastSlash + 1);
+    m_pending.query = line.substr(m_pending.queryStart, cursorPos - m_pending.queryStart);
+    m_pending.deadline = GetTickCount64() + COMPLETION_DEADLINE_MS;
 }
 
-std::vector<std::string> InputHandler::getExecutableCompletions(const std::string& partial) {
-    std::vector<std::string> completions;
-    std::vector<std::string> extensions = {".exe", ".cmd", ".bat", ".com"};
-    
-    char pathEnv[32767];
-    GetEnvironmentVariableA("PATH", pathEnv, 32767);
-    
-    std::vector<std::string> paths;
-    paths.push_back(".");
+// Lifts candidates the user runs or visits often: directories by the
+// history's working directories, everything else by its programs.
+int InputHandler::completionBoost(const std::string& candidate) const {
+    if (!m_frecency) return 0;
     
-    std::stringstream ss(pathEnv);
-    std::string path;
-    while (std::getline(ss, path, ';')) {
-        if (!path.empty()) {
-            paths.push_back(path);
-        }
+    double weight;
+    if (!candidate.empty() && candidate.back() == '\\') {
+        char full[MAX_PATH];
+        DWORD len = GetFullPathNameA(candidate.c_str(), MAX_PATH, full, NULL);
+        weight = (len > 0 && len < MAX_PATH) ? m_frecency->directory(full) : 0.0;
+    } else {
+        weight = m_frecency->command(candidate);
     }
+    return std::min(FRECENCY_BOOST_MAX, (int)(FRECENCY_BOOST_SCALE * std::log2(1.0 + weight)));
+}
+
+// Moves newly published candidates into the matcher. Returns true when
+// any arrived.
+bool InputHandler::receiveCompletions() {
+    std::vector<std::string> items;
+    m_pending.done = m_completer.poll(m_pending.id, m_pending.received, items);
+    m_pending.received += items.size();
     
-    std::string lowerPartial = partial;
-    std::transform(lowerPartial.begin(), lowerPartial.end(), lowerPartial.begin(), ::tolower);
+    size_t matchFrom = m_pending.queryStart - m_pending.wordStart;
+    for (const auto& item : items) {
+        m_matcher.add(item, matchFrom, completionBoost(item));
+    }
+    return !items.empty();
+}
+
+// A finished search that leaves one match completes it; one whose matches
+// all extend the word by a common prefix inserts that prefix, as plain
+// prefix completion did. Anything else, or a search still running at the
+// deadline, opens the menu.
+void InputHandler::serviceCompletion(GapBuffer& line, size_t& cursorPos) {
+    receiveCompletions();
+    if (!m_pending.done && GetTickCount64() < m_pending.deadline) return;
     
-    for (const auto& dir : paths) {
-        WIN32_FIND_DATAA fd;
-        std::string pattern = dir + "\\*";
-        HANDLE hFind = FindFirstFileA(pattern.c_str(), &fd);
+    if (m_pending.done) {
+        std::vector<size_t> matches = m_matcher.filter(m_pending.query, SIZE_MAX);
+        std::vector<std::string> texts;
+        for (size_t index : matches) {
+            texts.emplace_back(m_matcher.text(index));
+        }
         
-        if (hFind != INVALID_HANDLE_VALUE) {
-            do {
-                std::string name = fd.cFileName;
-                if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
-                
-                std::string lowerName = name;
-                std::transform(lowerName.begin(), lowerName.end(), lowerName.begin(), ::tolower);
-                
-                bool isExe = false;
-                for (const auto& ext : extensions) {
-                    if (lowerName.size() >= ext.size() && 
-                        lowerName.substr(lowerName.size() - ext.size()) == ext) {
-                        isExe = true;
-                        break;
-                    }
-                }
-                
-                if (isExe && lowerName.find(lowerPartial) == 0) {
-                    std::string baseName = name.substr(0, name.find_last_of('.'));
-                    if (std::find(completions.begin(), completions.end(), baseName) == completions.end()) {
-                        completions.push_back(baseName);
-                    }
-                }
-            } while (FindNextFileA(hFind, &fd));
-            FindClose(hFind);
+        std::string word = line.substr(m_pending.wordStart, cursorPos - m_pending.wordStart);
+        std::string common = getCommonPrefix(texts);
+        bool extends = common.size() > word.size() && _strnicmp(common.c_str(), word.c_str(), word.size()) == 0;
+        if (texts.empty() || (texts.size() > 1 && !extends)) {
+            if (!texts.empty()) completionMenu(line, cursorPos);
+            m_pending.active = false;
+            return;
         }
+        
+        line.erase(m_pending.wordStart, cursorPos - m_pending.wordStart);
+        line.insert(m_pending.wordStart, common);
+        cursorPos = m_pending.wordStart + common.size();
+        refreshLine(line, cursorPos);
+        m_pending.active = false;
+        return;
     }
     
-    std::vector<std::string> builtins = {
-        "dir", "echo", "type", "copy", "move", "del", "ren", "mkdir", "rmdir",
-        "cd", "pwd", "clear", "cls", "exit", "help"
-    };
+    completionMenu(line, cursorPos);
+    m_completer.cancel();
+    m_pending.active = false;
+}
+
+// The menu lists the best matches for the query under the input line and
+// re-ranks them on every keystroke. Up/Down or Tab/Shift-Tab move the
+// selection, typing refines the query, Backspace widens it, Enter takes
+// the selected candidate and Esc keeps the line as typed. Batches still
+// arriving from the worker are merged in while it is up.
+void InputHandler::completionMenu(GapBuffer& line, size_t& cursorPos) {
+    std::vector<size_t> matches = m_matcher.filter(m_pending.query, MENU_ROWS);
+    size_t selected = 0;
+    size_t wordStart = m_pending.wordStart;
     
-    for (const auto& cmd : builtins) {
-        if (cmd.find(lowerPartial) == 0) {
-            if (std::find(completions.begin(), completions.end(), cmd) == completions.end()) {
-                completions.push_back(cmd);
+    // Without VT sequences there are no rows to draw, so the selection is
+    // previewed in the line instead, the way cmd.exe cycles through names.
+    auto draw = [&]() {
+        if (m_renderer.hasVt()) {
+            std::vector<std::string> rows;
+            for (size_t r = 0; r < matches.size(); ++r) {
+                rows.push_back((r == selected ? "> " : "  ") + std::string(m_matcher.text(matches[r])));
             }
+            if (!m_pending.done) rows.push_back("  ...");
+            m_renderer.render(line, cursorPos);
+            m_renderer.menu(rows, selected);
+        } else if (!matches.empty()) {
+            GapBuffer preview = line;
+            std::string completion(m_matcher.text(matches[selected]));
+            preview.erase(wordStart, cursorPos - wordStart);
+            preview.insert(wordStart, completion);
+            m_renderer.render(preview, wordStart + completion.size());
+        } else {
+            m_renderer.render(line, cursorPos);
         }
-    }
+    };
     
-    return completions;
-}
-
-std::vector<std::string> InputHandler::getCompletions(const std::string& partial) {
-    if (partial.empty()) return {};
+    auto requery = [&]() {
+        matches = m_matcher.filter(m_pending.query, MENU_ROWS);
+        selected = 0;
+        draw();
+    };
     
-    if (partial.find(' ') == std::string::npos) {
-        auto pathComps = getPathCompletions(partial);
-        auto exeComps = getExecutableCompletions(partial);
-        
-        for (const auto& c : exeComps) {
-            if (std::find(pathComps.begin(), pathComps.end(), c) == pathComps.end()) {
-                pathComps.push_back(c);
+    draw();
+    bool accept = false;
+    while (true) {
+        if (!m_pending.done && !m_keys.buffered()) {
+            HANDLE waits[2] = {m_hInput, m_completer.readyEvent()};
+            if (WaitForMultipleObjects(2, waits, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) {
+                bool more = receiveCompletions();
+                if (more || m_pending.done) {
+                    matches = m_matcher.filter(m_pending.query, MENU_ROWS);
+                    selected = std::min(selected, matches.empty() ? 0 : matches.size() - 1);
+                    draw();
+                }
+                continue;
             }
         }
-        return pathComps;
+        
+        INPUT_RECORD record;
+        if (!m_keys.read(record)) {
+            break;
+        }
+        if (record.EventType != KEY_EVENT || !record.Event.KeyEvent.bKeyDown) {
+            continue;
+        }
+        
+        WORD vk = record.Event.KeyEvent.wVirtualKeyCode;
+        char ch = record.Event.KeyEvent.uChar.AsciiChar;
+        bool shift = (record.Event.KeyEvent.dwControlKeyState & SHIFT_PRESSED) != 0;
+        
+        if (vk == VK_SHIFT || vk == VK_CONTROL || vk == VK_MENU) {
+            continue;
+        }
+        if (vk == VK_DOWN || (vk == VK_TAB && !shift)) {
+            if (!matches.empty()) selected = (selected + 1) % matches.size();
+            draw();
+            continue;
+        }
+        if (vk == VK_UP || vk == VK_TAB) {
+            if (!matches.empty()) selected = (selected + matches.size() - 1) % matches.size();
+            draw();
+            continue;
+        }
+        if (vk == VK_BACK) {
+            // Backspacing past the query would edit the directory the
+            // candidates came from, so that closes the menu instead.
+            if (m_pending.query.empty()) break;
+            m_pending.query.pop_back();
+            line.erase(cursorPos - 1, 1);
+            cursorPos--;
+            requery();
+            continue;
+        }
+        if (vk == VK_RETURN) {
+            accept = !matches.empty();
+            break;
+        }
+        if (vk == VK_ESCAPE) {
+            break;
+        }
+        if (ch >= 32 && ch < 127) {
+            line.insert(cursorPos, ch);
+            cursorPos++;
+            // A separator ends the word; it is kept and the menu closes.
+            if (std::strchr(" \\/|;&<>", ch) != nullptr) break;
+            m_pending.query += ch;
+            requery();
+            continue;
+        }
+        break;
     }
     
-    return getPathCompletions(partial);
+    if (accept) {
+        std::string completion(m_matcher.text(matches[selected]));
+        line.erase(wordStart, cursorPos - wordStart);
+        line.insert(wordStart, completion);
+        cursorPos = wordStart + completion.size();
+    }
+    m_renderer.menu({}, 0);
+    refreshLine(line, cursorPos);
 }
 
 std::string InputHandler::getCommonPrefix(const std::vector<std::string>& strings) {
@@ -178,23 +352,53 @@ std::string InputHandler::getCommonPrefix(const std::vector<std::string>& string
 }
 
 std::string InputHandler::readLine(const std::string& prompt) {
-    std::string line;
+    GapBuffer line;
     size_t cursorPos = 0;
-    size_t historyNav = m_history.size();
     std::string savedLine;
     
+    // Up walks back through the store, skipping commands already shown on
+    // this line by hash; `shown` holds the positions Down returns through.
+    std::vector<size_t> shown;
+    std::unordered_set<uint64_t> shownHashes;
+    size_t nextBack = 0;
+    if (m_history) m_history->refresh();
+    
+    if (m_suggest) m_suggest->update();
+    char buffer[MAX_PATH];
+    DWORD dirLength = GetCurrentDirectoryA(MAX_PATH, buffer);
+    m_currentDir = (dirLength > 0 && dirLength < MAX_PATH) ? buffer : "";
+    m_hint.clear();
+    
     DWORD originalMode;
     GetConsoleMode(m_hInput, &originalMode);
     SetConsoleMode(m_hInput, ENABLE_PROCESSED_INPUT);
     
-    std::cout << prompt;
-    std::cout.flush();
+    m_renderer.begin(prompt);
     
     while (true) {
         INPUT_RECORD record;
-        DWORD read;
         
-        if (!ReadConsoleInputA(m_hInput, &record, 1, &read)) {
+        // While a completion is running, wait for either a key or its next
+        // batch, and no longer than its deadline, without touching the disk.
+        // Keys already read ahead come first.
+        if (m_pending.active && !m_keys.buffered()) {
+            HANDLE waits[2] = {m_hInput, m_completer.readyEvent()};
+            ULONGLONG now = GetTickCount64();
+            DWORD timeout = m_pending.deadline > now ? (DWORD)(m_pending.deadline - now) : 0;
+            if (WaitForMultipleObjects(2, waits, FALSE, timeout) != WAIT_OBJECT_0) {
+                serviceCompletion(line, cursorPos);
+                continue;
+            }
+        } else if (m_highlighter.waiting() && !m_keys.buffered()) {
+            // Paths still being checked recolour the line as answers come in.
+            HANDLE waits[2] = {m_hInput, m_highlighter.readyEvent()};
+            if (WaitForMultipleObjects(2, waits, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) {
+                refreshLine(line, cursorPos);
+                continue;
+            }
+        }
+        
+        if (!m_keys.read(record)) {
             break;
         }
         
@@ -205,49 +409,33 @@ std::string InputHandler::readLine(const std::string& prompt) {
         WORD vk = record.Event.KeyEvent.wVirtualKeyCode;
         char ch = record.Event.KeyEvent.uChar.AsciiChar;
         
+        // Typing on retires a completion still in flight.
+        if (m_pending.active && vk != VK_SHIFT && vk != VK_CONTROL && vk != VK_MENU) {
+            m_completer.cancel();
+            m_pending.active = false;
+        }
+        
         if (vk == VK_RETURN) {
-            std::cout << '\n';
             break;
         }
         
-        if (vk == VK_TAB) {
-            size_t wordStart = line.find_last_of(" ", cursorPos - 1);
-            wordStart = (wordStart == std::string::npos) ? 0 : wordStart + 1;
-            std::string partial = line.substr(wordStart, cursorPos - wordStart);
-            
-            auto completions = getCompletions(partial);
-            
-            if (completions.size() == 1) {
-                std::string completion = completions[0];
-                line = line.substr(0, wordStart) + completion + line.substr(cursorPos);
-                cursorPos = wordStart + completion.size();
-                clearLine(prompt.size(), line.size() + 10);
-                refreshLine(prompt, line, cursorPos);
-            } else if (completions.size() > 1) {
-                std::string common = getCommonPrefix(completions);
-                if (common.size() > partial.size()) {
-                    line = line.substr(0, wordStart) + common + line.substr(cursorPos);
-                    cursorPos = wordStart + common.size();
-                    clearLine(prompt.size(), line.size() + 10);
-                    refreshLine(prompt, line, cursorPos);
-                } else {
-                    std::cout << '\n';
-                    for (const auto& c : completions) {
-                        std::cout << c << "  ";
-                    }
-                    std::cout << '\n';
-                    refreshLine(prompt, line, cursorPos);
-                }
+        if (ch == 0x12 && m_search) {
+            if (reverseSearch(line, cursorPos)) {
+                break;
             }
             continue;
         }
         
+        if (vk == VK_TAB) {
+            startCompletion(line, cursorPos);
+            continue;
+        }
+        
         if (vk == VK_BACK) {
             if (cursorPos > 0) {
                 line.erase(cursorPos - 1, 1);
                 cursorPos--;
-                clearLine(prompt.size(), line.size() + 1);
-                refreshLine(prompt, line, cursorPos);
+                refreshLine(line, cursorPos);
             }
             continue;
         }
@@ -255,8 +443,7 @@ std::string InputHandler::readLine(const std::string& prompt) {
         if (vk == VK_DELETE) {
             if (cursorPos < line.size()) {
                 line.erase(cursorPos, 1);
-                clearLine(prompt.size(), line.size() + 1);
-                refreshLine(prompt, line, cursorPos);
+                refreshLine(line, cursorPos);
             }
             continue;
         }
@@ -264,91 +451,93 @@ std::string InputHandler::readLine(const std::string& prompt) {
         if (vk == VK_LEFT) {
             if (cursorPos > 0) {
                 cursorPos--;
-                std::cout << '\b';
-                std::cout.flush();
+                refreshLine(line, cursorPos);
             }
             continue;
         }
         
-        if (vk == VK_RIGHT) {
-            if (cursorPos < line.size()) {
-                std::cout << line[cursorPos];
-                std::cout.flush();
+        if (vk == VK_RIGHT || (vk == VK_END && cursorPos == line.size())) {
+            if (cursorPos == line.size() && !m_hint.empty()) {
+                line.insert(cursorPos, m_hint);
+                cursorPos = line.size();
+                refreshLine(line, cursorPos);
+            } else if (vk == VK_RIGHT && cursorPos < line.size()) {
                 cursorPos++;
+                refreshLine(line, cursorPos);
             }
             continue;
         }
         
         if (vk == VK_UP) {
-            if (!m_history.empty() && historyNav > 0) {
-                if (historyNav == m_history.size()) {
-                    savedLine = line;
+            HistoryEntry entry;
+            bool found = false;
+            while (m_history && m_history->entry(nextBack, entry)) {
+                nextBack++;
+                if (shownHashes.insert(entry.hash).second) {
+                    found = true;
+                    break;
                 }
-                historyNav--;
-                size_t oldLen = line.size();
-                line = m_history[historyNav];
+            }
+            if (found) {
+                if (shown.empty()) {
+                    savedLine = line.str();
+                }
+                shown.push_back(nextBack - 1);
+                line.assign(entry.command);
                 cursorPos = line.size();
-                clearLine(prompt.size(), oldLen > line.size() ? oldLen : line.size());
-                refreshLine(prompt, line, cursorPos);
+                refreshLine(line, cursorPos);
             }
             continue;
         }
         
         if (vk == VK_DOWN) {
-            if (historyNav < m_history.size()) {
-                size_t oldLen = line.size();
-                historyNav++;
-                if (historyNav == m_history.size()) {
-                    line = savedLine;
+            if (!shown.empty()) {
+                HistoryEntry entry;
+                m_history->entry(shown.back(), entry);
+                shownHashes.erase(entry.hash);
+                nextBack = shown.back();
+                shown.pop_back();
+                if (shown.empty()) {
+                    line.assign(savedLine);
                 } else {
-                    line = m_history[historyNav];
+                    m_history->entry(shown.back(), entry);
+                    line.assign(entry.command);
                 }
                 cursorPos = line.size();
-                clearLine(prompt.size(), oldLen > line.size() ? oldLen : line.size());
-                refreshLine(prompt, line, cursorPos);
+                refreshLine(line, cursorPos);
             }
             continue;
         }
         
         if (vk == VK_HOME) {
-            while (cursorPos > 0) {
-                std::cout << '\b';
-                cursorPos--;
-            }
-            std::cout.flush();
+            cursorPos = 0;
+            refreshLine(line, cursorPos);
             continue;
         }
         
         if (vk == VK_END) {
-            while (cursorPos < line.size()) {
-                std::cout << line[cursorPos];
-                cursorPos++;
-            }
-            std::cout.flush();
+            cursorPos = line.size();
+            refreshLine(line, cursorPos);
             continue;
         }
         
+        // Text queued behind this key, typically a paste, goes in with it
+        // as one insert and one redraw.
         if (ch >= 32 && ch < 127) {
-            line.insert(cursorPos, 1, ch);
-            cursorPos++;
-            if (cursorPos == line.size()) {
-                std::cout << ch;
-                std::cout.flush();
-            } else {
-                refreshLine(prompt, line, cursorPos);
-            }
+            std::string text = m_keys.readText(ch);
+            line.insert(cursorPos, text);
+            cursorPos += text.size();
+            refreshLine(line, cursorPos);
         }
     }
     
+    m_renderer.finish();
+    m_keys.putBack();
     SetConsoleMode(m_hInput, originalMode);
+    m_completer.cancel();
+    m_pending.active = false;
     
-    if (!line.empty()) {
-        if (m_history.empty() || m_history.back() != line) {
-            m_history.push_back(line);
-        }
-    }
-    
-    return line;
+    return line.str();
 }
 
 }
\ No newline at end of file
@@ -1,5 +1,16 @@
 #pragma once
 #include "common.hpp"
+#include "pathindex.hpp"
+#include "history.hpp"
+#include "histsearch.hpp"
+#include "completer.hpp"
+#include "fuzzy.hpp"
+#include "frecency.hpp"
+#include "suggest.hpp"
+#include "highlight.hpp"
+#include "linebuffer.hpp"
+#include "renderer.hpp"
+#include "inputqueue.hpp"
 
 namespace WaleedShell {
 
@@ -7,20 +18,51 @@ class InputHandler {
 public:
     InputHandler();
     std::string readLine(const std::string& prompt);
-    std::vector<std::string>& getHistory() { return m_history; }
+    void setHistory(HistoryStore* history);
+    void setExecutableIndex(ExecutableIndex* index);
+    void setCommandCheck(std::function<bool(const std::string&)> check) { m_highlighter.setCommandCheck(std::move(check)); }
     
 private:
-    std::vector<std::string> m_history;
-    size_t m_historyIndex;
+    // The Tab press whose candidates are still arriving from m_completer.
+    // The last component of the word is a fuzzy query over them. Until
+    // the deadline results are held back so a quick, unambiguous answer
+    // completes in place; otherwise the selection menu opens and keeps
+    // taking batches while it is up.
+    struct PendingCompletion {
+        bool active = false;
+        uint64_t id = 0;
+        size_t wordStart = 0;
+        size_t queryStart = 0;
+        std::string query;
+        ULONGLONG deadline = 0;
+        size_t received = 0;
+        bool done = false;
+    };
+    
+    HistoryStore* m_history;
+    std::unique_ptr<HistorySearch> m_search;
     HANDLE m_hInput;
-    HANDLE m_hOutput;
+    InputQueue m_keys;
+    LineRenderer m_renderer;
+    ExecutableIndex* m_executables;
+    CompletionWorker m_completer;
+    PendingCompletion m_pending;
+    FuzzyMatcher m_matcher;
+    std::unique_ptr<Frecency> m_frecency;
+    std::unique_ptr<HistorySuggest> m_suggest;
+    Highlighter m_highlighter;
+    std::string m_currentDir;
+    std::string m_hint;
+    
+    void refreshLine(const GapBuffer& line, size_t cursorPos);
     
-    void clearLine(size_t promptLen, size_t lineLen);
-    void refreshLine(const std::string& prompt, const std::string& line, size_t cursorPos);
+    bool reverseSearch(GapBuffer& line, size_t& cursorPos);
     
-    std::vector<std::string> getCompletions(const std::string& partial);
-    std::vector<std::string> getPathCompletions(const std::string& partial);
-    std::vector<std::string> getExecutableCompletions(const std::string& partial);
+    void startCompletion(const GapBuffer& line, size_t cursorPos);
+    bool receiveCompletions();
+    void serviceCompletion(GapBuffer& line, size_t& cursorPos);
+    void completionMenu(GapBuffer& line, size_t& cursorPos);
+    int completionBoost(const std::string& candidate) const;
     std::string getCommonPrefix(const std::vector<std::string>& strings);
 };
 
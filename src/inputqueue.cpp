@@ -0,0 +1,84 @@
+#include "inputqueue.hpp"
+
+namespace WaleedShell {
+
+// Events taken per ReadConsoleInputA call.
+static const DWORD INPUT_BATCH = 256;
+
+// Appends the next batch. Without `wait` it returns false rather than
+// block when the console has nothing queued.
+bool InputQueue::fill(bool wait) {
+    DWORD waiting = 0;
+    if (!wait && (!GetNumberOfConsoleInputEvents(m_input, &waiting) || waiting == 0)) {
+        return false;
+    }
+
+    m_records.erase(m_records.begin(), m_records.begin() + m_next);
+    m_next = 0;
+    size_t used = m_records.size();
+    m_records.resize(used + INPUT_BATCH);
+
+    DWORD read = 0;
+    if (!ReadConsoleInputA(m_input, m_records.data() + used, INPUT_BATCH, &read)) {
+        read = 0;
+    }
+    m_records.resize(used + read);
+    return read > 0;
+}
+
+bool InputQueue::read(INPUT_RECORD& record) {
+    if (!buffered() && !fill(true)) return false;
+    record = m_records[m_next++];
+    return true;
+}
+
+std::string InputQueue::readText(char first) {
+    std::string text(1, first);
+    size_t ahead = 0;
+    size_t tabs = 0;
+
+    while (true) {
+        if (m_next + ahead >= m_records.size() && !fill(false)) break;
+
+        const INPUT_RECORD& record = m_records[m_next + ahead];
+        if (record.EventType != KEY_EVENT) {
+            ++ahead;
+            continue;
+        }
+        const KEY_EVENT_RECORD& key = record.Event.KeyEvent;
+        WORD vk = key.wVirtualKeyCode;
+        char ch = key.uChar.AsciiChar;
+        if (!key.bKeyDown || vk == VK_SHIFT || vk == VK_CONTROL || vk == VK_MENU) {
+            ++ahead;
+            continue;
+        }
+        if (ch == '\t') {
+            ++tabs;
+            ++ahead;
+            continue;
+        }
+        if (ch < 32 || ch >= 127) break;
+
+        text.append(tabs, ' ');
+        text += ch;
+        tabs = 0;
+        m_next += ahead + 1;
+        ahead = 0;
+    }
+    return text;
+}
+
+void InputQueue::putBack() {
+    if (!buffered()) return;
+
+    // Whatever is still queued goes back after what was read ahead, to
+    // keep the order.
+    while (fill(false)) {
+    }
+    DWORD written;
+    WriteConsoleInputA(m_input, m_records.data() + m_next, (DWORD)(m_records.size() - m_next), &written);
+    m_records.clear();
+    m_next = 0;
+}
+
+}
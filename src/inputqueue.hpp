@@ -0,0 +1,37 @@
+#pragma once
+#include "common.hpp"
+
+namespace WaleedShell {
+
+// Console input read in batches: one ReadConsoleInputA call takes every
+// event already queued, up to a few hundred, and the line editor works
+// through them from memory. readText() turns a run of queued printable
+// keys into one string, so a paste (which the console delivers as
+// thousands of key events at once) is inserted and redrawn once, and Tabs
+// inside it stay text instead of starting a completion.
+class InputQueue {
+public:
+    explicit InputQueue(HANDLE input) : m_input(input), m_next(0) {}
+
+    // True when events are waiting here, where waiting on the console
+    // handle would not see them.
+    bool buffered() const { return m_next < m_records.size(); }
+    // Blocks for the next event.
+    bool read(INPUT_RECORD& record);
+    // `first` followed by the printable keys queued right behind it. Key
+    // releases and modifier keys in between are skipped; a Tab counts,
+    // as a space, only when more text follows it.
+    std::string readText(char first);
+    // Hands events read ahead but not used back to the console, so a
+    // program started by the line that just ended can read them.
+    void putBack();
+
+private:
+    HANDLE m_input;
+    std::vector<INPUT_RECORD> m_records;
+    size_t m_next;
+
+    bool fill(bool wait);
+};
+
+}
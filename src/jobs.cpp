@@ -0,0 +1,156 @@
+#include "jobs.hpp"
+
+namespace WaleedShell {
+
+JobTable::JobTable() : m_stopping(false), m_nextId(1) {
+    m_wake = CreateEventA(NULL, FALSE, FALSE, NULL);
+    m_reaper = std::thread(&JobTable::reapLoop, this);
+}
+
+JobTable::~JobTable() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    SetEvent(m_wake);
+    m_reaper.join();
+    
+    for (auto& t : m_tracked) {
+        CloseHandle(t.process);
+    }
+    CloseHandle(m_wake);
+}
+
+JobInfo* JobTable::findJob(int id) {
+    for (auto& job : m_jobs) {
+        if (job.id == id) return &job;
+    }
+    return nullptr;
+}
+
+void JobTable::reapLoop() {
+    std::vector<HANDLE> handles;
+    
+    while (true) {
+        bool overflow;
+        handles.assign(1, m_wake);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stopping) return;
+            for (const auto& t : m_tracked) {
+                if (handles.size() == MAXIMUM_WAIT_OBJECTS) break;
+                handles.push_back(t.process);
+            }
+            overflow = m_tracked.size() >= MAXIMUM_WAIT_OBJECTS;
+        }
+        
+        // Past 63 live processes the rest are picked up by a periodic sweep.
+        DWORD result = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(),
+                                              FALSE, overflow ? 100 : INFINITE);
+        if (result == WAIT_FAILED) {
+            Sleep(100);
+        }
+        
+        std::lock_guard<std::mutex> lock(m_mutex);
+        bool changed = false;
+        for (auto it = m_tracked.begin(); it != m_tracked.end();) {
+            if (WaitForSingleObject(it->process, 0) != WAIT_OBJECT_0) {
+                ++it;
+                continue;
+            }
+            
+            DWORD exitCode = 0;
+            GetExitCodeProcess(it->process, &exitCode);
+            CloseHandle(it->process);
+            
+            if (JobInfo* job = findJob(it->jobId)) {
+                if (it->last) job->exitCode = static_cast<int>(exitCode);
+                bool running = false;
+                for (const auto& other : m_tracked) {
+                    if (&other != &*it && other.jobId == it->jobId) running = true;
+                }
+                job->done = !running;
+            }
+            it = m_tracked.erase(it);
+            changed = true;
+        }
+        if (changed) {
+            m_changed.notify_all();
+        }
+    }
+}
+
+int JobTable::add(const std::string& command, const std::vector<HANDLE>& processes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    JobInfo job;
+    job.id = m_nextId++;
+    job.command = command;
+    job.done = processes.empty();
+    job.exitCode = 0;
+    for (size_t i = 0; i < processes.size(); ++i) {
+        job.pids.push_back(GetProcessId(processes[i]));
+        m_tracked.push_back({processes[i], job.id, i + 1 == processes.size()});
+    }
+    m_jobs.push_back(job);
+    
+    SetEvent(m_wake);
+    return job.id;
+}
+
+std::vector<JobInfo> JobTable::list() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_jobs;
+}
+
+std::vector<JobInfo> JobTable::takeFinished() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<JobInfo> finished;
+    for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+        if (it->done) {
+            finished.push_back(*it);
+            it = m_jobs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (m_jobs.empty()) {
+        m_nextId = 1;
+    }
+    return finished;
+}
+
+bool JobTable::contains(int id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return findJob(id) != nullptr;
+}
+
+int JobTable::latest() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_jobs.empty() ? 0 : m_jobs.back().id;
+}
+
+int JobTable::wait(int id) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_changed.wait(lock, [&] {
+        JobInfo* job = findJob(id);
+        return !job || job->done;
+    });
+    
+    JobInfo* job = findJob(id);
+    if (!job) return 127;
+    
+    int exitCode = job->exitCode;
+    m_jobs.erase(m_jobs.begin() + (job - m_jobs.data()));
+    return exitCode;
+}
+
+int JobTable::waitAll() {
+    int exitCode = 0;
+    for (const auto& job : list()) {
+        exitCode = wait(job.id);
+    }
+    return exitCode;
+}
+
+}
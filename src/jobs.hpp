@@ -0,0 +1,55 @@
+#pragma once
+#include "common.hpp"
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+namespace WaleedShell {
+
+struct JobInfo {
+    int id;
+    std::string command;
+    std::vector<DWORD> pids;
+    bool done;
+    int exitCode;
+};
+
+// Table of background pipelines. A single reaper thread waits on every
+// job's process handles at once, records exit codes and closes the
+// handles as soon as each process ends, so the prompt never blocks.
+class JobTable {
+public:
+    JobTable();
+    ~JobTable();
+    JobTable(const JobTable&) = delete;
+    JobTable& operator=(const JobTable&) = delete;
+
+    int add(const std::string& command, const std::vector<HANDLE>& processes);
+    std::vector<JobInfo> list();
+    std::vector<JobInfo> takeFinished();
+    bool contains(int id);
+    int latest();
+    int wait(int id);
+    int waitAll();
+
+private:
+    struct Tracked {
+        HANDLE process;
+        int jobId;
+        bool last;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::vector<JobInfo> m_jobs;
+    std::vector<Tracked> m_tracked;
+    HANDLE m_wake;
+    bool m_stopping;
+    int m_nextId;
+    std::thread m_reaper;
+
+    void reapLoop();
+    JobInfo* findJob(int id);
+};
+
+}
@@ -0,0 +1,112 @@
+#include "launcher.hpp"
+
+namespace WaleedShell {
+
+ProcessLauncher::ProcessLauncher() : m_handleListSupported(true) {
+    SIZE_T size = 0;
+    InitializeProcThreadAttributeList(NULL, 1, 0, &size);
+    if (size == 0) {
+        m_handleListSupported = false;
+    } else {
+        m_attributeBuffer.resize(size);
+    }
+}
+
+ProcessLauncher::~ProcessLauncher() {}
+
+static bool usesImagePath(const std::string& path) {
+    if (path.size() < 4) return false;
+    std::string ext = path.substr(path.size() - 4);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".exe" || ext == ".com";
+}
+
+// `listRejected` is set when the handle list itself could not be built,
+// as opposed to CreateProcess failing for the program.
+bool ProcessLauncher::create(const LaunchSpec& spec, LaunchedProcess& result, bool restrictHandles,
+                             bool& listRejected) {
+    STARTUPINFOEXA si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    ZeroMemory(&pi, sizeof(pi));
+    listRejected = false;
+    // With EXTENDED_STARTUPINFO_PRESENT, CreateProcess requires the size
+    // of the extended structure.
+    si.StartupInfo.cb = sizeof(si);
+    si.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+    si.StartupInfo.hStdInput = spec.stdInput;
+    si.StartupInfo.hStdOutput = spec.stdOutput;
+    si.StartupInfo.hStdError = spec.stdError;
+    
+    DWORD flags = 0;
+    HANDLE inherit[3];
+    DWORD inheritCount = 0;
+    LPPROC_THREAD_ATTRIBUTE_LIST attributes = NULL;
+    
+    if (restrictHandles) {
+        for (HANDLE h : {spec.stdInput, spec.stdOutput, spec.stdError}) {
+            DWORD info = 0;
+            if (!h || h == INVALID_HANDLE_VALUE) continue;
+            if (!GetHandleInformation(h, &info) || !(info & HANDLE_FLAG_INHERIT)) continue;
+            if (std::find(inherit, inherit + inheritCount, h) != inherit + inheritCount) continue;
+            inherit[inheritCount++] = h;
+        }
+    }
+    
+    if (inheritCount > 0) {
+        attributes = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(m_attributeBuffer.data());
+        SIZE_T size = m_attributeBuffer.size();
+        if (!InitializeProcThreadAttributeList(attributes, 1, 0, &size)) {
+            listRejected = true;
+            return false;
+        }
+        if (!UpdateProcThreadAttribute(attributes, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
+                                       inherit, inheritCount * sizeof(HANDLE), NULL, NULL)) {
+            DeleteProcThreadAttributeList(attributes);
+            listRejected = true;
+            return false;
+        }
+        si.lpAttributeList = attributes;
+        flags |= EXTENDED_STARTUPINFO_PRESENT;
+    }
+    
+    std::string cmdLine = spec.commandLine;
+    BOOL success = CreateProcessA(
+        usesImagePath(spec.imagePath) ? spec.imagePath.c_str() : NULL,
+        cmdLine.data(),
+        NULL,
+        NULL,
+        inheritCount > 0 || !restrictHandles,
+        flags,
+        NULL,
+        NULL,
+        &si.StartupInfo,
+        &pi
+    );
+    
+    if (attributes) {
+        DeleteProcThreadAttributeList(attributes);
+    }
+    if (!success) return false;
+    
+    CloseHandle(pi.hThread);
+    result.process = pi.hProcess;
+    result.pid = pi.dwProcessId;
+    return true;
+}
+
+bool ProcessLauncher::launch(const LaunchSpec& spec, LaunchedProcess& result) {
+    bool listRejected = false;
+    if (m_handleListSupported) {
+        if (create(spec, result, true, listRejected)) return true;
+        
+        // Only a handle list the system will not build means the feature
+        // is unavailable; fall back to plain inheritance for good then.
+        // Any other failure is the program's and is reported as such.
+        if (!listRejected) return false;
+        m_handleListSupported = false;
+    }
+    return create(spec, result, false, listRejected);
+}
+
+}
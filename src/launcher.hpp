@@ -0,0 +1,40 @@
+#pragma once
+#include "common.hpp"
+
+namespace WaleedShell {
+
+struct LaunchSpec {
+    std::string imagePath;
+    std::string commandLine;
+    HANDLE stdInput = NULL;
+    HANDLE stdOutput = NULL;
+    HANDLE stdError = NULL;
+};
+
+struct LaunchedProcess {
+    HANDLE process = NULL;
+    DWORD pid = 0;
+};
+
+// The one place the executor creates processes. Children inherit exactly
+// their three standard handles through PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
+// never the shell's other inheritable pipe ends, so a long-running job
+// cannot hold a later pipeline's pipe open. When the image path is known
+// it is passed directly and CreateProcess skips its own search.
+class ProcessLauncher {
+public:
+    ProcessLauncher();
+    ~ProcessLauncher();
+    ProcessLauncher(const ProcessLauncher&) = delete;
+    ProcessLauncher& operator=(const ProcessLauncher&) = delete;
+
+    bool launch(const LaunchSpec& spec, LaunchedProcess& result);
+
+private:
+    std::vector<BYTE> m_attributeBuffer;
+    bool m_handleListSupported;
+
+    bool create(const LaunchSpec& spec, LaunchedProcess& result, bool restrictHandles, bool& listRejected);
+};
+
+}
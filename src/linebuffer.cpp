@@ -0,0 +1,79 @@
+#include "linebuffer.hpp"
+
+namespace WaleedShell {
+
+// Smallest gap worth allocating; grows by doubling after that.
+static const size_t MIN_GAP = 64;
+
+void GapBuffer::moveGap(size_t pos) {
+    if (pos < m_gapStart) {
+        size_t count = m_gapStart - pos;
+        std::memmove(m_data.data() + m_gapEnd - count, m_data.data() + pos, count);
+        m_gapStart -= count;
+        m_gapEnd -= count;
+    } else if (pos > m_gapStart) {
+        size_t count = pos - m_gapStart;
+        std::memmove(m_data.data() + m_gapStart, m_data.data() + m_gapEnd, count);
+        m_gapStart += count;
+        m_gapEnd += count;
+    }
+}
+
+void GapBuffer::reserveGap(size_t needed) {
+    if (m_gapEnd - m_gapStart >= needed) return;
+
+    size_t tail = m_data.size() - m_gapEnd;
+    size_t capacity = std::max(m_data.size() * 2, size() + std::max(needed, MIN_GAP));
+    std::vector<char> grown(capacity);
+    std::memcpy(grown.data(), m_data.data(), m_gapStart);
+    std::memcpy(grown.data() + capacity - tail, m_data.data() + m_gapEnd, tail);
+    m_data.swap(grown);
+    m_gapEnd = capacity - tail;
+}
+
+void GapBuffer::insert(size_t pos, char c) {
+    moveGap(std::min(pos, size()));
+    reserveGap(1);
+    m_data[m_gapStart++] = c;
+}
+
+void GapBuffer::insert(size_t pos, const std::string& text) {
+    moveGap(std::min(pos, size()));
+    reserveGap(text.size());
+    std::memcpy(m_data.data() + m_gapStart, text.data(), text.size());
+    m_gapStart += text.size();
+}
+
+void GapBuffer::erase(size_t pos, size_t count) {
+    if (pos >= size()) return;
+    moveGap(pos);
+    m_gapEnd += std::min(count, m_data.size() - m_gapEnd);
+}
+
+void GapBuffer::assign(const std::string& text) {
+    m_data.assign(text.begin(), text.end());
+    m_gapStart = m_gapEnd = m_data.size();
+}
+
+std::string GapBuffer::str() const {
+    std::string text;
+    text.reserve(size());
+    text.append(m_data.data(), m_gapStart);
+    text.append(m_data.data() + m_gapEnd, m_data.size() - m_gapEnd);
+    return text;
+}
+
+std::string GapBuffer::substr(size_t pos, size_t count) const {
+    size_t end = size();
+    if (pos >= end) return std::string();
+    if (count < end - pos) end = pos + count;
+
+    std::string text;
+    text.reserve(end - pos);
+    for (size_t i = pos; i < end; ++i) {
+        text += (*this)[i];
+    }
+    return text;
+}
+
+}
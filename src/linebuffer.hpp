@@ -0,0 +1,39 @@
+#pragma once
+#include "common.hpp"
+
+namespace WaleedShell {
+
+// The line being edited, kept as a gap buffer: the free space sits at the
+// last edit position, so typing or deleting there moves nothing and an
+// edit elsewhere moves only the text between the two positions. A pasted
+// multi-KB line stays cheap to edit in the middle.
+class GapBuffer {
+public:
+    GapBuffer() : m_gapStart(0), m_gapEnd(0) {}
+    explicit GapBuffer(const std::string& text) : GapBuffer() { assign(text); }
+
+    size_t size() const { return m_data.size() - (m_gapEnd - m_gapStart); }
+    bool empty() const { return size() == 0; }
+    char operator[](size_t pos) const {
+        return pos < m_gapStart ? m_data[pos] : m_data[pos + (m_gapEnd - m_gapStart)];
+    }
+
+    void insert(size_t pos, char c);
+    void insert(size_t pos, const std::string& text);
+    void erase(size_t pos, size_t count);
+    void assign(const std::string& text);
+    void clear() { assign(std::string()); }
+
+    std::string str() const;
+    std::string substr(size_t pos, size_t count = std::string::npos) const;
+
+private:
+    std::vector<char> m_data;
+    size_t m_gapStart;
+    size_t m_gapEnd;
+
+    void moveGap(size_t pos);
+    void reserveGap(size_t needed);
+};
+
+}
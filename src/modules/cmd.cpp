@@ -0,0 +1,351 @@
+#include "cmd.hpp"
+
+namespace WaleedShell {
+
+static std::string toLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+    return text;
+}
+
+static std::string joinArgs(const std::vector<std::string>& args) {
+    std::string text;
+    for (const auto& arg : args) {
+        if (!text.empty()) text += " ";
+        text += arg;
+    }
+    return text;
+}
+
+static bool hasWildcard(const std::string& path) {
+    return path.find_first_of("*?") != std::string::npos;
+}
+
+static bool isDirectory(const std::string& path) {
+    DWORD attr = GetFileAttributesA(path.c_str());
+    return attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+static std::string fullPath(const std::string& path) {
+    char buffer[MAX_PATH];
+    DWORD len = GetFullPathNameA(path.c_str(), MAX_PATH, buffer, NULL);
+    return (len > 0 && len < MAX_PATH) ? std::string(buffer, len) : path;
+}
+
+// A destination naming a directory receives the source's file name.
+static std::string targetPath(const std::string& src, const std::string& dst) {
+    if (!isDirectory(dst)) return dst;
+    size_t slash = src.find_last_of("\\/:");
+    std::string name = (slash == std::string::npos) ? src : src.substr(slash + 1);
+    char last = dst.empty() ? '\\' : dst.back();
+    return (last == '\\' || last == '/') ? dst + name : dst + "\\" + name;
+}
+
+// Splits "/B /s file" into lower-case switches and operands.
+static void splitArgs(const std::vector<std::string>& args,
+                      std::vector<std::string>& switches, std::vector<std::string>& operands) {
+    for (const auto& arg : args) {
+        if (arg.size() > 1 && arg[0] == '/') {
+            switches.push_back(toLower(arg));
+        } else {
+            operands.push_back(arg);
+        }
+    }
+}
+
+static bool onlySwitches(const std::vector<std::string>& switches, std::initializer_list<const char*> allowed) {
+    for (const auto& sw : switches) {
+        bool known = false;
+        for (const char* name : allowed) {
+            if (sw == name) known = true;
+        }
+        if (!known) return false;
+    }
+    return true;
+}
+
+static bool hasSwitch(const std::vector<std::string>& switches, const char* name) {
+    return std::find(switches.begin(), switches.end(), name) != switches.end();
+}
+
+CmdManager::CmdManager(FileManager& files, SystemInfoManager& sysInfo)
+    : m_files(files), m_sysInfo(sysInfo) {}
+
+bool CmdManager::supports(const std::string& program, const std::vector<std::string>& args) {
+    std::string name = toLower(program);
+    std::vector<std::string> switches, operands;
+    splitArgs(args, switches, operands);
+    if (hasSwitch(switches, "/?")) return false;
+    
+    auto anyWildcard = [&operands]() {
+        return std::any_of(operands.begin(), operands.end(), hasWildcard);
+    };
+    
+    if (name == "echo") {
+        // Bare `echo`, `echo on` and `echo off` report or change cmd's own
+        // echo state, which only exists inside cmd.
+        if (args.empty()) return false;
+        std::string first = toLower(args[0]);
+        return !(args.size() == 1 && (first == "on" || first == "off"));
+    }
+    if (name == "type") {
+        return switches.empty() && !operands.empty() && !anyWildcard();
+    }
+    if (name == "dir") {
+        return onlySwitches(switches, {"/b", "/s"}) && operands.size() <= 1 && !anyWildcard();
+    }
+    if (name == "copy" || name == "move") {
+        if (!onlySwitches(switches, {"/y"}) || operands.size() != 2 || anyWildcard()) return false;
+        if (name == "copy" && operands[0].find('+') != std::string::npos) return false;
+        // Without /Y cmd asks before replacing a file; let it.
+        return hasSwitch(switches, "/y") || !m_files.fileExists(targetPath(operands[0], operands[1]));
+    }
+    if (name == "del" || name == "erase") {
+        if (!onlySwitches(switches, {"/q", "/f"}) || operands.empty() || anyWildcard()) return false;
+        return std::none_of(operands.begin(), operands.end(), isDirectory);
+    }
+    if (name == "ren" || name == "rename") {
+        return switches.empty() && operands.size() == 2 && !anyWildcard() &&
+               operands[1].find_first_of("\\/:") == std::string::npos;
+    }
+    if (name == "md") {
+        return switches.empty() && !operands.empty();
+    }
+    if (name == "rd") {
+        if (!onlySwitches(switches, {"/s", "/q"}) || operands.empty()) return false;
+        return !hasSwitch(switches, "/s") || hasSwitch(switches, "/q");
+    }
+    if (name == "set") {
+        return switches.empty();
+    }
+    if (name == "ver") {
+        return args.empty();
+    }
+    if (name == "title" || name == "path") {
+        return true;
+    }
+    return false;
+}
+
+int CmdManager::run(const std::string& program, const std::vector<std::string>& args, std::ostream& out) {
+    std::string name = toLower(program);
+    std::vector<std::string> switches, operands;
+    splitArgs(args, switches, operands);
+    
+    if (name == "echo") return echo(args, out);
+    if (name == "type") return type(operands, out);
+    if (name == "dir") return dir(operands, hasSwitch(switches, "/b"), hasSwitch(switches, "/s"), out);
+    if (name == "copy") return copy(operands[0], operands[1], out);
+    if (name == "move") return move(operands[0], operands[1], out);
+    if (name == "del" || name == "erase") return del(operands, hasSwitch(switches, "/f"));
+    if (name == "ren" || name == "rename") return ren(operands[0], operands[1]);
+    if (name == "md") return md(operands);
+    if (name == "rd") return rd(operands, hasSwitch(switches, "/s"));
+    if (name == "set") return set(args, out);
+    if (name == "path") return path(args, out);
+    if (name == "ver") {
+        out << "\nMicrosoft " << m_sysInfo.getSystemInfo().osVersion << "\n\n";
+        return 0;
+    }
+    if (name == "title") {
+        SetConsoleTitleA(joinArgs(args).c_str());
+        return 0;
+    }
+    return 1;
+}
+
+int CmdManager::echo(const std::vector<std::string>& args, std::ostream& out) {
+    out << joinArgs(args) << "\n";
+    return 0;
+}
+
+int CmdManager::type(const std::vector<std::string>& paths, std::ostream& out) {
+    int status = 0;
+    for (const auto& path : paths) {
+        bool read = m_files.streamFile(path, [&out](const char* data, size_t size) {
+            out.write(data, static_cast<std::streamsize>(size));
+            return static_cast<bool>(out);
+        });
+        if (!read) {
+            std::cerr << "The system cannot find the file specified: " << path << "\n";
+            status = 1;
+        }
+        if (!out) break;
+    }
+    return status;
+}
+
+int CmdManager::dir(const std::vector<std::string>& paths, bool bare, bool recursive, std::ostream& out) {
+    std::string root = paths.empty() ? "." : paths[0];
+    if (!isDirectory(root)) {
+        std::cerr << "File Not Found\n";
+        return 1;
+    }
+    std::string base = fullPath(root);
+    
+    if (!bare) out << "\n Directory of " << base << "\n\n";
+    
+    unsigned long long fileCount = 0, dirCount = 0, totalBytes = 0;
+    m_files.walkDirectory(root, recursive, [&](const FileInfo& file) {
+        if (bare) {
+            out << (recursive ? fullPath(file.path) : file.name) << "\n";
+        } else {
+            out << m_files.formatTime(file.modified) << "    ";
+            if (file.isDirectory) {
+                out << std::left << std::setw(14) << "<DIR>";
+            } else {
+                out << std::right << std::setw(13) << file.size.QuadPart << " ";
+            }
+            out << (recursive ? fullPath(file.path) : file.name) << "\n";
+        }
+        
+        if (file.isDirectory) {
+            ++dirCount;
+        } else {
+            ++fileCount;
+            totalBytes += static_cast<unsigned long long>(file.size.QuadPart);
+        }
+        return static_cast<bool>(out);
+    });
+    
+    if (!bare) {
+        out << std::right << std::setw(16) << fileCount << " File(s) " << totalBytes << " bytes\n";
+        out << std::right << std::setw(16) << dirCount << " Dir(s)\n";
+    }
+    return 0;
+}
+
+int CmdManager::copy(const std::string& src, const std::string& dst, std::ostream& out) {
+    if (!m_files.copyFile(src, targetPath(src, dst), true)) {
+        std::cerr << "Error: Cannot copy '" << src << "' to '" << dst << "'\n";
+        out << "        0 file(s) copied.\n";
+        return 1;
+    }
+    out << "        1 file(s) copied.\n";
+    return 0;
+}
+
+int CmdManager::move(const std::string& src, const std::string& dst, std::ostream& out) {
+    if (!m_files.moveFile(src, targetPath(src, dst), true)) {
+        std::cerr << "Error: Cannot move '" << src << "' to '" << dst << "'\n";
+        out << "        0 file(s) moved.\n";
+        return 1;
+    }
+    out << "        1 file(s) moved.\n";
+    return 0;
+}
+
+int CmdManager::del(const std::vector<std::string>& paths, bool force) {
+    int status = 0;
+    for (const auto& path : paths) {
+        if (force) {
+            DWORD attr = GetFileAttributesA(path.c_str());
+            if (attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_READONLY)) {
+                SetFileAttributesA(path.c_str(), attr & ~FILE_ATTRIBUTE_READONLY);
+            }
+        }
+        if (!m_files.deleteFile(path)) {
+            if (m_files.fileExists(path)) {
+                std::cerr << "Access is denied: " << fullPath(path) << "\n";
+            } else {
+                std::cerr << "Could Not Find " << fullPath(path) << "\n";
+            }
+            status = 1;
+        }
+    }
+    return status;
+}
+
+int CmdManager::ren(const std::string& src, const std::string& name) {
+    size_t slash = src.find_last_of("\\/:");
+    std::string dst = (slash == std::string::npos) ? name : src.substr(0, slash + 1) + name;
+    if (!m_files.moveFile(src, dst)) {
+        std::cerr << "Error: Cannot rename '" << src << "' to '" << name << "'\n";
+        return 1;
+    }
+    return 0;
+}
+
+int CmdManager::md(const std::vector<std::string>& paths) {
+    int status = 0;
+    for (const auto& path : paths) {
+        std::error_code ec;
+        if (std::filesystem::exists(path, ec)) {
+            std::cerr << "A subdirectory or file " << path << " already exists.\n";
+            status = 1;
+        } else if (!std::filesystem::create_directories(path, ec)) {
+            std::cerr << "Error: Cannot create directory '" << path << "'\n";
+            status = 1;
+        }
+    }
+    return status;
+}
+
+int CmdManager::rd(const std::vector<std::string>& paths, bool recursive) {
+    int status = 0;
+    for (const auto& path : paths) {
+        if (!m_files.deleteDirectory(path, recursive)) {
+            std::cerr << (m_files.fileExists(path) ? "The directory is not empty: "
+                                                   : "The system cannot find the file specified: ")
+                      << path << "\n";
+            status = 1;
+        }
+    }
+    return status;
+}
+
+// `set` lists, `set prefix` filters, `set name=value` assigns and
+// `set name=` removes; all of it now applies to the shell itself.
+int CmdManager::set(const std::vector<std::string>& args, std::ostream& out) {
+    std::string text = joinArgs(args);
+    size_t eq = text.find('=');
+    
+    if (eq != std::string::npos && eq > 0) {
+        std::string name = text.substr(0, eq);
+        std::string value = text.substr(eq + 1);
+        SetEnvironmentVariableA(name.c_str(), value.empty() ? NULL : value.c_str());
+        return 0;
+    }
+    
+    std::vector<std::string> vars;
+    char* env = GetEnvironmentStringsA();
+    if (env) {
+        for (char* ptr = env; *ptr; ptr += strlen(ptr) + 1) {
+            if (*ptr == '=') continue;
+            if (_strnicmp(ptr, text.c_str(), text.size()) == 0) vars.push_back(ptr);
+        }
+        FreeEnvironmentStringsA(env);
+    }
+    
+    if (vars.empty()) {
+        std::cerr << "Environment variable " << text << " not defined\n";
+        return 1;
+    }
+    std::sort(vars.begin(), vars.end(), [](const std::string& a, const std::string& b) {
+        return _stricmp(a.c_str(), b.c_str()) < 0;
+    });
+    for (const auto& var : vars) {
+        out << var << "\n";
+    }
+    return 0;
+}
+
+int CmdManager::path(const std::vector<std::string>& args, std::ostream& out) {
+    if (args.empty()) {
+        DWORD size = GetEnvironmentVariableA("PATH", NULL, 0);
+        if (size == 0) {
+            out << "No Path\n";
+            return 0;
+        }
+        std::string value(size, '\0');
+        value.resize(GetEnvironmentVariableA("PATH", &value[0], size));
+        out << "PATH=" << value << "\n";
+        return 0;
+    }
+    
+    std::string value = joinArgs(args);
+    if (value.rfind("=", 0) == 0) value.erase(0, 1);
+    SetEnvironmentVariableA("PATH", value == ";" ? NULL : value.c_str());
+    return 0;
+}
+
+}
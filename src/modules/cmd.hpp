@@ -0,0 +1,35 @@
+#pragma once
+#include "common.hpp"
+#include "files.hpp"
+#include "sysinfo.hpp"
+
+namespace WaleedShell {
+
+// In-process versions of the cmd.exe internal commands. supports() only
+// accepts the forms implemented here; anything else (unknown switches,
+// wildcards, /?, or a copy that would have to prompt) is left to
+// `cmd.exe /c` so behaviour never silently differs from cmd.
+class CmdManager {
+public:
+    CmdManager(FileManager& files, SystemInfoManager& sysInfo);
+    bool supports(const std::string& program, const std::vector<std::string>& args);
+    int run(const std::string& program, const std::vector<std::string>& args, std::ostream& out);
+
+private:
+    FileManager& m_files;
+    SystemInfoManager& m_sysInfo;
+
+    int echo(const std::vector<std::string>& args, std::ostream& out);
+    int type(const std::vector<std::string>& paths, std::ostream& out);
+    int dir(const std::vector<std::string>& paths, bool bare, bool recursive, std::ostream& out);
+    int copy(const std::string& src, const std::string& dst, std::ostream& out);
+    int move(const std::string& src, const std::string& dst, std::ostream& out);
+    int del(const std::vector<std::string>& paths, bool force);
+    int ren(const std::string& src, const std::string& name);
+    int md(const std::vector<std::string>& paths);
+    int rd(const std::vector<std::string>& paths, bool recursive);
+    int set(const std::vector<std::string>& args, std::ostream& out);
+    int path(const std::vector<std::string>& args, std::ostream& out);
+};
+
+}
@@ -27,13 +27,23 @@ std::string FileManager::formatTime(FILETIME ft) {
 
 std::vector<FileInfo> FileManager::listDirectory(const std::string& path, bool recursive) {
     std::vector<FileInfo> files;
+    walkDirectory(path, recursive, [&files](const FileInfo& info) {
+        files.push_back(info);
+        return true;
+    });
+    return files;
+}
+
+bool FileManager::walkDirectory(const std::string& path, bool recursive,
+                                const std::function<bool(const FileInfo&)>& visit) {
     std::string searchPath = path + "\\*";
     
     WIN32_FIND_DATAA fd;
     HANDLE hFind = FindFirstFileA(searchPath.c_str(), &fd);
     
-    if (hFind == INVALID_HANDLE_VALUE) return files;
+    if (hFind == INVALID_HANDLE_VALUE) return true;
     
+    bool keepGoing = true;
     do {
         std::string name = fd.cFileName;
         if (name == "." || name == "..") continue;
@@ -48,24 +58,27 @@ std::vector<FileInfo> FileManager::listDirectory(const std::string& path, bool r
         info.modified = fd.ftLastWriteTime;
         info.isDirectory = (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
         
-        files.push_back(info);
+        keepGoing = visit(info);
         
-        if (recursive && info.isDirectory) {
-            auto subFiles = listDirectory(info.path, true);
-            files.insert(files.end(), subFiles.begin(), subFiles.end());
+        // Junctions and symlinks are listed but not followed, so a link
+        // back up the tree cannot make the walk endless.
+        if (keepGoing && recursive && info.isDirectory &&
+            !(info.attributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+            keepGoing = walkDirectory(info.path, true, visit);
         }
-    } while (FindNextFileA(hFind, &fd));
+    } while (keepGoing && FindNextFileA(hFind, &fd));
     
     FindClose(hFind);
-    return files;
+    return keepGoing;
 }
 
 bool FileManager::copyFile(const std::string& src, const std::string& dst, bool overwrite) {
     return CopyFileA(src.c_str(), dst.c_str(), !overwrite) != 0;
 }
 
-bool FileManager::moveFile(const std::string& src, const std::string& dst) {
-    return MoveFileA(src.c_str(), dst.c_str()) != 0;
+bool FileManager::moveFile(const std::string& src, const std::string& dst, bool overwrite) {
+    DWORD flags = MOVEFILE_COPY_ALLOWED | (overwrite ? MOVEFILE_REPLACE_EXISTING : 0);
+    return MoveFileExA(src.c_str(), dst.c_str(), flags) != 0;
 }
 
 bool FileManager::deleteFile(const std::string& path) {
@@ -124,14 +137,82 @@ std::string FileManager::readFile(const std::string& path) {
     LARGE_INTEGER size;
     GetFileSizeEx(hFile, &size);
     
+    // A single ReadFile takes a DWORD count, so larger files are read in
+    // pieces rather than silently truncated at 4 GB.
     std::string content(static_cast<size_t>(size.QuadPart), '\0');
-    DWORD read;
-    ReadFile(hFile, &content[0], static_cast<DWORD>(size.QuadPart), &read, NULL);
+    size_t total = 0;
+    while (total < content.size()) {
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(content.size() - total, 1u << 30));
+        DWORD read = 0;
+        if (!ReadFile(hFile, &content[total], chunk, &read, NULL) || read == 0) break;
+        total += read;
+    }
+    content.resize(total);
     CloseHandle(hFile);
     
     return content;
 }
 
+// Reads the file in 1 MB chunks with one overlapped read always in flight,
+// so the disk is fetching the next chunk while the caller writes out the
+// current one. Memory stays at two chunks whatever the file size. The
+// callback returns false to stop early.
+bool FileManager::streamFile(const std::string& path, const std::function<bool(const char*, size_t)>& consume) {
+    HANDLE hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                               OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+    
+    const DWORD chunkSize = 1024 * 1024;
+    std::vector<char> buffers[2] = {std::vector<char>(chunkSize), std::vector<char>(chunkSize)};
+    OVERLAPPED requests[2];
+    HANDLE events[2] = {CreateEventA(NULL, TRUE, FALSE, NULL), CreateEventA(NULL, TRUE, FALSE, NULL)};
+    ULONGLONG offset = 0;
+    bool ok = events[0] && events[1];
+    
+    auto issue = [&](int slot) {
+        ZeroMemory(&requests[slot], sizeof(OVERLAPPED));
+        requests[slot].hEvent = events[slot];
+        requests[slot].Offset = static_cast<DWORD>(offset);
+        requests[slot].OffsetHigh = static_cast<DWORD>(offset >> 32);
+        if (ReadFile(hFile, buffers[slot].data(), chunkSize, NULL, &requests[slot])) return true;
+        DWORD error = GetLastError();
+        if (error == ERROR_IO_PENDING) return true;
+        if (error != ERROR_HANDLE_EOF) ok = false;
+        return false;
+    };
+    
+    int slot = 0;
+    bool pending = ok && issue(slot);
+    while (pending) {
+        DWORD bytesRead = 0;
+        pending = false;
+        if (!GetOverlappedResult(hFile, &requests[slot], &bytesRead, TRUE)) {
+            if (GetLastError() != ERROR_HANDLE_EOF) ok = false;
+            break;
+        }
+        if (bytesRead == 0) break;
+        
+        offset += bytesRead;
+        int next = 1 - slot;
+        pending = issue(next);
+        if (!consume(buffers[slot].data(), bytesRead)) break;
+        slot = next;
+    }
+    
+    // The read ahead must finish before its buffer goes away.
+    if (pending) {
+        DWORD ignored = 0;
+        CancelIoEx(hFile, &requests[1 - slot]);
+        GetOverlappedResult(hFile, &requests[1 - slot], &ignored, TRUE);
+    }
+    
+    for (HANDLE event : events) {
+        if (event) CloseHandle(event);
+    }
+    CloseHandle(hFile);
+    return ok;
+}
+
 bool FileManager::writeFile(const std::string& path, const std::string& content, bool append) {
     DWORD access = append ? FILE_APPEND_DATA : GENERIC_WRITE;
     DWORD creation = append ? OPEN_ALWAYS : CREATE_ALWAYS;
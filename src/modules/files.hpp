@@ -16,8 +16,10 @@ struct FileInfo {
 class FileManager {
 public:
     std::vector<FileInfo> listDirectory(const std::string& path, bool recursive = false);
+    bool walkDirectory(const std::string& path, bool recursive,
+                       const std::function<bool(const FileInfo&)>& visit);
     bool copyFile(const std::string& src, const std::string& dst, bool overwrite = false);
-    bool moveFile(const std::string& src, const std::string& dst);
+    bool moveFile(const std::string& src, const std::string& dst, bool overwrite = false);
     bool deleteFile(const std::string& path);
     bool createDirectory(const std::string& path);
     bool deleteDirectory(const std::string& path, bool recursive = false);
@@ -26,6 +28,7 @@ public:
     std::string formatSize(LARGE_INTEGER size);
     std::string formatTime(FILETIME ft);
     std::string readFile(const std::string& path);
+    bool streamFile(const std::string& path, const std::function<bool(const char*, size_t)>& consume);
     bool writeFile(const std::string& path, const std::string& content, bool append = false);
     std::vector<std::string> findFiles(const std::string& pattern);
 };
@@ -0,0 +1,332 @@
+#include "filters.hpp"
+#include <fstream>
+#include <deque>
+
+namespace WaleedShell {
+
+static std::string toLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+    return text;
+}
+
+// Lines coming from Windows programs end in CRLF; the filters work on the
+// text alone and write plain '\n' line endings.
+bool FilterManager::readLine(std::istream& in, std::string& line) {
+    if (!std::getline(in, line)) return false;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    return true;
+}
+
+bool FilterManager::forEachInput(const std::vector<std::string>& files, std::istream& in,
+                                 const std::function<bool(std::istream&)>& visit) {
+    if (files.empty()) {
+        visit(in);
+        return true;
+    }
+    
+    bool ok = true;
+    for (const auto& file : files) {
+        std::ifstream stream(file, std::ios::binary);
+        if (!stream) {
+            std::cerr << "Error: Cannot open '" << file << "'\n";
+            ok = false;
+            continue;
+        }
+        if (!visit(stream)) break;
+    }
+    return ok;
+}
+
+// Accepts "-n N", "-nN" and "-N".
+bool FilterManager::parseCount(const std::vector<std::string>& args, size_t& i, size_t& count) {
+    std::string text;
+    if (args[i] == "-n") {
+        if (i + 1 >= args.size()) return false;
+        text = args[++i];
+    } else if (args[i].rfind("-n", 0) == 0) {
+        text = args[i].substr(2);
+    } else {
+        text = args[i].substr(1);
+    }
+    
+    char* end = nullptr;
+    unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0') return false;
+    count = static_cast<size_t>(value);
+    return true;
+}
+
+int FilterManager::grep(const std::vector<std::string>& args, std::istream& in, std::ostream& out) {
+    bool ignoreCase = false, invert = false, lineNumbers = false, countOnly = false;
+    std::string pattern;
+    bool havePattern = false;
+    std::vector<std::string> files;
+    
+    for (const auto& arg : args) {
+        if (!havePattern && arg.size() > 1 && arg[0] == '-') {
+            for (size_t j = 1; j < arg.size(); ++j) {
+                switch (arg[j]) {
+                    case 'i': ignoreCase = true; break;
+                    case 'v': invert = true; break;
+                    case 'n': lineNumbers = true; break;
+                    case 'c': countOnly = true; break;
+                    default:
+                        std::cerr << "grep: unknown option '-" << arg[j] << "'\n";
+                        return 2;
+                }
+            }
+        } else if (!havePattern) {
+            pattern = arg;
+            havePattern = true;
+        } else {
+            files.push_back(arg);
+        }
+    }
+    
+    if (!havePattern) {
+        std::cerr << "Usage: grep [-ivnc] <text> [file...]\n";
+        return 2;
+    }
+    if (ignoreCase) pattern = toLower(pattern);
+    
+    size_t matches = 0;
+    bool ok = forEachInput(files, in, [&](std::istream& stream) {
+        std::string line;
+        std::string folded;
+        size_t number = 0;
+        while (out && readLine(stream, line)) {
+            ++number;
+            const std::string* haystack = &line;
+            if (ignoreCase) {
+                folded = toLower(line);
+                haystack = &folded;
+            }
+            bool found = haystack->find(pattern) != std::string::npos;
+            if (found == invert) continue;
+            
+            ++matches;
+            if (countOnly) continue;
+            if (lineNumbers) out << number << ":";
+            out << line << "\n";
+        }
+        return static_cast<bool>(out);
+    });
+    
+    if (countOnly) out << matches << "\n";
+    if (!ok) return 2;
+    return matches > 0 ? 0 : 1;
+}
+
+int FilterManager::sort(const std::vector<std::string>& args, std::istream& in, std::ostream& out) {
+    bool reverse = false, numeric = false, unique = false, foldCase = false;
+    std::vector<std::string> files;
+    
+    for (const auto& arg : args) {
+        if (arg.size() > 1 && arg[0] == '-') {
+            for (size_t j = 1; j < arg.size(); ++j) {
+                switch (arg[j]) {
+                    case 'r': reverse = true; break;
+                    case 'n': numeric = true; break;
+                    case 'u': unique = true; break;
+                    case 'f': foldCase = true; break;
+                    default:
+                        std::cerr << "sort: unknown option '-" << arg[j] << "'\n";
+                        return 2;
+                }
+            }
+        } else {
+            files.push_back(arg);
+        }
+    }
+    
+    std::vector<std::string> lines;
+    bool ok = forEachInput(files, in, [&](std::istream& stream) {
+        std::string line;
+        while (readLine(stream, line)) {
+            lines.push_back(std::move(line));
+        }
+        return true;
+    });
+    
+    auto compare = [&](const std::string& a, const std::string& b) -> int {
+        if (numeric) {
+            double x = std::strtod(a.c_str(), nullptr);
+            double y = std::strtod(b.c_str(), nullptr);
+            if (x != y) return x < y ? -1 : 1;
+        }
+        if (foldCase) return _stricmp(a.c_str(), b.c_str());
+        return a.compare(b);
+    };
+    
+    std::stable_sort(lines.begin(), lines.end(), [&](const std::string& a, const std::string& b) {
+        int order = compare(a, b);
+        return reverse ? order > 0 : order < 0;
+    });
+    
+    const std::string* previous = nullptr;
+    for (const auto& line : lines) {
+        if (!out) break;
+        if (unique && previous && compare(*previous, line) == 0) continue;
+        out << line << "\n";
+        previous = &line;
+    }
+    return ok ? 0 : 2;
+}
+
+int FilterManager::uniq(const std::vector<std::string>& args, std::istream& in, std::ostream& out) {
+    bool showCount = false, duplicatesOnly = false, ignoreCase = false;
+    std::vector<std::string> files;
+    
+    for (const auto& arg : args) {
+        if (arg.size() > 1 && arg[0] == '-') {
+            for (size_t j = 1; j < arg.size(); ++j) {
+                switch (arg[j]) {
+                    case 'c': showCount = true; break;
+                    case 'd': duplicatesOnly = true; break;
+                    case 'i': ignoreCase = true; break;
+                    default:
+                        std::cerr << "uniq: unknown option '-" << arg[j] << "'\n";
+                        return 2;
+                }
+            }
+        } else {
+            files.push_back(arg);
+        }
+    }
+    
+    std::string current;
+    size_t count = 0;
+    auto emit = [&]() {
+        if (count == 0 || (duplicatesOnly && count < 2)) return;
+        if (showCount) out << std::setw(7) << count << " ";
+        out << current << "\n";
+    };
+    
+    bool ok = forEachInput(files, in, [&](std::istream& stream) {
+        std::string line;
+        while (out && readLine(stream, line)) {
+            bool same = count > 0 && (ignoreCase ? _stricmp(line.c_str(), current.c_str()) == 0
+                                                 : line == current);
+            if (same) {
+                ++count;
+                continue;
+            }
+            emit();
+            current = std::move(line);
+            count = 1;
+        }
+        return static_cast<bool>(out);
+    });
+    emit();
+    return ok ? 0 : 2;
+}
+
+int FilterManager::head(const std::vector<std::string>& args, std::istream& in, std::ostream& out) {
+    size_t limit = 10;
+    std::vector<std::string> files;
+    
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i].size() > 1 && args[i][0] == '-') {
+            if (!parseCount(args, i, limit)) {
+                std::cerr << "Usage: head [-n count] [file...]\n";
+                return 2;
+            }
+        } else {
+            files.push_back(args[i]);
+        }
+    }
+    
+    bool ok = forEachInput(files, in, [&](std::istream& stream) {
+        std::string line;
+        size_t taken = 0;
+        while (taken < limit && out && readLine(stream, line)) {
+            out << line << "\n";
+            ++taken;
+        }
+        return static_cast<bool>(out);
+    });
+    return ok ? 0 : 2;
+}
+
+int FilterManager::tail(const std::vector<std::string>& args, std::istream& in, std::ostream& out) {
+    size_t limit = 10;
+    std::vector<std::string> files;
+    
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i].size() > 1 && args[i][0] == '-') {
+            if (!parseCount(args, i, limit)) {
+                std::cerr << "Usage: tail [-n count] [file...]\n";
+                return 2;
+            }
+        } else {
+            files.push_back(args[i]);
+        }
+    }
+    
+    bool ok = forEachInput(files, in, [&](std::istream& stream) {
+        std::deque<std::string> window;
+        std::string line;
+        while (readLine(stream, line)) {
+            if (limit == 0) continue;
+            if (window.size() == limit) window.pop_front();
+            window.push_back(std::move(line));
+        }
+        for (const auto& kept : window) {
+            if (!out) break;
+            out << kept << "\n";
+        }
+        return static_cast<bool>(out);
+    });
+    return ok ? 0 : 2;
+}
+
+int FilterManager::wc(const std::vector<std::string>& args, std::istream& in, std::ostream& out) {
+    bool lines = false, words = false, bytes = false;
+    std::vector<std::string> files;
+    
+    for (const auto& arg : args) {
+        if (arg.size() > 1 && arg[0] == '-') {
+            for (size_t j = 1; j < arg.size(); ++j) {
+                switch (arg[j]) {
+                    case 'l': lines = true; break;
+                    case 'w': words = true; break;
+                    case 'c': bytes = true; break;
+                    default:
+                        std::cerr << "wc: unknown option '-" << arg[j] << "'\n";
+                        return 2;
+                }
+            }
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (!lines && !words && !bytes) {
+        lines = words = bytes = true;
+    }
+    
+    unsigned long long lineCount = 0, wordCount = 0, byteCount = 0;
+    bool ok = forEachInput(files, in, [&](std::istream& stream) {
+        char buffer[64 * 1024];
+        bool inWord = false;
+        while (stream.read(buffer, sizeof(buffer)) || stream.gcount() > 0) {
+            std::streamsize count = stream.gcount();
+            byteCount += static_cast<unsigned long long>(count);
+            for (std::streamsize k = 0; k < count; ++k) {
+                char c = buffer[k];
+                if (c == '\n') ++lineCount;
+                bool space = c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+                if (!space && !inWord) ++wordCount;
+                inWord = !space;
+            }
+        }
+        return true;
+    });
+    
+    if (lines) out << std::setw(8) << lineCount;
+    if (words) out << std::setw(8) << wordCount;
+    if (bytes) out << std::setw(8) << byteCount;
+    out << "\n";
+    return ok ? 0 : 2;
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "common.hpp"
+
+namespace WaleedShell {
+
+// Text filters that run inside the shell. Each reads lines from the named
+// files, or from its input stream when none are given, and returns the
+// command's exit status. Filters stop as soon as their output goes bad,
+// and head returns without draining its input, so a downstream stage that
+// finishes early also stops the stages in front of it.
+class FilterManager {
+public:
+    int grep(const std::vector<std::string>& args, std::istream& in, std::ostream& out);
+    int sort(const std::vector<std::string>& args, std::istream& in, std::ostream& out);
+    int uniq(const std::vector<std::string>& args, std::istream& in, std::ostream& out);
+    int head(const std::vector<std::string>& args, std::istream& in, std::ostream& out);
+    int tail(const std::vector<std::string>& args, std::istream& in, std::ostream& out);
+    int wc(const std::vector<std::string>& args, std::istream& in, std::ostream& out);
+
+private:
+    bool readLine(std::istream& in, std::string& line);
+    bool forEachInput(const std::vector<std::string>& files, std::istream& in,
+                      const std::function<bool(std::istream&)>& visit);
+    bool parseCount(const std::vector<std::string>& args, size_t& i, size_t& count);
+};
+
+}
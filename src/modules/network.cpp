@@ -140,7 +140,7 @@ std::vector<ConnectionInfo> NetworkManager::getUdpConnections() {
     return connections;
 }
 
-bool NetworkManager::ping(const std::string& host, DWORD timeout) {
+bool NetworkManager::ping(const std::string& host, std::ostream& out, DWORD timeout) {
     HANDLE hIcmp = IcmpCreateFile();
     if (hIcmp == INVALID_HANDLE_VALUE) return false;
     
@@ -163,12 +163,12 @@ bool NetworkManager::ping(const std::string& host, DWORD timeout) {
     
     if (replies > 0) {
         PICMP_ECHO_REPLY pReply = reinterpret_cast<PICMP_ECHO_REPLY>(replyBuffer.data());
-        std::cout << "Reply from " << ip << ": bytes=" << pReply->DataSize 
+        out << "Reply from " << ip << ": bytes=" << pReply->DataSize 
                   << " time=" << pReply->RoundTripTime << "ms TTL=" << (int)pReply->Options.Ttl << "\n";
         return true;
     }
     
-    std::cout << "Request timed out.\n";
+    out << "Request timed out.\n";
     return false;
 }
 
@@ -190,32 +190,32 @@ std::string NetworkManager::resolve(const std::string& hostname) {
     return "";
 }
 
-void NetworkManager::printAdapters() {
+void NetworkManager::printAdapters(std::ostream& out) {
     auto adapters = getAdapters();
     
-    std::cout << "Network Adapters\n";
-    std::cout << "================\n";
+    out << "Network Adapters\n";
+    out << "================\n";
     
     for (const auto& adapter : adapters) {
-        std::cout << adapter.description << "\n";
-        std::cout << "    MAC:     " << adapter.macAddress << "\n";
-        std::cout << "    IP:      " << adapter.ipAddress << "\n";
-        std::cout << "    Subnet:  " << adapter.subnet << "\n";
-        std::cout << "    Gateway: " << adapter.gateway << "\n";
+        out << adapter.description << "\n";
+        out << "    MAC:     " << adapter.macAddress << "\n";
+        out << "    IP:      " << adapter.ipAddress << "\n";
+        out << "    Subnet:  " << adapter.subnet << "\n";
+        out << "    Gateway: " << adapter.gateway << "\n";
         if (adapter.dhcpEnabled) {
-            std::cout << "    DHCP:    " << adapter.dhcpServer << "\n";
+            out << "    DHCP:    " << adapter.dhcpServer << "\n";
         }
-        std::cout << "\n";
+        out << "\n";
     }
 }
 
-void NetworkManager::printConnections() {
+void NetworkManager::printConnections(std::ostream& out) {
     auto tcp = getTcpConnections();
     auto udp = getUdpConnections();
     
-    std::cout << "Active Connections\n";
-    std::cout << "==================\n";
-    std::cout << std::left << std::setw(8) << "Proto" 
+    out << "Active Connections\n";
+    out << "==================\n";
+    out << std::left << std::setw(8) << "Proto" 
               << std::setw(24) << "Local Address" 
               << std::setw(24) << "Remote Address"
               << std::setw(16) << "State"
@@ -226,7 +226,7 @@ void NetworkManager::printConnections() {
         local << conn.localAddress << ":" << conn.localPort;
         remote << conn.remoteAddress << ":" << conn.remotePort;
         
-        std::cout << std::left << std::setw(8) << conn.protocol
+        out << std::left << std::setw(8) << conn.protocol
                   << std::setw(24) << local.str()
                   << std::setw(24) << remote.str()
                   << std::setw(16) << conn.state
@@ -237,7 +237,7 @@ void NetworkManager::printConnections() {
         std::ostringstream local;
         local << conn.localAddress << ":" << conn.localPort;
         
-        std::cout << std::left << std::setw(8) << conn.protocol
+        out << std::left << std::setw(8) << conn.protocol
                   << std::setw(24) << local.str()
                   << std::setw(24) << "*:*"
                   << std::setw(16) << ""
@@ -35,10 +35,10 @@ public:
     std::vector<AdapterInfo> getAdapters();
     std::vector<ConnectionInfo> getTcpConnections();
     std::vector<ConnectionInfo> getUdpConnections();
-    bool ping(const std::string& host, DWORD timeout = 1000);
+    bool ping(const std::string& host, std::ostream& out, DWORD timeout = 1000);
     std::string resolve(const std::string& hostname);
-    void printAdapters();
-    void printConnections();
+    void printAdapters(std::ostream& out);
+    void printConnections(std::ostream& out);
     
 private:
     bool m_wsaInitialized;
@@ -167,20 +167,20 @@ bool ServiceManager::setStartType(const std::string& name, DWORD startType) {
     return result != 0;
 }
 
-void ServiceManager::printServices(bool runningOnly) {
+void ServiceManager::printServices(std::ostream& out, bool runningOnly) {
     auto services = listServices();
     
-    std::cout << "Windows Services\n";
-    std::cout << "================\n";
-    std::cout << std::left << std::setw(36) << "Name" 
+    out << "Windows Services\n";
+    out << "================\n";
+    out << std::left << std::setw(36) << "Name" 
               << std::setw(12) << "State"
               << "Start Type\n";
-    std::cout << std::string(60, '-') << "\n";
+    out << std::string(60, '-') << "\n";
     
     for (const auto& svc : services) {
         if (runningOnly && svc.state != SERVICE_RUNNING) continue;
         
-        std::cout << std::left << std::setw(36) << svc.name.substr(0, 35)
+        out << std::left << std::setw(36) << svc.name.substr(0, 35)
                   << std::setw(12) << svc.stateStr
                   << svc.startTypeStr << "\n";
     }
@@ -20,7 +20,7 @@ public:
     bool stopService(const std::string& name);
     bool restartService(const std::string& name);
     bool setStartType(const std::string& name, DWORD startType);
-    void printServices(bool runningOnly = false);
+    void printServices(std::ostream& out, bool runningOnly = false);
     
 private:
     std::string stateToString(DWORD state);
@@ -118,45 +118,45 @@ std::string SystemInfoManager::getUptime() {
     return ss.str();
 }
 
-void SystemInfoManager::printSystemInfo() {
+void SystemInfoManager::printSystemInfo(std::ostream& out) {
     auto info = getSystemInfo();
     
-    std::cout << "System Information\n";
-    std::cout << "==================\n";
-    std::cout << "Computer Name:  " << info.computerName << "\n";
-    std::cout << "User Name:      " << info.userName << "\n";
-    std::cout << "OS Version:     " << info.osVersion << "\n";
-    std::cout << "Architecture:   " << info.processorArch << "\n";
-    std::cout << "Processors:     " << info.processorCount << "\n";
-    std::cout << "Uptime:         " << getUptime() << "\n";
+    out << "System Information\n";
+    out << "==================\n";
+    out << "Computer Name:  " << info.computerName << "\n";
+    out << "User Name:      " << info.userName << "\n";
+    out << "OS Version:     " << info.osVersion << "\n";
+    out << "Architecture:   " << info.processorArch << "\n";
+    out << "Processors:     " << info.processorCount << "\n";
+    out << "Uptime:         " << getUptime() << "\n";
 }
 
-void SystemInfoManager::printMemoryInfo() {
+void SystemInfoManager::printMemoryInfo(std::ostream& out) {
     auto info = getSystemInfo();
     
-    std::cout << "Memory Information\n";
-    std::cout << "==================\n";
-    std::cout << "Memory Load:    " << info.memoryLoad << "%\n";
-    std::cout << "Physical Total: " << formatSize(info.totalPhysicalMemory) << "\n";
-    std::cout << "Physical Free:  " << formatSize(info.availablePhysicalMemory) << "\n";
-    std::cout << "Physical Used:  " << formatSize(info.totalPhysicalMemory - info.availablePhysicalMemory) << "\n";
+    out << "Memory Information\n";
+    out << "==================\n";
+    out << "Memory Load:    " << info.memoryLoad << "%\n";
+    out << "Physical Total: " << formatSize(info.totalPhysicalMemory) << "\n";
+    out << "Physical Free:  " << formatSize(info.availablePhysicalMemory) << "\n";
+    out << "Physical Used:  " << formatSize(info.totalPhysicalMemory - info.availablePhysicalMemory) << "\n";
 }
 
-void SystemInfoManager::printDiskInfo() {
+void SystemInfoManager::printDiskInfo(std::ostream& out) {
     auto disks = getDiskInfo();
     
-    std::cout << "Disk Information\n";
-    std::cout << "================\n";
+    out << "Disk Information\n";
+    out << "================\n";
     for (const auto& disk : disks) {
         double usedPercent = 0;
         if (disk.totalSpace.QuadPart > 0) {
             usedPercent = (double)disk.usedSpace.QuadPart / disk.totalSpace.QuadPart * 100;
         }
         
-        std::cout << disk.drive << " ";
-        if (!disk.label.empty()) std::cout << "[" << disk.label << "] ";
-        std::cout << disk.fileSystem << "\n";
-        std::cout << "    Total: " << formatSize(disk.totalSpace.QuadPart) 
+        out << disk.drive << " ";
+        if (!disk.label.empty()) out << "[" << disk.label << "] ";
+        out << disk.fileSystem << "\n";
+        out << "    Total: " << formatSize(disk.totalSpace.QuadPart) 
                   << "  Used: " << formatSize(disk.usedSpace.QuadPart) 
                   << " (" << std::fixed << std::setprecision(1) << usedPercent << "%)"
                   << "  Free: " << formatSize(disk.freeSpace.QuadPart) << "\n";
@@ -31,9 +31,9 @@ public:
     std::vector<DiskInfo> getDiskInfo();
     std::string getUptime();
     std::string formatSize(ULONGLONG bytes);
-    void printSystemInfo();
-    void printDiskInfo();
-    void printMemoryInfo();
+    void printSystemInfo(std::ostream& out);
+    void printDiskInfo(std::ostream& out);
+    void printMemoryInfo(std::ostream& out);
 };
 
 }
\ No newline at end of file
@@ -1,125 +1,412 @@
 #include "parser.hpp"
+#include "scanner.hpp"
 
 namespace WaleedShell {
 
-std::vector<std::string> Parser::tokenize(const std::string& input) {
-    std::vector<std::string> tokens;
-    std::string current;
-    bool inQuotes = false;
-    char quoteChar = 0;
-    
-    for (size_t i = 0; i < input.size(); ++i) {
+void Parser::tokenize(std::string_view input, char* arena, std::vector<Token>& tokens) {
+    tokens.clear();
+    size_t used = 0;
+    size_t i = 0;
+
+    while (i < input.size()) {
         char c = input[i];
-        
-        if (inQuotes) {
-            if (c == quoteChar) {
-                inQuotes = false;
+
+        if (c == ' ' || c == '\t') {
+            ++i;
+            continue;
+        }
+        if (c == '|') {
+            if (i + 1 < input.size() && input[i + 1] == '|') {
+                tokens.push_back({TokenKind::Or, input.substr(i, 2)});
+                i += 2;
             } else {
-                current += c;
+                tokens.push_back({TokenKind::Pipe, input.substr(i, 1)});
+                ++i;
             }
-        } else {
-            if (c == '"' || c == '\'') {
-                inQuotes = true;
-                quoteChar = c;
-            } else if (c == ' ' || c == '\t') {
-                if (!current.empty()) {
-                    tokens.push_back(current);
-                    current.clear();
-                }
-            } else if (c == '|' || c == '<') {
-                if (!current.empty()) {
-                    tokens.push_back(current);
-                    current.clear();
-                }
-                tokens.push_back(std::string(1, c));
-            } else if (c == '>') {
-                if (!current.empty()) {
-                    tokens.push_back(current);
-                    current.clear();
+            continue;
+        }
+        if (c == '&') {
+            if (i + 1 < input.size() && input[i + 1] == '&') {
+                tokens.push_back({TokenKind::And, input.substr(i, 2)});
+                i += 2;
+            } else {
+                tokens.push_back({TokenKind::Background, input.substr(i, 1)});
+                ++i;
+            }
+            continue;
+        }
+        if (c == ';' || c == '(' || c == ')') {
+            TokenKind kind = (c == ';') ? TokenKind::Semicolon
+                           : (c == '(') ? TokenKind::LParen
+                           : TokenKind::RParen;
+            tokens.push_back({kind, input.substr(i, 1)});
+            ++i;
+            continue;
+        }
+        if (c == '<') {
+            tokens.push_back({TokenKind::Input, input.substr(i, 1)});
+            ++i;
+            continue;
+        }
+        if (c == '>') {
+            if (i + 1 < input.size() && input[i + 1] == '>') {
+                tokens.push_back({TokenKind::Append, input.substr(i, 2)});
+                i += 2;
+            } else {
+                tokens.push_back({TokenKind::Output, input.substr(i, 1)});
+                ++i;
+            }
+            continue;
+        }
+
+        // A word is a run of plain bytes and quoted sections. It stays a
+        // slice of the input until the first quote; from then on it is
+        // assembled in the arena with bulk copies of each run.
+        size_t start = i;
+        size_t arenaStart = used;
+        bool unescaped = false;
+
+        while (i < input.size()) {
+            size_t runEnd = findWordBreak(input, i);
+            if (unescaped) {
+                std::memcpy(arena + used, input.data() + i, runEnd - i);
+                used += runEnd - i;
+            }
+            i = runEnd;
+            if (i == input.size()) break;
+
+            char quote = input[i];
+            if (quote != '"' && quote != '\'') break;
+
+            if (!unescaped) {
+                std::memcpy(arena + used, input.data() + start, i - start);
+                used += i - start;
+                unescaped = true;
+            }
+            size_t close = input.find(quote, i + 1);
+            size_t end = (close == std::string_view::npos) ? input.size() : close;
+            std::memcpy(arena + used, input.data() + i + 1, end - i - 1);
+            used += end - i - 1;
+            i = (close == std::string_view::npos) ? input.size() : close + 1;
+        }
+
+        std::string_view word = unescaped
+            ? std::string_view(arena + arenaStart, used - arenaStart)
+            : input.substr(start, i - start);
+        if (!word.empty()) {
+            tokens.push_back({TokenKind::Word, word});
+        }
+    }
+}
+
+// Builds the pipeline made of tokens[first, last), copying each word once
+// from its slice into the command.
+static void assemble(const std::vector<Token>& tokens, size_t first, size_t last, Pipeline& pipeline) {
+    if (first == last) {
+        pipeline.isValid = false;
+        return;
+    }
+
+    size_t begin = first;
+    for (size_t i = first; i <= last; ++i) {
+        if (i < last && tokens[i].kind > TokenKind::Append) {
+            pipeline.isValid = false;
+            pipeline.error = "Syntax error: unexpected '" + std::string(tokens[i].text) + "'";
+            return;
+        }
+        if (i < last && tokens[i].kind != TokenKind::Pipe) continue;
+
+        if (i == begin) {
+            pipeline.isValid = false;
+            pipeline.error = (i < last)
+                ? "Syntax error: unexpected '|'"
+                : "Syntax error: expected command after '|'";
+            return;
+        }
+
+        Command& cmd = pipeline.commands.emplace_back();
+        for (size_t j = begin; j < i; ++j) {
+            const Token& token = tokens[j];
+
+            if (token.kind == TokenKind::Input) {
+                if (j + 1 < i) {
+                    cmd.inputRedirect.type = RedirectType::Input;
+                    cmd.inputRedirect.filename = tokens[++j].text;
                 }
-                if (i + 1 < input.size() && input[i + 1] == '>') {
-                    tokens.push_back(">>");
-                    ++i;
-                } else {
-                    tokens.push_back(">");
+            } else if (token.kind == TokenKind::Output || token.kind == TokenKind::Append) {
+                if (j + 1 < i) {
+                    if (cmd.outputRedirect.type != RedirectType::None) {
+                        cmd.replacedOutput = cmd.outputRedirect;
+                    }
+                    cmd.outputRedirect.type = token.kind == TokenKind::Output ? RedirectType::Output
+                                                                              : RedirectType::Append;
+                    cmd.outputRedirect.filename = tokens[++j].text;
                 }
+            } else if (cmd.program.empty()) {
+                cmd.program = token.text;
             } else {
-                current += c;
+                cmd.args.emplace_back(token.text);
             }
         }
+        begin = i + 1;
     }
-    
-    if (!current.empty()) {
-        tokens.push_back(current);
+}
+
+Pipeline Parser::parse(const std::string& input) {
+    Pipeline pipeline;
+    if (m_arena.size() < input.size()) {
+        m_arena.resize(input.size());
     }
-    
-    return tokens;
+    tokenize(input, m_arena.data(), m_tokens);
+    assemble(m_tokens, 0, m_tokens.size(), pipeline);
+    return pipeline;
 }
 
-Command Parser::parseCommand(const std::vector<std::string>& tokens) {
-    Command cmd;
-    
-    for (size_t i = 0; i < tokens.size(); ++i) {
-        const std::string& token = tokens[i];
-        
-        if (token == "<") {
-            if (i + 1 < tokens.size()) {
-                cmd.inputRedirect.type = RedirectType::Input;
-                cmd.inputRedirect.filename = tokens[++i];
-            }
-        } else if (token == ">") {
-            if (i + 1 < tokens.size()) {
-                cmd.outputRedirect.type = RedirectType::Output;
-                cmd.outputRedirect.filename = tokens[++i];
-            }
-        } else if (token == ">>") {
-            if (i + 1 < tokens.size()) {
-                cmd.outputRedirect.type = RedirectType::Append;
-                cmd.outputRedirect.filename = tokens[++i];
-            }
-        } else if (cmd.program.empty()) {
-            cmd.program = token;
+static bool isListBoundary(TokenKind kind) {
+    return kind == TokenKind::Semicolon || kind == TokenKind::Background ||
+           kind == TokenKind::And || kind == TokenKind::Or ||
+           kind == TokenKind::LParen || kind == TokenKind::RParen;
+}
+
+bool Parser::isTimePrefix(std::string_view word, std::string_view next) {
+    if (word != "time" || next.empty()) return false;
+    return next[0] != '/' && (next[0] < '0' || next[0] > '9');
+}
+
+// list := item ((';' | '&' | '&&' | '||') item)* [';' | '&']
+// item := '(' list ')' | pipeline
+void Parser::parseItems(size_t& pos, CommandList& list, int depth) {
+    ListOp op = ListOp::Sequence;
+    size_t chainStart = 0;
+
+    while (true) {
+        if (pos == m_tokens.size()) {
+            list.isValid = false;
+            if (!list.items.empty()) {
+                list.error = "Syntax error: expected command after '" +
+                             std::string(m_tokens[pos - 1].text) + "'";
+            }
+            return;
+        }
+
+        ListItem& item = list.items.emplace_back();
+        item.op = op;
+        const Token& token = m_tokens[pos];
+
+        if (token.kind == TokenKind::LParen) {
+            ++pos;
+            item.group = std::make_shared<CommandList>();
+            parseItems(pos, *item.group, depth + 1);
+            if (!item.group->isValid) {
+                list.isValid = false;
+                list.error = item.group->error.empty() ? "Syntax error: empty group" : item.group->error;
+                return;
+            }
+            if (pos == m_tokens.size()) {
+                list.isValid = false;
+                list.error = "Syntax error: expected ')'";
+                return;
+            }
+            ++pos;
+            if (pos < m_tokens.size() && !isListBoundary(m_tokens[pos].kind)) {
+                list.isValid = false;
+                list.error = "Syntax error: unexpected '" + std::string(m_tokens[pos].text) + "' after ')'";
+                return;
+            }
+        } else if (isListBoundary(token.kind)) {
+            list.isValid = false;
+            list.error = "Syntax error: unexpected '" + std::string(token.text) + "'";
+            return;
         } else {
-            cmd.args.push_back(token);
+            if (token.kind == TokenKind::Word && pos + 1 < m_tokens.size() &&
+                m_tokens[pos + 1].kind == TokenKind::Word && isTimePrefix(token.text, m_tokens[pos + 1].text)) {
+                item.pipeline.timed = true;
+                ++pos;
+            }
+            size_t end = pos;
+            while (end < m_tokens.size() && !isListBoundary(m_tokens[end].kind)) {
+                ++end;
+            }
+            assemble(m_tokens, pos, end, item.pipeline);
+            if (!item.pipeline.isValid) {
+                list.isValid = false;
+                list.error = item.pipeline.error;
+                return;
+            }
+            pos = end;
+        }
+
+        if (pos == m_tokens.size()) return;
+
+        switch (m_tokens[pos].kind) {
+            case TokenKind::RParen:
+                if (depth == 0) {
+                    list.isValid = false;
+                    list.error = "Syntax error: unexpected ')'";
+                }
+                return;
+            case TokenKind::Background:
+                if (list.items.size() - chainStart > 1 || list.items.back().group) {
+                    list.isValid = false;
+                    list.error = "Syntax error: only a single pipeline can run in the background";
+                    return;
+                }
+                list.items.back().background = true;
+                [[fallthrough]];
+            case TokenKind::Semicolon:
+                ++pos;
+                chainStart = list.items.size();
+                if (pos == m_tokens.size()) return;
+                if (m_tokens[pos].kind == TokenKind::RParen) {
+                    if (depth == 0) {
+                        list.isValid = false;
+                        list.error = "Syntax error: unexpected ')'";
+                    }
+                    return;
+                }
+                op = ListOp::Sequence;
+                break;
+            case TokenKind::And:
+                ++pos;
+                op = ListOp::And;
+                break;
+            case TokenKind::Or:
+                ++pos;
+                op = ListOp::Or;
+                break;
+            default:
+                list.isValid = false;
+                list.error = "Syntax error: unexpected '" + std::string(m_tokens[pos].text) + "'";
+                return;
         }
     }
-    
-    return cmd;
 }
 
-Pipeline Parser::parse(const std::string& input) {
-    Pipeline pipeline;
-    std::vector<std::string> tokens = tokenize(input);
-    
-    if (tokens.empty()) {
-        pipeline.isValid = false;
-        return pipeline;
+CommandList Parser::parseList(const std::string& input) {
+    CommandList list;
+    if (m_arena.size() < input.size()) {
+        m_arena.resize(input.size());
     }
-    
-    std::vector<std::string> currentTokens;
-    
-    for (const auto& token : tokens) {
-        if (token == "|") {
-            if (currentTokens.empty()) {
-                pipeline.isValid = false;
-                pipeline.error = "Syntax error: unexpected '|'";
-                return pipeline;
-            }
-            pipeline.commands.push_back(parseCommand(currentTokens));
-            currentTokens.clear();
-        } else {
-            currentTokens.push_back(token);
+    tokenize(input, m_arena.data(), m_tokens);
+    if (m_tokens.empty()) {
+        list.isValid = false;
+        return list;
+    }
+
+    size_t pos = 0;
+    parseItems(pos, list, 0);
+    return list;
+}
+
+// Reads the token starting at `i`, which is not a blank, by the rules of
+// tokenize(), and returns where it ends.
+static size_t lexToken(std::string_view input, size_t i, LexSpan& span) {
+    span = LexSpan();
+    span.start = (uint32_t)i;
+    char c = input[i];
+    bool doubled = i + 1 < input.size() && input[i + 1] == c;
+    size_t end = i + 1;
+
+    if (c == '|' || c == '&' || c == '>') {
+        span.kind = c == '|' ? (doubled ? TokenKind::Or : TokenKind::Pipe)
+                  : c == '&' ? (doubled ? TokenKind::And : TokenKind::Background)
+                  : (doubled ? TokenKind::Append : TokenKind::Output);
+        if (doubled) ++end;
+    } else if (c == '<') {
+        span.kind = TokenKind::Input;
+    } else if (c == ';') {
+        span.kind = TokenKind::Semicolon;
+    } else if (c == '(') {
+        span.kind = TokenKind::LParen;
+    } else if (c == ')') {
+        span.kind = TokenKind::RParen;
+    } else {
+        end = i;
+        while (end < input.size()) {
+            end = findWordBreak(input, end);
+            if (end == input.size()) break;
+
+            char quote = input[end];
+            if (quote != '"' && quote != '\'') break;
+            span.quoted = true;
+            size_t close = input.find(quote, end + 1);
+            if (close == std::string_view::npos) {
+                span.unterminated = true;
+                end = input.size();
+                break;
+            }
+            end = close + 1;
         }
     }
-    
-    if (currentTokens.empty()) {
-        pipeline.isValid = false;
-        pipeline.error = "Syntax error: expected command after '|'";
-        return pipeline;
+    span.length = (uint32_t)(end - i);
+    return end;
+}
+
+// Length of the common prefix of `a` and `b`, compared a block at a time.
+static size_t commonPrefix(const char* a, const char* b, size_t count) {
+    size_t i = 0;
+    while (i + 64 <= count && std::memcmp(a + i, b + i, 64) == 0) {
+        i += 64;
     }
-    
-    pipeline.commands.push_back(parseCommand(currentTokens));
-    return pipeline;
+    while (i < count && a[i] == b[i]) {
+        ++i;
+    }
+    return i;
 }
 
-}
\ No newline at end of file
+const std::vector<LexSpan>& Parser::lex(std::string_view input) {
+    size_t oldSize = m_lexed.size();
+    size_t limit = std::min(oldSize, input.size());
+    size_t prefix = commonPrefix(m_lexed.data(), input.data(), limit);
+    if (prefix == oldSize && prefix == input.size()) return m_spans;
+    size_t suffix = 0;
+    while (suffix < limit - prefix && m_lexed[oldSize - 1 - suffix] == input[input.size() - 1 - suffix]) {
+        ++suffix;
+    }
+
+    // A token is settled by the bytes up to the one after it, so tokens
+    // ending before the change are kept. Lexing restarts at the next token
+    // or the change itself, whichever comes first; no quote is open there.
+    auto first = std::partition_point(m_spans.begin(), m_spans.end(),
+                                      [prefix](const LexSpan& span) { return span.start + span.length < prefix; });
+    size_t pos = first != m_spans.end() ? std::min<size_t>(first->start, prefix) : prefix;
+    m_respans.assign(first, m_spans.end());
+    m_spans.erase(first, m_spans.end());
+
+    // Once past the change, a token starting where an old one started
+    // (moved by the change in length) sees the same text to its right, so
+    // it and everything after it lexes as before.
+    int64_t delta = (int64_t)input.size() - (int64_t)oldSize;
+    size_t unchanged = input.size() - suffix;
+    size_t old = 0;
+    while (true) {
+        while (pos < input.size() && (input[pos] == ' ' || input[pos] == '\t')) {
+            ++pos;
+        }
+        if (pos == input.size()) break;
+
+        if (pos >= unchanged) {
+            int64_t oldPos = (int64_t)pos - delta;
+            while (old < m_respans.size() && (int64_t)m_respans[old].start < oldPos) {
+                ++old;
+            }
+            if (old < m_respans.size() && (int64_t)m_respans[old].start == oldPos) {
+                for (; old < m_respans.size(); ++old) {
+                    LexSpan span = m_respans[old];
+                    span.start = (uint32_t)((int64_t)span.start + delta);
+                    m_spans.push_back(span);
+                }
+                break;
+            }
+        }
+
+        LexSpan span;
+        pos = lexToken(input, pos, span);
+        m_spans.push_back(span);
+    }
+
+    m_lexed.assign(input);
+    return m_spans;
+}
+
+}
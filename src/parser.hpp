@@ -1,5 +1,6 @@
 #pragma once
 #include "common.hpp"
+#include <string_view>
 
 namespace WaleedShell {
 
@@ -20,21 +21,99 @@ struct Command {
     std::vector<std::string> args;
     Redirect inputRedirect;
     Redirect outputRedirect;
+    // An output redirect overridden by a later one on the same command. A
+    // `where` reads it back as its comparison (see foldRecordStages()).
+    Redirect replacedOutput;
+    std::string resolvedPath;
+    uint64_t resolvedGeneration = 0;
+    // Record operators (where, sort-by...) that followed this stage, moved
+    // into it by foldRecordStages() so they run on its records.
+    std::vector<Command> recordOps;
 };
 
 struct Pipeline {
     std::vector<Command> commands;
+    bool timed = false;
     bool isValid = true;
     std::string error;
 };
 
+// How a list item is joined to the one before it: ';' always runs it,
+// '&&' only after success, '||' only after failure.
+enum class ListOp {
+    Sequence,
+    And,
+    Or
+};
+
+struct CommandList;
+
+struct ListItem {
+    ListOp op = ListOp::Sequence;
+    bool background = false;
+    Pipeline pipeline;
+    std::shared_ptr<CommandList> group;
+};
+
+struct CommandList {
+    std::vector<ListItem> items;
+    bool isValid = true;
+    std::string error;
+};
+
+enum class TokenKind {
+    Word,
+    Pipe,
+    Input,
+    Output,
+    Append,
+    Semicolon,
+    Background,
+    And,
+    Or,
+    LParen,
+    RParen
+};
+
+struct Token {
+    TokenKind kind = TokenKind::Word;
+    std::string_view text;
+};
+
+// A token of a line still being typed, as a byte range of that line. Words
+// keep their quotes: `quoted` says the range holds a quoted section and
+// `unterminated` that the last one runs to the end of the line.
+struct LexSpan {
+    TokenKind kind = TokenKind::Word;
+    uint32_t start = 0;
+    uint32_t length = 0;
+    bool quoted = false;
+    bool unterminated = false;
+};
+
 class Parser {
 public:
     Pipeline parse(const std::string& input);
-    
+    CommandList parseList(const std::string& input);
+    // Lexes a line being edited, for highlighting. Never fails: stray
+    // operators and open quotes are reported as they are. Only the tokens
+    // around what changed since the previous call are lexed again; the
+    // rest are reused, moved by the change in length.
+    const std::vector<LexSpan>& lex(std::string_view input);
+    // Whether `time` at the start of a pipeline, followed by the word
+    // `next`, is the prefix that times the command. A switch or a time
+    // value (`time /t`, `time 12:00`) leaves it cmd's time command.
+    static bool isTimePrefix(std::string_view word, std::string_view next);
+
 private:
-    std::vector<std::string> tokenize(const std::string& input);
-    Command parseCommand(const std::vector<std::string>& tokens);
+    std::vector<Token> m_tokens;
+    std::string m_arena;
+    std::string m_lexed;
+    std::vector<LexSpan> m_spans;
+    std::vector<LexSpan> m_respans;
+
+    void tokenize(std::string_view input, char* arena, std::vector<Token>& tokens);
+    void parseItems(size_t& pos, CommandList& list, int depth);
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,289 @@
+#include "pathindex.hpp"
+
+namespace WaleedShell {
+
+static const char* const EXTENSIONS[] = {".exe", ".cmd", ".bat", ".com"};
+
+ExecutableIndex::ExecutableIndex()
+    : m_commands(std::make_shared<const CommandTable>()), m_trie(1), m_lastCheck(0), m_generation(0), m_built(false) {}
+
+std::string ExecutableIndex::toLower(const std::string& s) {
+    std::string lower = s;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    return lower;
+}
+
+int ExecutableIndex::extensionRank(const std::string& lowerName) {
+    for (int i = 0; i < 4; ++i) {
+        size_t len = strlen(EXTENSIONS[i]);
+        if (lowerName.size() > len && lowerName.compare(lowerName.size() - len, len, EXTENSIONS[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+ExecutableIndex::~ExecutableIndex() {
+    closeWatches();
+}
+
+void ExecutableIndex::closeWatches() {
+    for (auto& state : m_dirs) {
+        if (state.watch != INVALID_HANDLE_VALUE) {
+            FindCloseChangeNotification(state.watch);
+            state.watch = INVALID_HANDLE_VALUE;
+        }
+    }
+}
+
+// The watch is armed before the directory is listed, so a file created
+// while scan() runs still signals it.
+void ExecutableIndex::watch(DirState& state) {
+    state.watch = FindFirstChangeNotificationA(state.path.c_str(), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME);
+}
+
+void ExecutableIndex::scan(DirState& state) {
+    state.files.clear();
+    
+    WIN32_FIND_DATAA fd;
+    std::string pattern = state.path + "\\*";
+    HANDLE hFind = FindFirstFileA(pattern.c_str(), &fd);
+    if (hFind == INVALID_HANDLE_VALUE) return;
+    
+    do {
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        if (extensionRank(toLower(fd.cFileName)) < 0) continue;
+        state.files.push_back(fd.cFileName);
+    } while (FindNextFileA(hFind, &fd));
+    FindClose(hFind);
+}
+
+void ExecutableIndex::build() {
+    closeWatches();
+    m_dirs.clear();
+    
+    std::stringstream ss(m_pathValue);
+    std::string dir;
+    while (std::getline(ss, dir, ';')) {
+        if (dir.empty()) continue;
+        DirState& state = m_dirs.emplace_back();
+        state.path = dir;
+        watch(state);
+        scan(state);
+    }
+    
+    merge();
+    m_built = true;
+    m_lastCheck = GetTickCount64();
+}
+
+// Rebuilds the name table and trie from the cached directory listings;
+// no filesystem access.
+void ExecutableIndex::merge() {
+    auto commands = std::make_shared<CommandTable>();
+    m_names.clear();
+    m_trie.assign(1, TrieNode{});
+    
+    // Earlier directories win; within one directory .exe beats .cmd,
+    // .bat and .com, matching the probe order used before the index.
+    for (const auto& state : m_dirs) {
+        std::unordered_map<std::string, std::pair<int, std::string>> best;
+        
+        for (const auto& name : state.files) {
+            std::string lower = toLower(name);
+            int rank = extensionRank(lower);
+            
+            std::string fullPath = state.path + "\\" + name;
+            commands->emplace(lower, fullPath);
+            
+            std::string base = lower.substr(0, lower.find_last_of('.'));
+            auto it = best.find(base);
+            if (it == best.end() || rank < it->second.first) {
+                best[base] = {rank, name};
+            }
+        }
+        
+        for (const auto& [base, entry] : best) {
+            if (commands->emplace(base, state.path + "\\" + entry.second).second) {
+                m_names.push_back(entry.second.substr(0, entry.second.find_last_of('.')));
+                insertName((uint32_t)m_names.size() - 1);
+            }
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> publish(m_publishMutex);
+        m_commands = std::move(commands);
+    }
+    m_generation++;
+}
+
+void ExecutableIndex::insertName(uint32_t index) {
+    uint32_t node = 0;
+    for (char c : m_names[index]) {
+        char key = (char)::tolower((unsigned char)c);
+        auto& children = m_trie[node].children;
+        auto it = std::lower_bound(children.begin(), children.end(), key,
+                                   [](const std::pair<char, uint32_t>& child, char k) { return child.first < k; });
+        if (it != children.end() && it->first == key) {
+            node = it->second;
+            continue;
+        }
+        uint32_t next = (uint32_t)m_trie.size();
+        children.insert(it, {key, next});
+        m_trie.emplace_back();
+        node = next;
+    }
+    m_trie[node].name = (int32_t)index;
+}
+
+void ExecutableIndex::collect(uint32_t node, std::vector<std::string>& matches) const {
+    if (m_trie[node].name >= 0) {
+        matches.push_back(m_names[m_trie[node].name]);
+    }
+    for (const auto& child : m_trie[node].children) {
+        collect(child.second, matches);
+    }
+}
+
+void ExecutableIndex::refresh() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    refreshLocked();
+}
+
+void ExecutableIndex::refreshLocked() {
+    // Sized from the variable's length rather than its 32767-byte limit,
+    // into a buffer kept between calls, so an unchanged PATH costs one
+    // copy and one compare. The loop covers PATH growing in between.
+    DWORD size = GetEnvironmentVariableA("PATH", NULL, 0);
+    for (;;) {
+        m_pathScratch.resize(size);
+        DWORD len = size ? GetEnvironmentVariableA("PATH", m_pathScratch.data(), size) : 0;
+        if (len < size || len == 0) {
+            m_pathScratch.resize(len);
+            break;
+        }
+        size = len;
+    }
+    
+    if (!m_built || m_pathScratch != m_pathValue) {
+        m_pathValue.swap(m_pathScratch);
+        build();
+        return;
+    }
+    
+    // Polling a notification handle is a single non-blocking wait, cheap
+    // enough for every lookup. Directories without one (not there when
+    // the index was built, or removed since) are retried once a second.
+    ULONGLONG now = GetTickCount64();
+    bool retryMissing = now - m_lastCheck >= 1000;
+    if (retryMissing) m_lastCheck = now;
+    
+    bool changed = false;
+    for (auto& state : m_dirs) {
+        if (state.watch != INVALID_HANDLE_VALUE) {
+            if (WaitForSingleObject(state.watch, 0) != WAIT_OBJECT_0) continue;
+            if (!FindNextChangeNotification(state.watch)) {
+                FindCloseChangeNotification(state.watch);
+                state.watch = INVALID_HANDLE_VALUE;
+            }
+        } else {
+            if (!retryMissing) continue;
+            watch(state);
+            if (state.watch == INVALID_HANDLE_VALUE) continue;
+        }
+        scan(state);
+        changed = true;
+    }
+    
+    if (changed) {
+        merge();
+    }
+}
+
+std::string ExecutableIndex::findLocal(const std::string& program) {
+    static const char* const probeExtensions[] = {"", ".exe", ".cmd", ".bat", ".com"};
+    for (const char* ext : probeExtensions) {
+        std::string local = ".\\" + program + ext;
+        DWORD attrs = GetFileAttributesA(local.c_str());
+        if (attrs != INVALID_FILE_ATTRIBUTES && !(attrs & FILE_ATTRIBUTE_DIRECTORY)) {
+            return local;
+        }
+    }
+    return "";
+}
+
+std::string ExecutableIndex::find(const std::string& program) {
+    std::string local = findLocal(program);
+    if (!local.empty()) return local;
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    refreshLocked();
+    return lookupLocked(program);
+}
+
+std::string ExecutableIndex::lookup(const std::string& program) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return lookupLocked(program);
+}
+
+std::string ExecutableIndex::lookupLocked(const std::string& program) {
+    std::string lower = toLower(program);
+    auto it = m_commands->find(lower);
+    if (it == m_commands->end()) return "";
+    
+    auto& entry = m_remembered[lower];
+    if (entry.path != it->second) {
+        entry = {program, it->second, 0};
+    }
+    entry.hits++;
+    return it->second;
+}
+
+bool ExecutableIndex::contains(const std::string& program) const {
+    std::string lower = toLower(program);
+    std::shared_ptr<const CommandTable> commands;
+    {
+        std::lock_guard<std::mutex> publish(m_publishMutex);
+        commands = m_commands;
+    }
+    return commands->find(lower) != commands->end();
+}
+
+std::vector<std::string> ExecutableIndex::complete(const std::string& prefix) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    refreshLocked();
+    
+    std::vector<std::string> matches;
+    uint32_t node = 0;
+    for (char c : prefix) {
+        char key = (char)::tolower((unsigned char)c);
+        const auto& children = m_trie[node].children;
+        auto it = std::lower_bound(children.begin(), children.end(), key,
+                                   [](const std::pair<char, uint32_t>& child, char k) { return child.first < k; });
+        if (it == children.end() || it->first != key) return matches;
+        node = it->second;
+    }
+    collect(node, matches);
+    return matches;
+}
+
+std::vector<HashedCommand> ExecutableIndex::remembered() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<HashedCommand> entries;
+    for (const auto& [key, entry] : m_remembered) {
+        entries.push_back(entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](const HashedCommand& a, const HashedCommand& b) {
+        return a.name < b.name;
+    });
+    return entries;
+}
+
+void ExecutableIndex::forget() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_remembered.clear();
+    m_built = false;
+}
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "common.hpp"
+#include <atomic>
+#include <mutex>
+
+namespace WaleedShell {
+
+struct HashedCommand {
+    std::string name;
+    std::string path;
+    unsigned hits;
+};
+
+// Name -> full path table of every executable on PATH, in the spirit of
+// bash's `hash`. Built on first use and rebuilt when PATH changes. Each
+// directory keeps its own listing and a change notification handle; a
+// signalled handle rescans just that directory and the table is merged
+// again from the cached listings. Directories missing at build time are
+// rechecked at most once per second. Completion walks a prefix trie of
+// the command names. The current directory is not indexed since it takes
+// precedence and changes often, so find() probes it directly. Safe to
+// share with the completion worker thread.
+class ExecutableIndex {
+public:
+    ExecutableIndex();
+    ~ExecutableIndex();
+    ExecutableIndex(const ExecutableIndex&) = delete;
+    ExecutableIndex& operator=(const ExecutableIndex&) = delete;
+
+    // The current directory first, then PATH after a refresh().
+    std::string find(const std::string& program);
+    // PATH only, as of the last refresh(); for a caller that has just
+    // refreshed and probed the current directory itself.
+    std::string lookup(const std::string& program);
+    // `.\program`, as is or with each executable extension, or "".
+    static std::string findLocal(const std::string& program);
+    // Whether `program` is on PATH as of the last build, without touching
+    // the disk or the hash statistics; for the keystroke path.
+    bool contains(const std::string& program) const;
+    std::vector<std::string> complete(const std::string& prefix);
+    std::vector<HashedCommand> remembered() const;
+    void forget();
+    void refresh();
+
+    uint64_t generation() const { return m_generation; }
+    bool built() const { return m_built; }
+    size_t size() const { std::lock_guard<std::mutex> lock(m_mutex); return m_commands->size(); }
+    size_t directoryCount() const { std::lock_guard<std::mutex> lock(m_mutex); return m_dirs.size(); }
+
+private:
+    struct DirState {
+        std::string path;
+        HANDLE watch = INVALID_HANDLE_VALUE;
+        std::vector<std::string> files;
+    };
+
+    // Children are kept sorted by character, so a depth-first walk yields
+    // completions in order. `name` indexes m_names, or -1.
+    struct TrieNode {
+        std::vector<std::pair<char, uint32_t>> children;
+        int32_t name = -1;
+    };
+
+    using CommandTable = std::unordered_map<std::string, std::string>;
+
+    // m_mutex is held across scans of PATH. contains() and built() are on
+    // the keystroke path and must not wait for one: merge() publishes each
+    // new table whole, and contains() only takes m_publishMutex to copy
+    // the pointer.
+    mutable std::mutex m_mutex;
+    mutable std::mutex m_publishMutex;
+    std::string m_pathValue;
+    std::string m_pathScratch;
+    std::vector<DirState> m_dirs;
+    std::shared_ptr<const CommandTable> m_commands;
+    std::vector<std::string> m_names;
+    std::vector<TrieNode> m_trie;
+    std::unordered_map<std::string, HashedCommand> m_remembered;
+    ULONGLONG m_lastCheck;
+    std::atomic<uint64_t> m_generation;
+    std::atomic<bool> m_built;
+
+    void refreshLocked();
+    std::string lookupLocked(const std::string& program);
+    void build();
+    void closeWatches();
+    void watch(DirState& state);
+    void scan(DirState& state);
+    void merge();
+    void insertName(uint32_t index);
+    void collect(uint32_t node, std::vector<std::string>& matches) const;
+    static std::string toLower(const std::string& s);
+    static int extensionRank(const std::string& lowerName);
+};
+
+}
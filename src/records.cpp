@@ -0,0 +1,497 @@
+#include "records.hpp"
+#include "builtins.hpp"
+
+namespace WaleedShell {
+
+static uint64_t fileTimeTicks(const FILETIME& ft) {
+    return (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+}
+
+static std::string lower(const std::string& text) {
+    std::string result = text;
+    std::transform(result.begin(), result.end(), result.begin(),
+                   [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    return result;
+}
+
+static int compareText(const std::string& a, const std::string& b) {
+    size_t count = std::min(a.size(), b.size());
+    for (size_t i = 0; i < count; ++i) {
+        int ca = tolower(static_cast<unsigned char>(a[i]));
+        int cb = tolower(static_cast<unsigned char>(b[i]));
+        if (ca != cb) return ca < cb ? -1 : 1;
+    }
+    return a.size() == b.size() ? 0 : a.size() < b.size() ? -1 : 1;
+}
+
+static std::string formatBytes(uint64_t bytes) {
+    const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+    int unit = 0;
+    double size = static_cast<double>(bytes);
+    while (size >= 1024 && unit < 4) {
+        size /= 1024;
+        unit++;
+    }
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1) << size << " " << units[unit];
+    return ss.str();
+}
+
+static std::string formatTime(uint64_t ticks) {
+    FILETIME ft;
+    ft.dwLowDateTime = static_cast<DWORD>(ticks);
+    ft.dwHighDateTime = static_cast<DWORD>(ticks >> 32);
+    SYSTEMTIME st;
+    if (!FileTimeToSystemTime(&ft, &st)) return "?";
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%04u-%02u-%02u %02u:%02u",
+             st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute);
+    return buffer;
+}
+
+static std::string formatValue(const Column& column, uint32_t row) {
+    switch (column.type) {
+        case FieldType::Text: return column.texts[row];
+        case FieldType::Bytes: return formatBytes(column.numbers[row]);
+        case FieldType::Time: return formatTime(column.numbers[row]);
+        default: return std::to_string(column.numbers[row]);
+    }
+}
+
+// Reads a value typed by the user for a column of `type`: digits, a size
+// such as 1.5GB (units are powers of 1024), or a date as YYYY-MM-DD with
+// an optional THH:MM or " HH:MM".
+static bool parseValue(const std::string& text, FieldType type, uint64_t& value) {
+    if (type == FieldType::Time) {
+        SYSTEMTIME st = {};
+        unsigned year = 0, month = 0, day = 0, hour = 0, minute = 0;
+        char separator = 0;
+        int fields = sscanf(text.c_str(), "%4u-%2u-%2u%c%2u:%2u", &year, &month, &day, &separator, &hour, &minute);
+        if (fields != 3 && fields != 6) return false;
+        if (fields == 6 && separator != 'T' && separator != ' ') return false;
+        st.wYear = static_cast<WORD>(year);
+        st.wMonth = static_cast<WORD>(month);
+        st.wDay = static_cast<WORD>(day);
+        st.wHour = static_cast<WORD>(hour);
+        st.wMinute = static_cast<WORD>(minute);
+        FILETIME ft;
+        if (!SystemTimeToFileTime(&st, &ft)) return false;
+        value = fileTimeTicks(ft);
+        return true;
+    }
+
+    if (text.empty() || !(isdigit(static_cast<unsigned char>(text[0])) || text[0] == '.')) return false;
+    char* end = nullptr;
+    double number = strtod(text.c_str(), &end);
+    std::string unit = lower(end);
+    double scale = 1;
+    if (type == FieldType::Bytes && !unit.empty()) {
+        static const char* const units[] = {"b", "kb", "mb", "gb", "tb"};
+        double step = 1;
+        for (const char* name : units) {
+            if (unit == name || unit == std::string(name, 1)) {
+                scale = step;
+                unit.clear();
+                break;
+            }
+            step *= 1024;
+        }
+    }
+    if (!unit.empty()) return false;
+    if (type != FieldType::Bytes && number != static_cast<double>(static_cast<uint64_t>(number))) return false;
+    value = static_cast<uint64_t>(number * scale);
+    return true;
+}
+
+RecordBatch::RecordBatch(std::vector<Column> columns, size_t rows) : m_columns(std::move(columns)) {
+    m_rows.resize(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        m_rows[i] = static_cast<uint32_t>(i);
+    }
+    for (size_t i = 0; i < m_columns.size(); ++i) {
+        if (!m_columns[i].hidden) m_shown.push_back(i);
+    }
+}
+
+const Column* RecordBatch::column(const std::string& name, size_t* index, std::string& error) const {
+    for (size_t i = 0; i < m_columns.size(); ++i) {
+        if (compareText(m_columns[i].name, name) == 0) {
+            if (index) *index = i;
+            return &m_columns[i];
+        }
+    }
+    error = "no column '" + name + "'; columns are";
+    for (const Column& column : m_columns) {
+        error += " " + column.name;
+    }
+    return nullptr;
+}
+
+bool RecordBatch::apply(const Command& op, std::string& error) {
+    if (op.program == "where") return where(op.args, error);
+    if (op.program == "sort-by") return sortBy(op.args, error);
+    if (op.program == "select") return select(op.args, error);
+    if (op.program == "group-by") return groupBy(op.args, error);
+    if (op.program == "first") return first(op.args, error);
+    error = "not a record operator";
+    return false;
+}
+
+// where <column> <op> <value>, with op one of == != > >= < <= ~ (~ tests
+// that text contains the value). Text compares without regard to case.
+bool RecordBatch::where(const std::vector<std::string>& args, std::string& error) {
+    if (args.size() != 3) {
+        error = "usage: where <column> <op> <value>";
+        return false;
+    }
+    const Column* col = column(args[0], nullptr, error);
+    if (!col) return false;
+
+    const std::string& op = args[1];
+    bool equal = op == "==" || op == "=";
+    bool contains = op == "~";
+    if (!equal && !contains && op != "!=" && op != ">" && op != ">=" && op != "<" && op != "<=") {
+        error = "unknown comparison '" + op + "'; use == != > >= < <= or ~";
+        return false;
+    }
+    if (contains && col->type != FieldType::Text) {
+        error = "'~' only applies to text columns";
+        return false;
+    }
+
+    uint64_t number = 0;
+    std::string text = args[2];
+    if (col->type == FieldType::Text) {
+        text = lower(text);
+    } else if (!parseValue(args[2], col->type, number)) {
+        error = "'" + args[2] + "' is not a value for column " + col->name;
+        return false;
+    }
+
+    auto keep = [&](uint32_t row) {
+        int order;
+        if (col->type == FieldType::Text) {
+            if (contains) return lower(col->texts[row]).find(text) != std::string::npos;
+            order = compareText(col->texts[row], text);
+        } else {
+            uint64_t value = col->numbers[row];
+            order = value < number ? -1 : value > number ? 1 : 0;
+        }
+        if (equal) return order == 0;
+        if (op == "!=") return order != 0;
+        if (op == ">") return order > 0;
+        if (op == ">=") return order >= 0;
+        if (op == "<") return order < 0;
+        return order <= 0;
+    };
+    m_rows.erase(std::remove_if(m_rows.begin(), m_rows.end(), [&](uint32_t row) { return !keep(row); }),
+                 m_rows.end());
+    return true;
+}
+
+// sort-by [-d] <column>...: ascending unless -d, ties broken by the next
+// column and then by the order the records came in.
+bool RecordBatch::sortBy(const std::vector<std::string>& args, std::string& error) {
+    bool descending = !args.empty() && args[0] == "-d";
+    std::vector<const Column*> keys;
+    for (size_t i = descending ? 1 : 0; i < args.size(); ++i) {
+        const Column* col = column(args[i], nullptr, error);
+        if (!col) return false;
+        keys.push_back(col);
+    }
+    if (keys.empty()) {
+        error = "usage: sort-by [-d] <column>...";
+        return false;
+    }
+
+    std::stable_sort(m_rows.begin(), m_rows.end(), [&](uint32_t a, uint32_t b) {
+        for (const Column* col : keys) {
+            int order;
+            if (col->type == FieldType::Text) {
+                order = compareText(col->texts[a], col->texts[b]);
+            } else {
+                order = col->numbers[a] < col->numbers[b] ? -1 : col->numbers[a] > col->numbers[b] ? 1 : 0;
+            }
+            if (order != 0) return descending ? order > 0 : order < 0;
+        }
+        return false;
+    });
+    return true;
+}
+
+// select <column>...: shows these columns, in this order. Hidden columns
+// (a process's path, a connection's ports) can be selected too.
+bool RecordBatch::select(const std::vector<std::string>& args, std::string& error) {
+    if (args.empty()) {
+        error = "usage: select <column>...";
+        return false;
+    }
+    std::vector<size_t> shown;
+    for (const auto& name : args) {
+        size_t index = 0;
+        if (!column(name, &index, error)) return false;
+        shown.push_back(index);
+    }
+    m_shown = std::move(shown);
+    return true;
+}
+
+// group-by <column>: one record per distinct value, in order of first
+// appearance, with a count and the sums of the shown numeric columns.
+bool RecordBatch::groupBy(const std::vector<std::string>& args, std::string& error) {
+    if (args.size() != 1) {
+        error = "usage: group-by <column>";
+        return false;
+    }
+    size_t keyIndex = 0;
+    const Column* key = column(args[0], &keyIndex, error);
+    if (!key) return false;
+
+    std::vector<Column> grouped;
+    grouped.push_back(Column{key->name, key->type, false, {}, {}});
+    grouped.push_back(Column{"count", FieldType::Number, false, {}, {}});
+    std::vector<size_t> summed;
+    for (size_t index : m_shown) {
+        const Column& col = m_columns[index];
+        if (index != keyIndex && (col.type == FieldType::Number || col.type == FieldType::Bytes)) {
+            summed.push_back(index);
+            grouped.push_back(Column{col.name, col.type, false, {}, {}});
+        }
+    }
+
+    std::unordered_map<std::string, size_t> textGroups;
+    std::unordered_map<uint64_t, size_t> numberGroups;
+    size_t groups = 0;
+    for (uint32_t row : m_rows) {
+        bool inserted;
+        size_t group;
+        if (key->type == FieldType::Text) {
+            auto result = textGroups.emplace(key->texts[row], groups);
+            inserted = result.second;
+            group = result.first->second;
+        } else {
+            auto result = numberGroups.emplace(key->numbers[row], groups);
+            inserted = result.second;
+            group = result.first->second;
+        }
+        if (inserted) {
+            ++groups;
+            if (key->type == FieldType::Text) {
+                grouped[0].texts.push_back(key->texts[row]);
+            } else {
+                grouped[0].numbers.push_back(key->numbers[row]);
+            }
+            for (size_t i = 1; i < grouped.size(); ++i) {
+                grouped[i].numbers.push_back(0);
+            }
+        }
+        grouped[1].numbers[group]++;
+        for (size_t i = 0; i < summed.size(); ++i) {
+            grouped[i + 2].numbers[group] += m_columns[summed[i]].numbers[row];
+        }
+    }
+
+    *this = RecordBatch(std::move(grouped), groups);
+    return true;
+}
+
+// first <count>: keeps the first records.
+bool RecordBatch::first(const std::vector<std::string>& args, std::string& error) {
+    uint64_t count = 0;
+    if (args.size() != 1 || !parseValue(args[0], FieldType::Number, count)) {
+        error = "usage: first <count>";
+        return false;
+    }
+    if (count < m_rows.size()) m_rows.resize(static_cast<size_t>(count));
+    return true;
+}
+
+void RecordBatch::render(std::ostream& out) const {
+    std::vector<std::vector<std::string>> cells(m_shown.size());
+    std::vector<size_t> widths(m_shown.size());
+    for (size_t c = 0; c < m_shown.size(); ++c) {
+        const Column& col = m_columns[m_shown[c]];
+        widths[c] = col.name.size();
+        cells[c].reserve(m_rows.size());
+        for (uint32_t row : m_rows) {
+            cells[c].push_back(formatValue(col, row));
+            widths[c] = std::max(widths[c], cells[c].back().size());
+        }
+    }
+
+    // Every column but the last is padded to its widest value.
+    std::string line;
+    auto cell = [&](size_t c, const std::string& text) {
+        line += text;
+        if (c + 1 < m_shown.size()) line.append(widths[c] - text.size() + 2, ' ');
+    };
+    for (size_t c = 0; c < m_shown.size(); ++c) {
+        cell(c, m_columns[m_shown[c]].name);
+    }
+    out << line << "\n";
+    line.clear();
+    for (size_t c = 0; c < m_shown.size(); ++c) {
+        cell(c, std::string(widths[c], '-'));
+    }
+    out << line << "\n";
+    for (size_t r = 0; r < m_rows.size() && out; ++r) {
+        line.clear();
+        for (size_t c = 0; c < m_shown.size(); ++c) {
+            cell(c, cells[c][r]);
+        }
+        out << line << "\n";
+    }
+}
+
+RecordBatch processRecords(const std::vector<ProcessInfo>& processes) {
+    Column pid{"pid", FieldType::Id, false, {}, {}};
+    Column name{"name", FieldType::Text, false, {}, {}};
+    Column mem{"mem", FieldType::Bytes, false, {}, {}};
+    Column threads{"threads", FieldType::Number, false, {}, {}};
+    Column ppid{"ppid", FieldType::Id, true, {}, {}};
+    Column path{"path", FieldType::Text, true, {}, {}};
+    for (const auto& proc : processes) {
+        pid.numbers.push_back(proc.pid);
+        name.texts.push_back(proc.name);
+        mem.numbers.push_back(proc.memoryUsage);
+        threads.numbers.push_back(proc.threadCount);
+        ppid.numbers.push_back(proc.parentPid);
+        path.texts.push_back(proc.path);
+    }
+    return RecordBatch({std::move(pid), std::move(name), std::move(mem), std::move(threads),
+                        std::move(ppid), std::move(path)}, processes.size());
+}
+
+RecordBatch connectionRecords(const std::vector<ConnectionInfo>& connections) {
+    Column proto{"proto", FieldType::Text, false, {}, {}};
+    Column local{"local", FieldType::Text, false, {}, {}};
+    Column remote{"remote", FieldType::Text, false, {}, {}};
+    Column state{"state", FieldType::Text, false, {}, {}};
+    Column pid{"pid", FieldType::Id, false, {}, {}};
+    Column lport{"lport", FieldType::Id, true, {}, {}};
+    Column rport{"rport", FieldType::Id, true, {}, {}};
+    for (const auto& conn : connections) {
+        bool udp = conn.protocol == "UDP";
+        proto.texts.push_back(conn.protocol);
+        local.texts.push_back(conn.localAddress + ":" + std::to_string(conn.localPort));
+        remote.texts.push_back(udp ? "*:*" : conn.remoteAddress + ":" + std::to_string(conn.remotePort));
+        state.texts.push_back(conn.state);
+        pid.numbers.push_back(conn.pid);
+        lport.numbers.push_back(conn.localPort);
+        rport.numbers.push_back(udp ? 0 : conn.remotePort);
+    }
+    return RecordBatch({std::move(proto), std::move(local), std::move(remote), std::move(state),
+                        std::move(pid), std::move(lport), std::move(rport)}, connections.size());
+}
+
+RecordBatch serviceRecords(const std::vector<ServiceInfo>& services) {
+    Column name{"name", FieldType::Text, false, {}, {}};
+    Column state{"state", FieldType::Text, false, {}, {}};
+    Column start{"start", FieldType::Text, false, {}, {}};
+    Column display{"display", FieldType::Text, true, {}, {}};
+    for (const auto& svc : services) {
+        name.texts.push_back(svc.name);
+        state.texts.push_back(svc.stateStr);
+        start.texts.push_back(svc.startTypeStr);
+        display.texts.push_back(svc.displayName);
+    }
+    return RecordBatch({std::move(name), std::move(state), std::move(start), std::move(display)},
+                       services.size());
+}
+
+RecordBatch fileRecords(const std::vector<FileInfo>& files, bool recursive) {
+    Column name{"name", FieldType::Text, false, {}, {}};
+    Column type{"type", FieldType::Text, false, {}, {}};
+    Column size{"size", FieldType::Bytes, false, {}, {}};
+    Column modified{"modified", FieldType::Time, false, {}, {}};
+    Column created{"created", FieldType::Time, true, {}, {}};
+    Column path{"path", FieldType::Text, true, {}, {}};
+    for (const auto& file : files) {
+        name.texts.push_back(recursive ? file.path : file.name);
+        type.texts.push_back(file.isDirectory ? "dir" : "file");
+        size.numbers.push_back(file.isDirectory ? 0 : static_cast<uint64_t>(file.size.QuadPart));
+        modified.numbers.push_back(fileTimeTicks(file.modified));
+        created.numbers.push_back(fileTimeTicks(file.created));
+        path.texts.push_back(file.path);
+    }
+    return RecordBatch({std::move(name), std::move(type), std::move(size), std::move(modified),
+                        std::move(created), std::move(path)}, files.size());
+}
+
+RecordBatch adapterRecords(const std::vector<AdapterInfo>& adapters) {
+    Column name{"name", FieldType::Text, false, {}, {}};
+    Column ip{"ip", FieldType::Text, false, {}, {}};
+    Column mac{"mac", FieldType::Text, false, {}, {}};
+    Column gateway{"gateway", FieldType::Text, false, {}, {}};
+    Column subnet{"subnet", FieldType::Text, true, {}, {}};
+    Column dhcp{"dhcp", FieldType::Text, true, {}, {}};
+    Column id{"id", FieldType::Text, true, {}, {}};
+    for (const auto& adapter : adapters) {
+        name.texts.push_back(adapter.description);
+        ip.texts.push_back(adapter.ipAddress);
+        mac.texts.push_back(adapter.macAddress);
+        gateway.texts.push_back(adapter.gateway);
+        subnet.texts.push_back(adapter.subnet);
+        dhcp.texts.push_back(adapter.dhcpEnabled ? adapter.dhcpServer : "off");
+        id.texts.push_back(adapter.name);
+    }
+    return RecordBatch({std::move(name), std::move(ip), std::move(mac), std::move(gateway),
+                        std::move(subnet), std::move(dhcp), std::move(id)}, adapters.size());
+}
+
+static bool hasFlag(const std::string& program, uint8_t flag) {
+    const BuiltinName* builtin = findBuiltin(program);
+    return builtin && (builtin->flags & flag);
+}
+
+// The parser reads `where mem > 100MB` as `where mem` writing to 100MB,
+// `where mem >=1GB` as writing to "=1GB" and `where mem >= 1GB` as
+// `where mem 1GB` writing to "="; put the comparison back. When a real
+// redirect follows (`where mem > 100MB > big.txt`), the comparison is the
+// output redirect it replaced.
+static void comparisonFromRedirect(Command& where) {
+    if (where.program != "where" || where.args.empty() || where.args.size() > 2) return;
+
+    Redirect& redirect = where.inputRedirect.type != RedirectType::None ? where.inputRedirect
+                       : where.replacedOutput.type != RedirectType::None ? where.replacedOutput
+                       : where.outputRedirect;
+    if (redirect.type == RedirectType::None || redirect.type == RedirectType::Append) return;
+
+    std::string op = redirect.type == RedirectType::Input ? "<" : ">";
+    std::string value = redirect.filename;
+    if (where.args.size() == 2) {
+        if (value != "=") return;
+        op += "=";
+        value = where.args[1];
+        where.args.pop_back();
+    } else if (!value.empty() && value[0] == '=') {
+        op += "=";
+        value.erase(0, 1);
+    }
+    where.args.push_back(op);
+    where.args.push_back(value);
+    redirect = Redirect();
+}
+
+void foldRecordStages(Pipeline& pipeline) {
+    auto& commands = pipeline.commands;
+    size_t kept = 0;
+    for (size_t i = 0; i < commands.size(); ++i) {
+        Command& cmd = commands[i];
+        if (kept > 0 && hasFlag(cmd.program, BUILTIN_RECORD_OP)) {
+            Command& producer = commands[kept - 1];
+            if (hasFlag(producer.program, BUILTIN_RECORDS) && producer.outputRedirect.type == RedirectType::None) {
+                comparisonFromRedirect(cmd);
+                producer.outputRedirect = cmd.outputRedirect;
+                cmd.outputRedirect = Redirect();
+                producer.recordOps.push_back(std::move(cmd));
+                continue;
+            }
+        }
+        if (kept != i) commands[kept] = std::move(cmd);
+        ++kept;
+    }
+    commands.resize(kept);
+}
+
+}
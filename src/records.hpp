@@ -0,0 +1,76 @@
+#pragma once
+#include "common.hpp"
+#include "parser.hpp"
+#include "modules/process.hpp"
+#include "modules/files.hpp"
+#include "modules/network.hpp"
+#include "modules/services.hpp"
+
+namespace WaleedShell {
+
+// How a column's values compare, print and combine.
+enum class FieldType : uint8_t {
+    Text,
+    // A number that names something, such as a pid or port: never summed.
+    Id,
+    Number,
+    // Printed as a size; compared against values like 100MB.
+    Bytes,
+    // FILETIME ticks, printed and compared as YYYY-MM-DD HH:MM (UTC).
+    Time
+};
+
+// One column: `numbers` holds the values of every type but Text.
+struct Column {
+    std::string name;
+    FieldType type = FieldType::Text;
+    // Rendered only when asked for by `select`.
+    bool hidden = false;
+    std::vector<uint64_t> numbers;
+    std::vector<std::string> texts;
+};
+
+// Typed records from one builtin, kept as columns. Operators narrow and
+// reorder the row indices and choose the shown columns, so values are
+// only formatted by render(), once, for the rows that are left.
+class RecordBatch {
+public:
+    RecordBatch() = default;
+    RecordBatch(std::vector<Column> columns, size_t rows);
+
+    // Runs one operator stage (where, sort-by, select, group-by, first).
+    // On a bad argument nothing changes and `error` says why.
+    bool apply(const Command& op, std::string& error);
+    // Aligned columns under a header line.
+    void render(std::ostream& out) const;
+    size_t rows() const { return m_rows.size(); }
+
+private:
+    std::vector<Column> m_columns;
+    std::vector<uint32_t> m_rows;
+    std::vector<size_t> m_shown;
+
+    const Column* column(const std::string& name, size_t* index, std::string& error) const;
+    bool where(const std::vector<std::string>& args, std::string& error);
+    bool sortBy(const std::vector<std::string>& args, std::string& error);
+    bool select(const std::vector<std::string>& args, std::string& error);
+    bool groupBy(const std::vector<std::string>& args, std::string& error);
+    bool first(const std::vector<std::string>& args, std::string& error);
+};
+
+RecordBatch processRecords(const std::vector<ProcessInfo>& processes);
+RecordBatch connectionRecords(const std::vector<ConnectionInfo>& connections);
+RecordBatch serviceRecords(const std::vector<ServiceInfo>& services);
+RecordBatch fileRecords(const std::vector<FileInfo>& files, bool recursive);
+RecordBatch adapterRecords(const std::vector<AdapterInfo>& adapters);
+
+// Moves each record operator into the stage before it when that stage
+// emits records, so the pair runs as one stage and only text leaves it.
+// A `where` missing its comparison takes it from the redirect the parser
+// made of it: `where mem > 100MB` compares rather than writing a file.
+// With a second `>`, the first is the comparison and the last the file.
+// Folded pipelines have nothing left to fold, so running this again on
+// a cached pipeline does nothing.
+void foldRecordStages(Pipeline& pipeline);
+
+}
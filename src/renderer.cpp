@@ -0,0 +1,373 @@
+#include "renderer.hpp"
+
+namespace WaleedShell {
+
+// Used when the output is not a console and has no width to ask for.
+static const size_t DEFAULT_WIDTH = 80;
+
+// SGR sequence selecting each Ink. Every one sets the underline too, so
+// switching between any two needs a single sequence.
+static const char* const INK_SGR[] = {
+    "\x1b[39;24m",  // Default
+    "\x1b[90;24m",  // Hint
+    "\x1b[92;24m",  // Command
+    "\x1b[91;24m",  // Unknown
+    "\x1b[33;24m",  // String
+    "\x1b[36;24m",  // Operator
+    "\x1b[35;24m",  // Redirect
+    "\x1b[31;4m"    // Missing
+};
+
+// Appends next[from, from + count), switching ink wherever it changes.
+// `pen` is the ink in effect and is kept up to date.
+static void paint(std::string& out, const std::string& next, const std::vector<Ink>& inks,
+                  size_t from, size_t count, Ink& pen) {
+    size_t end = from + count;
+    while (from < end) {
+        size_t run = from + 1;
+        while (run < end && inks[run] == inks[from]) {
+            ++run;
+        }
+        if (inks[from] != pen) {
+            pen = inks[from];
+            out += INK_SGR[(size_t)pen];
+        }
+        out.append(next, from, run - from);
+        from = run;
+    }
+}
+
+static void restorePen(std::string& out, Ink& pen) {
+    if (pen != Ink::Default) {
+        pen = Ink::Default;
+        out += INK_SGR[(size_t)pen];
+    }
+}
+
+LineRenderer::LineRenderer(HANDLE output)
+    : m_output(output), m_hintStart(0), m_cursor(0), m_width(DEFAULT_WIDTH), m_menuRows(0), m_vt(false),
+      m_originalMode(0), m_restoreMode(false), m_bytesWritten(0) {}
+
+void LineRenderer::begin(const std::string& prompt) {
+    std::cout.flush();
+
+    // VT processing is switched on only while a line is being edited, so
+    // programs run from the shell see the console as they always have.
+    m_restoreMode = false;
+    DWORD mode;
+    if (GetConsoleMode(m_output, &mode)) {
+        m_originalMode = mode;
+        m_vt = (mode & ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
+        if (!m_vt && SetConsoleMode(m_output, mode | ENABLE_PROCESSED_OUTPUT | ENABLE_VIRTUAL_TERMINAL_PROCESSING)) {
+            m_vt = true;
+            m_restoreMode = true;
+        }
+    } else {
+        m_vt = false;
+    }
+
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    m_width = GetConsoleScreenBufferInfo(m_output, &info) && info.dwSize.X > 0 ? (size_t)info.dwSize.X : DEFAULT_WIDTH;
+
+    size_t newline = prompt.rfind('\n');
+    std::string head = newline == std::string::npos ? std::string() : prompt.substr(0, newline + 1);
+    m_prefix = prompt.substr(head.size());
+    m_shown.clear();
+    m_shownInks.clear();
+    m_hintStart = 0;
+    m_cursor = 0;
+    m_menuRows = 0;
+    write(head + compose(m_prefix, GapBuffer(), 0));
+}
+
+void LineRenderer::reset(const std::string& prefix, size_t width, bool vt) {
+    m_prefix = prefix;
+    m_shown.clear();
+    m_shownInks.clear();
+    m_hintStart = 0;
+    m_cursor = 0;
+    m_width = width ? width : DEFAULT_WIDTH;
+    m_menuRows = 0;
+    m_vt = vt;
+    m_restoreMode = false;
+    compose(m_prefix, GapBuffer(), 0);
+}
+
+void LineRenderer::write(const std::string& data) {
+    if (data.empty()) return;
+    DWORD written;
+    WriteFile(m_output, data.data(), (DWORD)data.size(), &written, NULL);
+    m_bytesWritten += data.size();
+}
+
+// Relative moves only, so the sequence stays right after the console has
+// scrolled. Short hops back within a row are plain backspaces.
+void LineRenderer::moveTo(std::string& out, size_t from, size_t to) const {
+    size_t fromRow = from / m_width;
+    size_t fromCol = from % m_width;
+    size_t toRow = to / m_width;
+    size_t toCol = to % m_width;
+
+    if (toRow < fromRow) {
+        out += "\x1b[" + std::to_string(fromRow - toRow) + "A";
+    } else if (toRow > fromRow) {
+        out += "\x1b[" + std::to_string(toRow - fromRow) + "B";
+    }
+
+    if (toCol == fromCol) return;
+    if (toCol == 0) {
+        out += '\r';
+    } else if (toCol < fromCol && fromCol - toCol <= 3) {
+        out.append(fromCol - toCol, '\b');
+    } else if (toCol < fromCol) {
+        out += "\x1b[" + std::to_string(fromCol - toCol) + "D";
+    } else {
+        out += "\x1b[" + std::to_string(toCol - fromCol) + "C";
+    }
+}
+
+// Rewrites everything from the first changed character on.
+std::string LineRenderer::rewrite(const std::string& next, const std::vector<Ink>& inks, size_t same,
+                                  size_t target) const {
+    std::string out;
+    Ink pen = Ink::Default;
+    moveTo(out, m_cursor, same);
+    paint(out, next, inks, same, next.size() - same, pen);
+    restorePen(out, pen);
+
+    // A line ending exactly at the right margin leaves the console waiting
+    // to wrap; moving to the next row makes the position unambiguous.
+    if (next.size() > same && next.size() % m_width == 0) {
+        out += "\r\n";
+    }
+    if (next.size() < m_shown.size()) {
+        out += "\x1b[J";
+    }
+    moveTo(out, next.size(), target);
+    return out;
+}
+
+// `count` characters were inserted at `at`. Each row from there on is
+// shifted right in place with ICH and only the characters that moved in
+// from the row above, or were typed, are written.
+std::string LineRenderer::insertShift(const std::string& next, const std::vector<Ink>& inks, size_t at, size_t count,
+                                      size_t target) const {
+    std::string out;
+    Ink pen = Ink::Default;
+    size_t length = next.size();
+    size_t firstRow = at / m_width;
+    size_t lastRow = (length - 1) / m_width;
+    size_t pos = at;
+    moveTo(out, m_cursor, at);
+
+    for (size_t row = firstRow; row <= lastRow; ++row) {
+        size_t start = row == firstRow ? at : row * m_width;
+        size_t rowEnd = std::min((row + 1) * m_width, length);
+        if (row > firstRow) {
+            out += "\r\n";
+        }
+
+        // The rest of the row is written out when the insertion reaches
+        // past it, on rows the old line never had, and on a last row that
+        // ends at the margin so the cursor can wrap past it.
+        size_t written;
+        bool overwrite = start % m_width + count >= m_width || start >= m_shown.size() ||
+                         (row == lastRow && length % m_width == 0);
+        if (overwrite) {
+            written = rowEnd - start;
+        } else {
+            out += "\x1b[" + std::to_string(count) + "@";
+            written = std::min(count, rowEnd - start);
+        }
+        paint(out, next, inks, start, written, pen);
+        pos = start + written;
+    }
+    restorePen(out, pen);
+
+    if (pos % m_width == 0) {
+        out += "\r\n";
+    }
+    moveTo(out, pos, target);
+    return out;
+}
+
+// `count` characters were deleted at `at`: the mirror of insertShift with
+// DCH, refilling the end of each row from the row below. Whatever the old
+// line had past the new end is erased.
+std::string LineRenderer::deleteShift(const std::string& next, const std::vector<Ink>& inks, size_t at, size_t count,
+                                      size_t target) const {
+    std::string out;
+    Ink pen = Ink::Default;
+    size_t length = next.size();
+    size_t firstRow = at / m_width;
+    size_t lastRow = length == 0 ? 0 : (length - 1) / m_width;
+    size_t pos = at;
+    bool atMargin = false;
+    bool shifted = false;
+    moveTo(out, m_cursor, at);
+
+    for (size_t row = firstRow; row <= lastRow && at < length; ++row) {
+        size_t start = row == firstRow ? at : row * m_width;
+        size_t rowEnd = std::min((row + 1) * m_width, length);
+        if (row > firstRow) {
+            out += "\r\n";
+        }
+
+        if (start % m_width + count >= m_width) {
+            paint(out, next, inks, start, rowEnd - start, pen);
+            pos = rowEnd;
+            atMargin = rowEnd % m_width == 0;
+            shifted = false;
+            continue;
+        }
+        out += "\x1b[" + std::to_string(count) + "P";
+        pos = start;
+        atMargin = false;
+        shifted = true;
+        size_t fillFrom = (row + 1) * m_width - count;
+        if (fillFrom < rowEnd) {
+            moveTo(out, start, fillFrom);
+            paint(out, next, inks, fillFrom, rowEnd - fillFrom, pen);
+            pos = rowEnd;
+            atMargin = rowEnd % m_width == 0;
+        }
+    }
+
+    restorePen(out, pen);
+
+    // DCH on the old line's last row already blanked its end; anything
+    // else, including menu rows below, needs an explicit erase.
+    bool cleared = shifted && m_menuRows == 0 && (m_shown.size() - 1) / m_width == lastRow;
+    if (atMargin) {
+        out += "\r\n";
+        pos = length;
+    }
+    if (!cleared) {
+        moveTo(out, pos, length);
+        out += "\x1b[J";
+        pos = length;
+    }
+    moveTo(out, pos, target);
+    return out;
+}
+
+std::string LineRenderer::compose(const std::string& prefix, const GapBuffer& line, size_t cursor,
+                                  const std::string& hint, const std::vector<Ink>& inks) {
+    size_t hintStart = prefix.size() + line.size();
+    size_t target = prefix.size() + std::min(cursor, line.size());
+    size_t oldLength = m_shown.size();
+
+    std::string next;
+    next.reserve(hintStart + hint.size());
+    next += prefix;
+    for (size_t i = 0; i < line.size(); ++i) {
+        next += line[i];
+    }
+
+    std::string out;
+    std::vector<Ink> nextInks;
+    if (!m_vt) {
+        size_t length = next.size();
+        size_t blanks = oldLength > length ? oldLength - length : 0;
+        out += '\r';
+        out += next;
+        out.append(blanks, ' ');
+        out.append(blanks + length - target, '\b');
+    } else {
+        next += hint;
+        size_t length = next.size();
+        nextInks.reserve(length);
+        nextInks.assign(prefix.size(), Ink::Default);
+        for (size_t i = 0; i < line.size(); ++i) {
+            nextInks.push_back(i < inks.size() ? inks[i] : Ink::Default);
+        }
+        nextInks.resize(length, Ink::Hint);
+
+        size_t limit = std::min(length, oldLength);
+        size_t same = 0;
+        while (same < limit && m_shown[same] == next[same] && m_shownInks[same] == nextInks[same]) {
+            ++same;
+        }
+
+        if (same == length && same == oldLength) {
+            moveTo(out, m_cursor, target);
+        } else {
+            out = rewrite(next, nextInks, same, target);
+
+            // A pure insertion or deletion is often cheaper as a shift of
+            // the rows after it than as a rewrite of everything that follows.
+            size_t shorter = limit - same;
+            size_t suffix = 0;
+            while (suffix < shorter && m_shown[oldLength - 1 - suffix] == next[length - 1 - suffix] &&
+                   m_shownInks[oldLength - 1 - suffix] == nextInks[length - 1 - suffix]) {
+                ++suffix;
+            }
+            size_t delta = length > oldLength ? length - oldLength : oldLength - length;
+            if (suffix == shorter && delta > 0 && delta < m_width) {
+                std::string shifted = length > oldLength ? insertShift(next, nextInks, same, delta, target)
+                                                         : deleteShift(next, nextInks, same, delta, target);
+                if (shifted.size() < out.size()) out.swap(shifted);
+            }
+            if (length < oldLength) {
+                m_menuRows = 0;
+            }
+        }
+    }
+
+    m_shown.swap(next);
+    m_shownInks.swap(nextInks);
+    m_hintStart = hintStart;
+    m_cursor = target;
+    return out;
+}
+
+void LineRenderer::render(const std::string& prefix, const GapBuffer& line, size_t cursor,
+                          const std::string& hint, const std::vector<Ink>& inks) {
+    write(compose(prefix, line, cursor, hint, inks));
+}
+
+void LineRenderer::menu(const std::vector<std::string>& rows, size_t selected) {
+    if (!m_vt || (rows.empty() && m_menuRows == 0)) return;
+
+    std::string out;
+    size_t end = m_shown.size();
+    moveTo(out, m_cursor, end);
+    out += "\x1b[K";
+    for (size_t r = 0; r < rows.size(); ++r) {
+        std::string text = rows[r].substr(0, m_width - 1);
+        out += "\r\n";
+        out += r == selected ? "\x1b[7m" + text + "\x1b[27m" : text;
+        out += "\x1b[K";
+    }
+    out += "\x1b[J";
+
+    size_t up = rows.size() + end / m_width - m_cursor / m_width;
+    if (up > 0) {
+        out += "\x1b[" + std::to_string(up) + "A";
+    }
+    out += "\x1b[" + std::to_string(m_cursor % m_width + 1) + "G";
+    m_menuRows = rows.size();
+    write(out);
+}
+
+void LineRenderer::finish() {
+    std::string out;
+    if (m_vt) {
+        // A hint still showing is erased; the line is left as typed.
+        size_t end = m_hintStart;
+        moveTo(out, m_cursor, end);
+        if (m_menuRows > 0 || end < m_shown.size()) out += "\x1b[J";
+        if (end == 0 || end % m_width != 0) out += "\r\n";
+    } else {
+        out += "\r\n";
+    }
+    write(out);
+    m_menuRows = 0;
+
+    if (m_restoreMode) {
+        SetConsoleMode(m_output, m_originalMode);
+        m_restoreMode = false;
+    }
+}
+
+}
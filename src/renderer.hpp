@@ -0,0 +1,89 @@
+#pragma once
+#include "common.hpp"
+#include "linebuffer.hpp"
+
+namespace WaleedShell {
+
+// Foreground colour of one character of the line.
+enum class Ink : uint8_t {
+    Default,
+    Hint,
+    Command,
+    Unknown,
+    String,
+    Operator,
+    Redirect,
+    Missing
+};
+
+// Draws the input line by diffing it against what is already on screen.
+// Each render() finds the first character that changed, moves there, writes
+// only the changed tail, erases what the old line left behind and puts the
+// cursor back, all composed into one buffer and sent in one write. A
+// character whose colour changed counts as changed. When
+// the change is a plain insertion or deletion, shifting the following rows
+// with the console's insert/delete-character sequences is tried as well
+// and the shorter of the two is sent. Cursor
+// positions are tracked in screen rows and columns, so lines wrapping past
+// the console width are redrawn correctly.
+//
+// This relies on the console's VT processing. Without it (consoles older
+// than Windows 10) each render rewrites the whole line with '\r' and '\b',
+// still in one write, and neither colours, hints nor menu rows are drawn.
+class LineRenderer {
+public:
+    explicit LineRenderer(HANDLE output);
+
+    // Writes the prompt and starts tracking a new line after it. Everything
+    // up to the prompt's last newline is printed as is; the rest prefixes
+    // the edited text on every render.
+    void begin(const std::string& prompt);
+    // Starts tracking without touching the console, for measuring what
+    // edits cost: compose() then returns the bytes a render would write.
+    void reset(const std::string& prefix, size_t width, bool vt);
+
+    // `inks` colours the line character by character; missing entries are
+    // Default. `hint` is drawn in grey after the line, as an autosuggestion;
+    // the cursor never moves into it.
+    void render(const GapBuffer& line, size_t cursor, const std::string& hint = std::string(),
+                const std::vector<Ink>& inks = std::vector<Ink>()) {
+        render(m_prefix, line, cursor, hint, inks);
+    }
+    // Draws `line` after a different prefix, as reverse search does.
+    void render(const std::string& prefix, const GapBuffer& line, size_t cursor,
+                const std::string& hint = std::string(), const std::vector<Ink>& inks = std::vector<Ink>());
+    // Rows listed under the line with `selected` in reverse video; an empty
+    // list erases them. The cursor stays on the line.
+    void menu(const std::vector<std::string>& rows, size_t selected);
+    // Leaves the cursor at the start of the row after the line.
+    void finish();
+
+    std::string compose(const std::string& prefix, const GapBuffer& line, size_t cursor,
+                        const std::string& hint = std::string(), const std::vector<Ink>& inks = std::vector<Ink>());
+    bool hasVt() const { return m_vt; }
+    uint64_t bytesWritten() const { return m_bytesWritten; }
+
+private:
+    HANDLE m_output;
+    std::string m_prefix;
+    std::string m_shown;
+    std::vector<Ink> m_shownInks;
+    size_t m_hintStart;
+    size_t m_cursor;
+    size_t m_width;
+    size_t m_menuRows;
+    bool m_vt;
+    DWORD m_originalMode;
+    bool m_restoreMode;
+    uint64_t m_bytesWritten;
+
+    void write(const std::string& data);
+    void moveTo(std::string& out, size_t from, size_t to) const;
+    std::string rewrite(const std::string& next, const std::vector<Ink>& inks, size_t same, size_t target) const;
+    std::string insertShift(const std::string& next, const std::vector<Ink>& inks, size_t at, size_t count,
+                            size_t target) const;
+    std::string deleteShift(const std::string& next, const std::vector<Ink>& inks, size_t at, size_t count,
+                            size_t target) const;
+};
+
+}
@@ -0,0 +1,137 @@
+#include "scanner.hpp"
+#include <array>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define WSHELL_SCAN_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define WSHELL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define WSHELL_TARGET(isa)
+#endif
+
+namespace WaleedShell {
+
+static constexpr std::array<bool, 256> makeBreakTable() {
+    std::array<bool, 256> table{};
+    for (char c : WORD_BREAK_CHARS) {
+        table[static_cast<unsigned char>(c)] = true;
+    }
+    return table;
+}
+
+static constexpr std::array<bool, 256> BREAK_TABLE = makeBreakTable();
+
+static size_t scanScalar(const char* data, size_t size, size_t pos) {
+    while (pos < size && !BREAK_TABLE[static_cast<unsigned char>(data[pos])]) {
+        ++pos;
+    }
+    return pos;
+}
+
+#ifdef WSHELL_SCAN_X86
+
+static unsigned lowestBit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+WSHELL_TARGET("sse2")
+static size_t scanSse2(const char* data, size_t size, size_t pos) {
+    while (pos + 16 <= size) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i hits = _mm_cmpeq_epi8(chunk, _mm_set1_epi8(WORD_BREAK_CHARS[0]));
+        for (size_t k = 1; k < WORD_BREAK_CHARS.size(); ++k) {
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(WORD_BREAK_CHARS[k])));
+        }
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+        if (mask) return pos + lowestBit(mask);
+        pos += 16;
+    }
+    return scanScalar(data, size, pos);
+}
+
+WSHELL_TARGET("avx2")
+static size_t scanAvx2(const char* data, size_t size, size_t pos) {
+    while (pos + 32 <= size) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        __m256i hits = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(WORD_BREAK_CHARS[0]));
+        for (size_t k = 1; k < WORD_BREAK_CHARS.size(); ++k) {
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(WORD_BREAK_CHARS[k])));
+        }
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+        if (mask) return pos + lowestBit(mask);
+        pos += 32;
+    }
+    return scanSse2(data, size, pos);
+}
+
+static bool cpuHasAvx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    return osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+static ScanBackend detectBackend() {
+#ifdef WSHELL_SCAN_X86
+    return cpuHasAvx2() ? ScanBackend::Avx2 : ScanBackend::Sse2;
+#else
+    return ScanBackend::Scalar;
+#endif
+}
+
+ScanBackend activeScanBackend() {
+    static const ScanBackend backend = detectBackend();
+    return backend;
+}
+
+size_t findWordBreak(ScanBackend backend, std::string_view input, size_t pos) {
+#ifdef WSHELL_SCAN_X86
+    if (backend == ScanBackend::Avx2 && activeScanBackend() == ScanBackend::Avx2) {
+        return scanAvx2(input.data(), input.size(), pos);
+    }
+    if (backend != ScanBackend::Scalar) {
+        return scanSse2(input.data(), input.size(), pos);
+    }
+#else
+    (void)backend;
+#endif
+    return scanScalar(input.data(), input.size(), pos);
+}
+
+// Most words on a command line end within a few bytes, where setting up
+// the vector compares costs more than the scalar loop, so the first bytes
+// are checked one at a time and only a longer run goes to the vectors.
+static const size_t SCALAR_LEAD = 16;
+
+size_t findWordBreak(std::string_view input, size_t pos) {
+    size_t lead = std::min(input.size(), pos + SCALAR_LEAD);
+    size_t end = scanScalar(input.data(), lead, pos);
+    if (end < lead || lead == input.size()) return end;
+    return findWordBreak(activeScanBackend(), input, lead);
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "common.hpp"
+#include <string_view>
+
+namespace WaleedShell {
+
+enum class ScanBackend {
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+// Bytes that end a plain run inside a word: blanks, quotes and operators.
+constexpr std::string_view WORD_BREAK_CHARS = " \t|<>\"';&()";
+
+// Index of the first word-break byte at or after pos, or input.size().
+// Past the first few bytes, uses the widest vector unit the CPU supports,
+// detected once at startup.
+size_t findWordBreak(std::string_view input, size_t pos);
+
+// Same scan on an explicit backend; lets the vector paths be checked
+// against the scalar one. Unsupported backends fall back to scalar.
+size_t findWordBreak(ScanBackend backend, std::string_view input, size_t pos);
+
+ScanBackend activeScanBackend();
+
+}
@@ -2,11 +2,19 @@
 
 namespace WaleedShell {
 
-Shell::Shell() : m_running(true) {
+Shell::Shell() : m_running(true), m_lastStatus(0), m_aliasVersion(0),
+                 m_cmdManager(m_fileManager, m_sysInfoManager), m_benchmark(m_executor) {
     char buffer[MAX_PATH];
     GetCurrentDirectoryA(MAX_PATH, buffer);
     m_currentDir = buffer;
     m_executor.setShell(this);
+    m_executor.setExecutableIndex(&m_executables);
+    m_input.setExecutableIndex(&m_executables);
+    m_input.setCommandCheck([this](const std::string& name) {
+        return findBuiltin(name) || m_executor.isCmdBuiltin(name) || m_aliases.count(name) > 0;
+    });
+    m_history.open(HistoryStore::defaultPath());
+    m_input.setHistory(&m_history);
 }
 
 void Shell::printBanner() {
@@ -22,32 +30,6 @@ std::string Shell::getPrompt() {
     return m_currentDir + "\n" + PROMPT;
 }
 
-std::string Shell::findExecutable(const std::string& program) {
-    std::vector<std::string> extensions = {"", ".exe", ".cmd", ".bat", ".com"};
-    
-    char pathEnv[32767];
-    GetEnvironmentVariableA("PATH", pathEnv, 32767);
-    
-    std::vector<std::string> paths;
-    paths.push_back(".");
-    
-    std::stringstream ss(pathEnv);
-    std::string path;
-    while (std::getline(ss, path, ';')) {
-        if (!path.empty()) paths.push_back(path);
-    }
-    
-    for (const auto& dir : paths) {
-        for (const auto& ext : extensions) {
-            std::string fullPath = dir + "\\" + program + ext;
-            if (GetFileAttributesA(fullPath.c_str()) != INVALID_FILE_ATTRIBUTES) {
-                return fullPath;
-            }
-        }
-    }
-    return "";
-}
-
 std::string Shell::expandAliases(const std::string& input) {
     std::string result = input;
     size_t spacePos = input.find(' ');
@@ -64,685 +46,900 @@ std::string Shell::expandAliases(const std::string& input) {
 }
 
 bool Shell::isBuiltin(const std::string& cmd) {
-    static std::vector<std::string> builtins = {
-        "exit", "quit", "help", "clear", "cls", "cd", "pwd",
-        "history", "alias", "unalias", "which", "env", "export",
-        "ps", "kill", "start", "pinfo",
-        "ls", "cat", "touch", "rm", "mkdir", "rmdir", "cp", "mv", "find", "finfo",
-        "sysinfo", "meminfo", "diskinfo", "uptime",
-        "reg",
-        "netstat", "adapters", "ping", "resolve",
-        "services", "svc"
-    };
-    return std::find(builtins.begin(), builtins.end(), cmd) != builtins.end();
+    const BuiltinName* builtin = findBuiltin(cmd);
+    return builtin && builtin->id < Builtin::Cmd;
 }
 
-std::string Shell::executeBuiltinCapture(Command& cmd) {
-    std::stringstream ss;
-    
-    if (cmd.program == "pwd") {
-        ss << m_currentDir << "\n";
-    }
-    else if (cmd.program == "history") {
-        auto& history = m_input.getHistory();
-        for (size_t i = 0; i < history.size(); ++i) {
-            ss << "  " << (i + 1) << "  " << history[i] << "\n";
-        }
-    }
-    else if (cmd.program == "alias") {
-        if (cmd.args.empty()) {
-            for (const auto& [name, value] : m_aliases) {
-                ss << "  " << name << "='" << value << "'\n";
-            }
-        }
-    }
-    else if (cmd.program == "which") {
-        if (!cmd.args.empty()) {
-            std::string path = findExecutable(cmd.args[0]);
-            if (!path.empty()) {
-                ss << path << "\n";
-            } else {
-                ss << cmd.args[0] << " not found\n";
-            }
-        }
-    }
-    else if (cmd.program == "env") {
-        char* env = GetEnvironmentStringsA();
-        if (env) {
-            char* ptr = env;
-            while (*ptr) {
-                ss << ptr << "\n";
-                ptr += strlen(ptr) + 1;
-            }
-            FreeEnvironmentStringsA(env);
-        }
-    }
-    else if (cmd.program == "export") {
-        if (!cmd.args.empty()) {
-            std::string arg = cmd.args[0];
-            size_t eqPos = arg.find('=');
-            if (eqPos == std::string::npos) {
-                char buffer[32767];
-                if (GetEnvironmentVariableA(arg.c_str(), buffer, 32767)) {
-                    ss << arg << "=" << buffer << "\n";
-                }
-            }
-        }
-    }
-    else if (cmd.program == "help") {
-        ss << "Built-in commands:\n";
-        ss << "  help, exit, clear, cd, pwd, history\n";
-        ss << "  alias, unalias, which, env, export\n";
-    }
-    
-    return ss.str();
+// cmd.exe internals count as builtins only in the forms CmdManager runs
+// natively; everything else still goes to cmd.exe. A record operator left
+// unfolded is no builtin either, so `where` on its own is where.exe.
+bool Shell::isBuiltin(const Command& cmd) {
+    return isBuiltin(cmd.program) || m_cmdManager.supports(cmd.program, cmd.args);
 }
 
-bool Shell::handleBuiltin(Command& cmd) {
-    if (cmd.program == "exit" || cmd.program == "quit") {
-        m_running = false;
-        std::cout << "Goodbye!\n";
-        return true;
-    }
+bool Shell::usesShellState(const std::string& cmd) {
+    const BuiltinName* builtin = findBuiltin(cmd);
+    return builtin && (builtin->flags & BUILTIN_SHELL_STATE);
+}
+
+// Builtins may run on pipeline stage threads, so each thread keeps the
+// status of the builtin it is running.
+static thread_local int t_builtinStatus = 0;
+
+std::ostream& Shell::fail() {
+    t_builtinStatus = 1;
+    return std::cerr;
+}
+
+int Shell::runBuiltin(Command& cmd, std::istream& in, std::ostream& out) {
+    t_builtinStatus = 0;
+    handleBuiltin(cmd, in, out);
+    out.flush();
+    return t_builtinStatus;
+}
+
+// True when `handlers` has one entry per Builtin, in Builtin order.
+template <typename Entry, size_t N>
+static constexpr bool coversBuiltins(const Entry (&handlers)[N]) {
+    if (N != (size_t)Builtin::Cmd) return false;
+    for (size_t i = 0; i < N; ++i) {
+        if ((size_t)handlers[i].id != i) return false;
+    }
+    return true;
+}
+
+// Names the registry marks only as cmd.exe internals are builtins just in
+// the forms CmdManager runs natively; everything else goes to cmd.exe.
+bool Shell::handleBuiltin(Command& cmd, std::istream& in, std::ostream& out) {
+    struct Handler {
+        Builtin id;
+        BuiltinHandler run;
+    };
+    static constexpr Handler handlers[] = {
+        {Builtin::Exit, &Shell::builtinExit}, {Builtin::Help, &Shell::builtinHelp},
+        {Builtin::Clear, &Shell::builtinClear}, {Builtin::Cd, &Shell::builtinCd},
+        {Builtin::Ps, &Shell::builtinPs}, {Builtin::Kill, &Shell::builtinKill},
+        {Builtin::Start, &Shell::builtinStart}, {Builtin::Pinfo, &Shell::builtinPinfo},
+        {Builtin::Jobs, &Shell::builtinJobs}, {Builtin::Wait, &Shell::builtinWait},
+        {Builtin::Ls, &Shell::builtinLs}, {Builtin::Grep, &Shell::builtinGrep},
+        {Builtin::Sort, &Shell::builtinSort}, {Builtin::Uniq, &Shell::builtinUniq},
+        {Builtin::Head, &Shell::builtinHead}, {Builtin::Tail, &Shell::builtinTail},
+        {Builtin::Wc, &Shell::builtinWc}, {Builtin::Cat, &Shell::builtinCat},
+        {Builtin::Touch, &Shell::builtinTouch}, {Builtin::Rm, &Shell::builtinRm},
+        {Builtin::Mkdir, &Shell::builtinMkdir}, {Builtin::Rmdir, &Shell::builtinRmdir},
+        {Builtin::Cp, &Shell::builtinCp}, {Builtin::Mv, &Shell::builtinMv},
+        {Builtin::Find, &Shell::builtinFind}, {Builtin::Finfo, &Shell::builtinFinfo},
+        {Builtin::Sysinfo, &Shell::builtinSysinfo}, {Builtin::Meminfo, &Shell::builtinMeminfo},
+        {Builtin::Diskinfo, &Shell::builtinDiskinfo}, {Builtin::Uptime, &Shell::builtinUptime},
+        {Builtin::Reg, &Shell::builtinReg}, {Builtin::Netstat, &Shell::builtinNetstat},
+        {Builtin::Adapters, &Shell::builtinAdapters}, {Builtin::Ping, &Shell::builtinPing},
+        {Builtin::Resolve, &Shell::builtinResolve}, {Builtin::Services, &Shell::builtinServices},
+        {Builtin::Svc, &Shell::builtinSvc}, {Builtin::Pwd, &Shell::builtinPwd},
+        {Builtin::History, &Shell::builtinHistory}, {Builtin::Alias, &Shell::builtinAlias},
+        {Builtin::Unalias, &Shell::builtinUnalias}, {Builtin::Which, &Shell::builtinWhich},
+        {Builtin::Hash, &Shell::builtinHash}, {Builtin::Env, &Shell::builtinEnv},
+        {Builtin::Export, &Shell::builtinExport}, {Builtin::Cache, &Shell::builtinCache},
+        {Builtin::Bench, &Shell::builtinBench}
+    };
+    static_assert(coversBuiltins(handlers), "one handler per Builtin, in order");
     
-    if (cmd.program == "help") {
-        std::cout << "WaleedShell Commands\n";
-        std::cout << "====================\n\n";
-
-        std::cout << "General:\n";
-        std::cout << "  help              - Show this message\n";
-        std::cout << "  exit              - Exit the shell\n";
-        std::cout << "  clear/cls         - Clear screen\n";
-        std::cout << "  cd <dir>          - Change directory\n";
-        std::cout << "  pwd               - Print working directory\n";
-        std::cout << "  history           - Command history\n";
-        std::cout << "  alias/unalias     - Manage aliases\n";
-        std::cout << "  which <cmd>       - Find executable\n";
-        std::cout << "  env/export        - Environment variables\n\n";
-
-        std::cout << "Process:\n";
-        std::cout << "  ps                - List processes\n";
-        std::cout << "  kill <pid|name>   - Terminate process\n";
-        std::cout << "  start <cmd>       - Start new process\n";
-        std::cout << "  pinfo <pid>       - Process details\n\n";
-
-        std::cout << "Files:\n";
-        std::cout << "  ls [path]         - List directory\n";
-        std::cout << "  cat <file>        - Display file\n";
-        std::cout << "  touch <file>      - Create file\n";
-        std::cout << "  rm <file>         - Delete file\n";
-        std::cout << "  cp <src> <dst>    - Copy file\n";
-        std::cout << "  mv <src> <dst>    - Move file\n";
-        std::cout << "  mkdir <dir>       - Create directory\n";
-        std::cout << "  rmdir <dir> [-r]  - Delete directory\n";
-        std::cout << "  find <pattern>    - Find files\n";
-        std::cout << "  finfo <file>      - File details\n\n";
-
-        std::cout << "System:\n";
-        std::cout << "  sysinfo           - System information\n";
-        std::cout << "  meminfo           - Memory information\n";
-        std::cout << "  diskinfo          - Disk information\n";
-        std::cout << "  uptime            - System uptime\n\n";
-
-        std::cout << "Registry:\n";
-        std::cout << "  reg query <key>   - Query registry\n";
-        std::cout << "  reg add <k> <v> <d> - Set value\n";
-        std::cout << "  reg delete <k> [v] - Delete key/value\n\n";
-
-        std::cout << "Network:\n";
-        std::cout << "  adapters          - Network adapters\n";
-        std::cout << "  netstat           - Connections\n";
-        std::cout << "  ping <host>       - Ping host\n";
-        std::cout << "  resolve <host>    - DNS lookup\n\n";
-
-        std::cout << "Services:\n";
-        std::cout << "  services [-r]     - List services\n";
-        std::cout << "  svc start <name>  - Start service\n";
-        std::cout << "  svc stop <name>   - Stop service\n";
-        std::cout << "  svc restart <name>- Restart service\n";
-        std::cout << "  svc info <name>   - Service details\n";
+    const BuiltinName* builtin = findBuiltin(cmd.program);
+    if (!builtin || builtin->id >= Builtin::Cmd) {
+        if (!m_cmdManager.supports(cmd.program, cmd.args)) return false;
+        t_builtinStatus = m_cmdManager.run(cmd.program, cmd.args, out);
         return true;
     }
-    
-    if (cmd.program == "clear" || cmd.program == "cls") {
-        system("cls");
+    if (!cmd.recordOps.empty()) {
+        runRecords(builtin->id, cmd, out);
         return true;
     }
-    
-    if (cmd.program == "cd") {
-        if (cmd.args.empty()) {
-            std::cout << m_currentDir << "\n";
+    (this->*handlers[(size_t)builtin->id].run)(cmd, in, out);
+    return true;
+}
+
+// A builtin with record operators folded into it hands them its records
+// as columns instead of printing them, and the result is printed once.
+void Shell::runRecords(Builtin id, Command& cmd, std::ostream& out) {
+    RecordBatch records;
+    if (id == Builtin::Ps) {
+        records = processRecords(m_processManager.listProcesses());
+    } else if (id == Builtin::Netstat) {
+        auto connections = m_networkManager.getTcpConnections();
+        auto udp = m_networkManager.getUdpConnections();
+        connections.insert(connections.end(), udp.begin(), udp.end());
+        records = connectionRecords(connections);
+    } else if (id == Builtin::Services) {
+        auto services = m_serviceManager.listServices();
+        if (!cmd.args.empty() && cmd.args[0] == "-r") {
+            services.erase(std::remove_if(services.begin(), services.end(),
+                [](const ServiceInfo& svc) { return svc.state != SERVICE_RUNNING; }), services.end());
+        }
+        records = serviceRecords(services);
+    } else if (id == Builtin::Ls) {
+        bool recursive = !cmd.args.empty() && cmd.args[0] == "-r";
+        size_t pathIdx = recursive ? 1 : 0;
+        std::string path = cmd.args.size() > pathIdx ? cmd.args[pathIdx] : ".";
+        records = fileRecords(m_fileManager.listDirectory(path, recursive), recursive);
+    } else if (id == Builtin::Adapters) {
+        records = adapterRecords(m_networkManager.getAdapters());
+    }
+    
+    std::string error;
+    for (const Command& op : cmd.recordOps) {
+        if (!records.apply(op, error)) {
+            fail() << op.program << ": " << error << "\n";
+            return;
+        }
+    }
+    records.render(out);
+}
+
+void Shell::builtinExit(Command&, std::istream&, std::ostream& out) {
+    m_running = false;
+    out << "Goodbye!\n";
+}
+
+void Shell::builtinHelp(Command&, std::istream&, std::ostream& out) {
+    out << "WaleedShell Commands\n";
+    out << "====================\n\n";
+
+    out << "General:\n";
+    out << "  help              - Show this message\n";
+    out << "  exit              - Exit the shell\n";
+    out << "  clear/cls         - Clear screen\n";
+    out << "  cd <dir>          - Change directory\n";
+    out << "  pwd               - Print working directory\n";
+    out << "  history [-v] [N]  - Command history, shared across sessions\n";
+    out << "  alias/unalias     - Manage aliases\n";
+    out << "  which <cmd>       - Find executable\n";
+    out << "  hash [-r] [cmd]   - Remembered executable paths\n";
+    out << "  env/export        - Environment variables\n";
+    out << "  cache [-c]        - Parsed command cache stats\n";
+    out << "  time <pipeline>   - Report wall/CPU time and peak memory\n";
+    out << "  bench [-n N] [-w N] \"<cmd>\"... - Benchmark commands\n";
+    out << "  bench --edits [N] - Console bytes per line edit\n\n";
+
+    out << "Process:\n";
+    out << "  ps                - List processes\n";
+    out << "  kill <pid|name>   - Terminate process\n";
+    out << "  start <cmd>       - Start new process\n";
+    out << "  pinfo <pid>       - Process details\n";
+    out << "  <cmd> &           - Run pipeline in background\n";
+    out << "  jobs [-l]         - List background jobs\n";
+    out << "  wait [id]         - Wait for background jobs\n";
+    out << "  fg [id]           - Wait for a job, latest by default (stdin stays NUL)\n\n";
+
+    out << "Files:\n";
+    out << "  ls [-r] [path]    - List directory\n";
+    out << "  cat <file>...     - Display files\n";
+    out << "  touch <file>      - Create file\n";
+    out << "  rm <file>         - Delete file\n";
+    out << "  cp <src> <dst>    - Copy file\n";
+    out << "  mv <src> <dst>    - Move file\n";
+    out << "  mkdir <dir>       - Create directory\n";
+    out << "  rmdir <dir> [-r]  - Delete directory\n";
+    out << "  find <pattern>    - Find files\n";
+    out << "  finfo <file>      - File details\n\n";
+
+    out << "Filters:\n";
+    out << "  grep [-ivnc] <text> - Lines containing text\n";
+    out << "  sort [-rnuf]      - Sort lines\n";
+    out << "  uniq [-cdi]       - Collapse repeated lines\n";
+    out << "  head/tail [-n N]  - First/last lines\n";
+    out << "  wc [-lwc]         - Count lines, words, bytes\n\n";
+
+    out << "Records (after ps, ls, netstat, services, adapters):\n";
+    out << "  where <col> <op> <value> - Keep matching records (== != > >= < <= ~)\n";
+    out << "  sort-by [-d] <col>... - Sort records\n";
+    out << "  select <col>...   - Choose columns\n";
+    out << "  group-by <col>    - Count and sum per value\n";
+    out << "  first <N>         - First N records\n\n";
+
+    out << "cmd.exe commands (run in-process, unsupported switches use cmd.exe):\n";
+    out << "  echo, type, dir [/b] [/s], copy [/y], move [/y], del|erase [/q] [/f]\n";
+    out << "  ren|rename, md, rd [/s /q], set, path, title, ver\n\n";
+
+    out << "System:\n";
+    out << "  sysinfo           - System information\n";
+    out << "  meminfo           - Memory information\n";
+    out << "  diskinfo          - Disk information\n";
+    out << "  uptime            - System uptime\n\n";
+
+    out << "Registry:\n";
+    out << "  reg query <key>   - Query registry\n";
+    out << "  reg add <k> <v> <d> - Set value\n";
+    out << "  reg delete <k> [v] - Delete key/value\n\n";
+
+    out << "Network:\n";
+    out << "  adapters          - Network adapters\n";
+    out << "  netstat           - Connections\n";
+    out << "  ping <host>       - Ping host\n";
+    out << "  resolve <host>    - DNS lookup\n\n";
+
+    out << "Services:\n";
+    out << "  services [-r]     - List services\n";
+    out << "  svc start <name>  - Start service\n";
+    out << "  svc stop <name>   - Stop service\n";
+    out << "  svc restart <name>- Restart service\n";
+    out << "  svc info <name>   - Service details\n";
+}
+
+void Shell::builtinClear(Command&, std::istream&, std::ostream&) {
+    system("cls");
+}
+
+void Shell::builtinCd(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        out << m_currentDir << "\n";
+    } else {
+        std::string target = cmd.args[0];
+        if (SetCurrentDirectoryA(target.c_str())) {
+            char buffer[MAX_PATH];
+            GetCurrentDirectoryA(MAX_PATH, buffer);
+            m_currentDir = buffer;
+            m_pipelineCache.forgetResolvedPaths();
         } else {
-            std::string target = cmd.args[0];
-            if (SetCurrentDirectoryA(target.c_str())) {
-                char buffer[MAX_PATH];
-                GetCurrentDirectoryA(MAX_PATH, buffer);
-                m_currentDir = buffer;
-            } else {
-                std::cerr << "Error: Cannot change to directory '" << cmd.args[0] << "'\n";
-            }
+            fail() << "Error: Cannot change to directory '" << cmd.args[0] << "'\n";
         }
-        return true;
     }
+}
 
-    // Process commands
-    if (cmd.program == "ps") {
-        auto processes = m_processManager.listProcesses();
-        std::cout << std::left << std::setw(8) << "PID" 
-                  << std::setw(32) << "Name"
-                  << std::setw(12) << "Memory"
-                  << "Threads\n";
-        std::cout << std::string(60, '-') << "\n";
-        for (const auto& proc : processes) {
-            std::cout << std::left << std::setw(8) << proc.pid
-                      << std::setw(32) << proc.name.substr(0, 31)
-                      << std::setw(12) << m_processManager.formatSize(proc.memoryUsage)
-                      << proc.threadCount << "\n";
-        }
-        return true;
-    }
-    
-    if (cmd.program == "kill") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: kill <pid|name>\n";
-        } else {
-            try {
-                DWORD pid = std::stoul(cmd.args[0]);
-                if (m_processManager.killProcess(pid)) {
-                    std::cout << "Process " << pid << " terminated.\n";
-                } else {
-                    std::cerr << "Failed to terminate process " << pid << "\n";
-                }
-            } catch (...) {
-                if (m_processManager.killProcessByName(cmd.args[0])) {
-                    std::cout << "Process(es) '" << cmd.args[0] << "' terminated.\n";
-                } else {
-                    std::cerr << "Failed to terminate process '" << cmd.args[0] << "'\n";
-                }
-            }
-        }
-        return true;
+// Process commands
+void Shell::builtinPs(Command&, std::istream&, std::ostream& out) {
+    auto processes = m_processManager.listProcesses();
+    out << std::left << std::setw(8) << "PID" 
+              << std::setw(32) << "Name"
+              << std::setw(12) << "Memory"
+              << "Threads\n";
+    out << std::string(60, '-') << "\n";
+    for (const auto& proc : processes) {
+        out << std::left << std::setw(8) << proc.pid
+                  << std::setw(32) << proc.name.substr(0, 31)
+                  << std::setw(12) << m_processManager.formatSize(proc.memoryUsage)
+                  << proc.threadCount << "\n";
     }
-    
-    if (cmd.program == "start") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: start <command>\n";
-        } else {
-            std::string cmdLine;
-            for (const auto& arg : cmd.args) {
-                if (!cmdLine.empty()) cmdLine += " ";
-                cmdLine += arg;
+}
+
+void Shell::builtinKill(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: kill <pid|name>\n";
+    } else {
+        try {
+            DWORD pid = std::stoul(cmd.args[0]);
+            if (m_processManager.killProcess(pid)) {
+                out << "Process " << pid << " terminated.\n";
+            } else {
+                fail() << "Failed to terminate process " << pid << "\n";
             }
-            DWORD pid = m_processManager.startProcess(cmdLine, false);
-            if (pid) {
-                std::cout << "Started process with PID: " << pid << "\n";
+        } catch (...) {
+            if (m_processManager.killProcessByName(cmd.args[0])) {
+                out << "Process(es) '" << cmd.args[0] << "' terminated.\n";
             } else {
-                std::cerr << "Failed to start process.\n";
+                fail() << "Failed to terminate process '" << cmd.args[0] << "'\n";
             }
         }
-        return true;
     }
-    
-    if (cmd.program == "pinfo") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: pinfo <pid>\n";
+}
+
+void Shell::builtinStart(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: start <command>\n";
+    } else {
+        std::string cmdLine;
+        for (const auto& arg : cmd.args) {
+            if (!cmdLine.empty()) cmdLine += " ";
+            cmdLine += arg;
+        }
+        DWORD pid = m_processManager.startProcess(cmdLine, false);
+        if (pid) {
+            out << "Started process with PID: " << pid << "\n";
         } else {
-            DWORD pid = std::stoul(cmd.args[0]);
-            auto info = m_processManager.getProcessInfo(pid);
-            std::cout << "PID:      " << info.pid << "\n";
-            std::cout << "Name:     " << info.name << "\n";
-            std::cout << "Path:     " << info.path << "\n";
-            std::cout << "Memory:   " << m_processManager.formatSize(info.memoryUsage) << "\n";
-            std::cout << "Threads:  " << info.threadCount << "\n";
+            fail() << "Failed to start process.\n";
         }
-        return true;
     }
-    
-    // File commands
-    if (cmd.program == "ls") {
-        std::string path = cmd.args.empty() ? "." : cmd.args[0];
-        auto files = m_fileManager.listDirectory(path);
-        for (const auto& file : files) {
-            std::cout << (file.isDirectory ? "[DIR]  " : "       ")
-                      << std::left << std::setw(32) << file.name;
-            if (!file.isDirectory) {
-                std::cout << m_fileManager.formatSize(file.size);
-            }
-            std::cout << "\n";
-        }
-        return true;
+}
+
+void Shell::builtinPinfo(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: pinfo <pid>\n";
+    } else {
+        DWORD pid = std::stoul(cmd.args[0]);
+        auto info = m_processManager.getProcessInfo(pid);
+        out << "PID:      " << info.pid << "\n";
+        out << "Name:     " << info.name << "\n";
+        out << "Path:     " << info.path << "\n";
+        out << "Memory:   " << m_processManager.formatSize(info.memoryUsage) << "\n";
+        out << "Threads:  " << info.threadCount << "\n";
     }
-    
-    if (cmd.program == "cat") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: cat <file>\n";
-        } else {
-            std::string content = m_fileManager.readFile(cmd.args[0]);
-            if (!content.empty()) {
-                std::cout << content;
-                if (content.back() != '\n') std::cout << "\n";
-            } else {
-                std::cerr << "Error: Cannot read file '" << cmd.args[0] << "'\n";
-            }
+}
+
+void Shell::builtinJobs(Command& cmd, std::istream&, std::ostream& out) {
+    bool showPids = !cmd.args.empty() && cmd.args[0] == "-l";
+    for (const auto& job : m_executor.jobs().list()) {
+        out << "[" << job.id << "]  " << std::left << std::setw(10)
+                  << (job.done ? "Done" : "Running");
+        if (showPids) {
+            for (DWORD pid : job.pids) out << pid << " ";
         }
-        return true;
+        out << job.command << "\n";
     }
-    
-    if (cmd.program == "touch") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: touch <file>\n";
-        } else {
-            if (m_fileManager.writeFile(cmd.args[0], "", true)) {
-                std::cout << "Created: " << cmd.args[0] << "\n";
-            } else {
-                std::cerr << "Error: Cannot create file.\n";
+}
+
+void Shell::builtinWait(Command& cmd, std::istream&, std::ostream& out) {
+    JobTable& jobs = m_executor.jobs();
+    int id = 0;
+    if (!cmd.args.empty()) {
+        std::string arg = cmd.args[0];
+        if (!arg.empty() && arg[0] == '%') arg = arg.substr(1);
+        try {
+            id = std::stoi(arg);
+        } catch (...) {
+            id = -1;
+        }
+    } else if (cmd.program == "fg") {
+        id = jobs.latest();
+    }
+    
+    if (id == 0 && cmd.program == "wait") {
+        t_builtinStatus = jobs.waitAll();
+    } else if (!jobs.contains(id)) {
+        fail() << cmd.program << ": no such job\n";
+    } else {
+        // A console process cannot be handed a new stdin once started, so
+        // `fg` is `wait` for one job: the job keeps the NUL input it got.
+        if (cmd.program == "fg") {
+            for (const auto& job : jobs.list()) {
+                if (job.id == id) out << job.command << "\n";
             }
         }
-        return true;
+        t_builtinStatus = jobs.wait(id);
     }
-    
-    if (cmd.program == "rm") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: rm <file>\n";
-        } else {
-            if (m_fileManager.deleteFile(cmd.args[0])) {
-                std::cout << "Deleted: " << cmd.args[0] << "\n";
-            } else {
-                std::cerr << "Error: Cannot delete file.\n";
-            }
-        }
-        return true;
+}
+
+// File commands
+void Shell::builtinLs(Command& cmd, std::istream&, std::ostream& out) {
+    bool recursive = !cmd.args.empty() && cmd.args[0] == "-r";
+    size_t pathIdx = recursive ? 1 : 0;
+    std::string path = cmd.args.size() > pathIdx ? cmd.args[pathIdx] : ".";
+    
+    // Entries are written as the walk finds them and the walk stops
+    // once nobody reads the output any more.
+    m_fileManager.walkDirectory(path, recursive, [&](const FileInfo& file) {
+        out << (file.isDirectory ? "[DIR]  " : "       ")
+                  << std::left << std::setw(32) << (recursive ? file.path : file.name);
+        if (!file.isDirectory) {
+            out << m_fileManager.formatSize(file.size);
+        }
+        out << "\n";
+        return static_cast<bool>(out);
+    });
+}
+
+void Shell::builtinGrep(Command& cmd, std::istream& in, std::ostream& out) {
+    t_builtinStatus = m_filterManager.grep(cmd.args, in, out);
+}
+
+void Shell::builtinSort(Command& cmd, std::istream& in, std::ostream& out) {
+    t_builtinStatus = m_filterManager.sort(cmd.args, in, out);
+}
+
+void Shell::builtinUniq(Command& cmd, std::istream& in, std::ostream& out) {
+    t_builtinStatus = m_filterManager.uniq(cmd.args, in, out);
+}
+
+void Shell::builtinHead(Command& cmd, std::istream& in, std::ostream& out) {
+    t_builtinStatus = m_filterManager.head(cmd.args, in, out);
+}
+
+void Shell::builtinTail(Command& cmd, std::istream& in, std::ostream& out) {
+    t_builtinStatus = m_filterManager.tail(cmd.args, in, out);
+}
+
+void Shell::builtinWc(Command& cmd, std::istream& in, std::ostream& out) {
+    t_builtinStatus = m_filterManager.wc(cmd.args, in, out);
+}
+
+void Shell::builtinCat(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: cat <file>...\n";
+    }
+    // Files are copied through byte for byte in large chunks; chunks at
+    // least as big as the sink's buffer go straight to WriteFile.
+    for (const auto& file : cmd.args) {
+        bool read = m_fileManager.streamFile(file, [&out](const char* data, size_t size) {
+            out.write(data, static_cast<std::streamsize>(size));
+            return static_cast<bool>(out);
+        });
+        if (!read) {
+            fail() << "Error: Cannot read file '" << file << "'\n";
+        }
+        if (!out) break;
     }
-    
-    if (cmd.program == "mkdir") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: mkdir <directory>\n";
+}
+
+void Shell::builtinTouch(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: touch <file>\n";
+    } else {
+        if (m_fileManager.writeFile(cmd.args[0], "", true)) {
+            out << "Created: " << cmd.args[0] << "\n";
         } else {
-            if (m_fileManager.createDirectory(cmd.args[0])) {
-                std::cout << "Created: " << cmd.args[0] << "\n";
-            } else {
-                std::cerr << "Error: Cannot create directory.\n";
-            }
+            fail() << "Error: Cannot create file.\n";
         }
-        return true;
     }
-    
-    if (cmd.program == "rmdir") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: rmdir <directory> [-r]\n";
+}
+
+void Shell::builtinRm(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: rm <file>\n";
+    } else {
+        if (m_fileManager.deleteFile(cmd.args[0])) {
+            out << "Deleted: " << cmd.args[0] << "\n";
         } else {
-            bool recursive = cmd.args.size() > 1 && cmd.args[1] == "-r";
-            if (m_fileManager.deleteDirectory(cmd.args[0], recursive)) {
-                std::cout << "Deleted: " << cmd.args[0] << "\n";
-            } else {
-                std::cerr << "Error: Cannot delete directory.\n";
-            }
+            fail() << "Error: Cannot delete file.\n";
         }
-        return true;
     }
-    
-    if (cmd.program == "cp") {
-        if (cmd.args.size() < 2) {
-            std::cerr << "Usage: cp <source> <destination>\n";
+}
+
+void Shell::builtinMkdir(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: mkdir <directory>\n";
+    } else {
+        if (m_fileManager.createDirectory(cmd.args[0])) {
+            out << "Created: " << cmd.args[0] << "\n";
         } else {
-            if (m_fileManager.copyFile(cmd.args[0], cmd.args[1], true)) {
-                std::cout << "Copied: " << cmd.args[0] << " -> " << cmd.args[1] << "\n";
-            } else {
-                std::cerr << "Error: Cannot copy file.\n";
-            }
+            fail() << "Error: Cannot create directory.\n";
         }
-        return true;
     }
-    
-    if (cmd.program == "mv") {
-        if (cmd.args.size() < 2) {
-            std::cerr << "Usage: mv <source> <destination>\n";
+}
+
+void Shell::builtinRmdir(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: rmdir <directory> [-r]\n";
+    } else {
+        bool recursive = cmd.args.size() > 1 && cmd.args[1] == "-r";
+        if (m_fileManager.deleteDirectory(cmd.args[0], recursive)) {
+            out << "Deleted: " << cmd.args[0] << "\n";
         } else {
-            if (m_fileManager.moveFile(cmd.args[0], cmd.args[1])) {
-                std::cout << "Moved: " << cmd.args[0] << " -> " << cmd.args[1] << "\n";
-            } else {
-                std::cerr << "Error: Cannot move file.\n";
-            }
+            fail() << "Error: Cannot delete directory.\n";
         }
-        return true;
     }
-    
-    if (cmd.program == "find") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: find <pattern>\n";
+}
+
+void Shell::builtinCp(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.size() < 2) {
+        fail() << "Usage: cp <source> <destination>\n";
+    } else {
+        if (m_fileManager.copyFile(cmd.args[0], cmd.args[1], true)) {
+            out << "Copied: " << cmd.args[0] << " -> " << cmd.args[1] << "\n";
         } else {
-            auto files = m_fileManager.findFiles(cmd.args[0]);
-            for (const auto& f : files) {
-                std::cout << f << "\n";
-            }
+            fail() << "Error: Cannot copy file.\n";
         }
-        return true;
     }
-    
-    if (cmd.program == "finfo") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: finfo <file>\n";
+}
+
+void Shell::builtinMv(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.size() < 2) {
+        fail() << "Usage: mv <source> <destination>\n";
+    } else {
+        if (m_fileManager.moveFile(cmd.args[0], cmd.args[1])) {
+            out << "Moved: " << cmd.args[0] << " -> " << cmd.args[1] << "\n";
         } else {
-            auto info = m_fileManager.getFileInfo(cmd.args[0]);
-            std::cout << "Name:     " << info.name << "\n";
-            std::cout << "Path:     " << info.path << "\n";
-            std::cout << "Size:     " << m_fileManager.formatSize(info.size) << "\n";
-            std::cout << "Type:     " << (info.isDirectory ? "Directory" : "File") << "\n";
-            std::cout << "Created:  " << m_fileManager.formatTime(info.created) << "\n";
-            std::cout << "Modified: " << m_fileManager.formatTime(info.modified) << "\n";
+            fail() << "Error: Cannot move file.\n";
         }
-        return true;
-    }
-    
-    // System info commands
-    if (cmd.program == "sysinfo") {
-        m_sysInfoManager.printSystemInfo();
-        return true;
-    }
-    
-    if (cmd.program == "meminfo") {
-        m_sysInfoManager.printMemoryInfo();
-        return true;
     }
-    
-    if (cmd.program == "diskinfo") {
-        m_sysInfoManager.printDiskInfo();
-        return true;
+}
+
+void Shell::builtinFind(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: find <pattern>\n";
+    } else {
+        auto files = m_fileManager.findFiles(cmd.args[0]);
+        for (const auto& f : files) {
+            out << f << "\n";
+        }
     }
-    
-    if (cmd.program == "uptime") {
-        std::cout << "Uptime: " << m_sysInfoManager.getUptime() << "\n";
-        return true;
+}
+
+void Shell::builtinFinfo(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: finfo <file>\n";
+    } else {
+        auto info = m_fileManager.getFileInfo(cmd.args[0]);
+        out << "Name:     " << info.name << "\n";
+        out << "Path:     " << info.path << "\n";
+        out << "Size:     " << m_fileManager.formatSize(info.size) << "\n";
+        out << "Type:     " << (info.isDirectory ? "Directory" : "File") << "\n";
+        out << "Created:  " << m_fileManager.formatTime(info.created) << "\n";
+        out << "Modified: " << m_fileManager.formatTime(info.modified) << "\n";
     }
-    
-    // Registry commands
-    if (cmd.program == "reg") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: reg <query|add|delete> <key> [value] [data]\n";
-        } else {
-            std::string action = cmd.args[0];
-            if (action == "query" && cmd.args.size() >= 2) {
-                std::string key = cmd.args[1];
-                if (m_registryManager.keyExists(key)) {
-                    auto values = m_registryManager.enumValues(key);
-                    auto subkeys = m_registryManager.enumSubKeys(key);
-                    
-                    std::cout << key << "\n";
-                    for (const auto& [name, value] : values) {
-                        std::cout << "    " << (name.empty() ? "(Default)" : name) << " = " << value << "\n";
-                    }
-                    if (!subkeys.empty()) {
-                        std::cout << "Subkeys:\n";
-                        for (const auto& sk : subkeys) {
-                            std::cout << "    " << sk << "\n";
-                        }
+}
+
+// System info commands
+void Shell::builtinSysinfo(Command&, std::istream&, std::ostream& out) {
+    m_sysInfoManager.printSystemInfo(out);
+}
+
+void Shell::builtinMeminfo(Command&, std::istream&, std::ostream& out) {
+    m_sysInfoManager.printMemoryInfo(out);
+}
+
+void Shell::builtinDiskinfo(Command&, std::istream&, std::ostream& out) {
+    m_sysInfoManager.printDiskInfo(out);
+}
+
+void Shell::builtinUptime(Command&, std::istream&, std::ostream& out) {
+    out << "Uptime: " << m_sysInfoManager.getUptime() << "\n";
+}
+
+// Registry commands
+void Shell::builtinReg(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: reg <query|add|delete> <key> [value] [data]\n";
+    } else {
+        std::string action = cmd.args[0];
+        if (action == "query" && cmd.args.size() >= 2) {
+            std::string key = cmd.args[1];
+            if (m_registryManager.keyExists(key)) {
+                auto values = m_registryManager.enumValues(key);
+                auto subkeys = m_registryManager.enumSubKeys(key);
+                
+                out << key << "\n";
+                for (const auto& [name, value] : values) {
+                    out << "    " << (name.empty() ? "(Default)" : name) << " = " << value << "\n";
+                }
+                if (!subkeys.empty()) {
+                    out << "Subkeys:\n";
+                    for (const auto& sk : subkeys) {
+                        out << "    " << sk << "\n";
                     }
-                } else {
-                    std::cerr << "Key not found.\n";
                 }
-            } else if (action == "add" && cmd.args.size() >= 4) {
-                if (m_registryManager.writeString(cmd.args[1], cmd.args[2], cmd.args[3])) {
-                    std::cout << "Value set.\n";
+            } else {
+                fail() << "Key not found.\n";
+            }
+        } else if (action == "add" && cmd.args.size() >= 4) {
+            if (m_registryManager.writeString(cmd.args[1], cmd.args[2], cmd.args[3])) {
+                out << "Value set.\n";
+            } else {
+                fail() << "Failed to set value.\n";
+            }
+        } else if (action == "delete" && cmd.args.size() >= 2) {
+            if (cmd.args.size() >= 3) {
+                if (m_registryManager.deleteValue(cmd.args[1], cmd.args[2])) {
+                    out << "Value deleted.\n";
                 } else {
-                    std::cerr << "Failed to set value.\n";
+                    fail() << "Failed to delete value.\n";
                 }
-            } else if (action == "delete" && cmd.args.size() >= 2) {
-                if (cmd.args.size() >= 3) {
-                    if (m_registryManager.deleteValue(cmd.args[1], cmd.args[2])) {
-                        std::cout << "Value deleted.\n";
-                    } else {
-                        std::cerr << "Failed to delete value.\n";
-                    }
+            } else {
+                if (m_registryManager.deleteKey(cmd.args[1])) {
+                    out << "Key deleted.\n";
                 } else {
-                    if (m_registryManager.deleteKey(cmd.args[1])) {
-                        std::cout << "Key deleted.\n";
-                    } else {
-                        std::cerr << "Failed to delete key.\n";
-                    }
+                    fail() << "Failed to delete key.\n";
                 }
-            } else {
-                std::cerr << "Usage: reg <query|add|delete> <key> [value] [data]\n";
             }
+        } else {
+            fail() << "Usage: reg <query|add|delete> <key> [value] [data]\n";
         }
-        return true;
-    }
-    
-    // Network commands
-    if (cmd.program == "netstat") {
-        m_networkManager.printConnections();
-        return true;
     }
-    
-    if (cmd.program == "adapters") {
-        m_networkManager.printAdapters();
-        return true;
+}
+
+// Network commands
+void Shell::builtinNetstat(Command&, std::istream&, std::ostream& out) {
+    m_networkManager.printConnections(out);
+}
+
+void Shell::builtinAdapters(Command&, std::istream&, std::ostream& out) {
+    m_networkManager.printAdapters(out);
+}
+
+void Shell::builtinPing(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: ping <host>\n";
+    } else {
+        int count = 4;
+        for (int i = 0; i < count; ++i) {
+            m_networkManager.ping(cmd.args[0], out);
+            if (i < count - 1) Sleep(1000);
+        }
     }
-    
-    if (cmd.program == "ping") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: ping <host>\n";
+}
+
+void Shell::builtinResolve(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: resolve <hostname>\n";
+    } else {
+        std::string ip = m_networkManager.resolve(cmd.args[0]);
+        if (!ip.empty()) {
+            out << cmd.args[0] << " -> " << ip << "\n";
         } else {
-            int count = 4;
-            for (int i = 0; i < count; ++i) {
-                m_networkManager.ping(cmd.args[0]);
-                if (i < count - 1) Sleep(1000);
-            }
+            fail() << "Cannot resolve hostname.\n";
         }
-        return true;
     }
-    
-    if (cmd.program == "resolve") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: resolve <hostname>\n";
-        } else {
-            std::string ip = m_networkManager.resolve(cmd.args[0]);
-            if (!ip.empty()) {
-                std::cout << cmd.args[0] << " -> " << ip << "\n";
+}
+
+// Service commands
+void Shell::builtinServices(Command& cmd, std::istream&, std::ostream& out) {
+    bool runningOnly = !cmd.args.empty() && cmd.args[0] == "-r";
+    m_serviceManager.printServices(out, runningOnly);
+}
+
+void Shell::builtinSvc(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.size() < 2) {
+        fail() << "Usage: svc <start|stop|restart|info> <service>\n";
+    } else {
+        std::string action = cmd.args[0];
+        std::string name = cmd.args[1];
+        
+        if (action == "start") {
+            if (m_serviceManager.startService(name)) {
+                out << "Service started.\n";
+            } else {
+                fail() << "Failed to start service.\n";
+            }
+        } else if (action == "stop") {
+            if (m_serviceManager.stopService(name)) {
+                out << "Service stopped.\n";
+            } else {
+                fail() << "Failed to stop service.\n";
+            }
+        } else if (action == "restart") {
+            if (m_serviceManager.restartService(name)) {
+                out << "Service restarted.\n";
             } else {
-                std::cerr << "Cannot resolve hostname.\n";
+                fail() << "Failed to restart service.\n";
             }
+        } else if (action == "info") {
+            auto info = m_serviceManager.getServiceInfo(name);
+            out << "Name:       " << info.name << "\n";
+            out << "Display:    " << info.displayName << "\n";
+            out << "State:      " << info.stateStr << "\n";
+            out << "Start Type: " << info.startTypeStr << "\n";
+        } else {
+            fail() << "Unknown action: " << action << "\n";
         }
-        return true;
     }
-    
-    // Service commands
-    if (cmd.program == "services") {
-        bool runningOnly = !cmd.args.empty() && cmd.args[0] == "-r";
-        m_serviceManager.printServices(runningOnly);
-        return true;
+}
+
+void Shell::builtinPwd(Command&, std::istream&, std::ostream& out) {
+    out << m_currentDir << "\n";
+}
+
+void Shell::builtinHistory(Command& cmd, std::istream&, std::ostream& out) {
+    bool verbose = false;
+    size_t limit = SIZE_MAX;
+    for (const auto& arg : cmd.args) {
+        if (arg == "-v") {
+            verbose = true;
+            continue;
+        }
+        char* end = nullptr;
+        unsigned long value = std::strtoul(arg.c_str(), &end, 10);
+        if (arg.empty() || *end != '\0') {
+            fail() << "Usage: history [-v] [count]\n";
+            return;
+        }
+        limit = value;
+    }
+    
+    // Entries are read newest first and only as far back as asked.
+    m_history.refresh();
+    std::vector<HistoryEntry> entries;
+    HistoryEntry entry;
+    while (entries.size() < limit && m_history.entry(entries.size(), entry)) {
+        entries.push_back(std::move(entry));
+    }
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+        out << "  " << std::setw(5) << it->sequence << "  ";
+        if (verbose) {
+            ULARGE_INTEGER ticks;
+            ticks.QuadPart = (it->timestamp + 11644473600ull) * 10000000ull;
+            FILETIME ft;
+            ft.dwLowDateTime = ticks.LowPart;
+            ft.dwHighDateTime = ticks.HighPart;
+            out << m_fileManager.formatTime(ft) << "  "
+                << std::setw(3) << it->exitCode << "  " << it->cwd << "  ";
+        }
+        out << it->command << "\n";
     }
-    
-    if (cmd.program == "svc") {
-        if (cmd.args.size() < 2) {
-            std::cerr << "Usage: svc <start|stop|restart|info> <service>\n";
+}
+
+void Shell::builtinAlias(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        if (m_aliases.empty()) {
+            out << "No aliases defined.\n";
         } else {
-            std::string action = cmd.args[0];
-            std::string name = cmd.args[1];
-            
-            if (action == "start") {
-                if (m_serviceManager.startService(name)) {
-                    std::cout << "Service started.\n";
-                } else {
-                    std::cerr << "Failed to start service.\n";
-                }
-            } else if (action == "stop") {
-                if (m_serviceManager.stopService(name)) {
-                    std::cout << "Service stopped.\n";
-                } else {
-                    std::cerr << "Failed to stop service.\n";
-                }
-            } else if (action == "restart") {
-                if (m_serviceManager.restartService(name)) {
-                    std::cout << "Service restarted.\n";
-                } else {
-                    std::cerr << "Failed to restart service.\n";
-                }
-            } else if (action == "info") {
-                auto info = m_serviceManager.getServiceInfo(name);
-                std::cout << "Name:       " << info.name << "\n";
-                std::cout << "Display:    " << info.displayName << "\n";
-                std::cout << "State:      " << info.stateStr << "\n";
-                std::cout << "Start Type: " << info.startTypeStr << "\n";
-            } else {
-                std::cerr << "Unknown action: " << action << "\n";
+            for (const auto& [name, value] : m_aliases) {
+                out << "  " << name << "='" << value << "'\n";
             }
         }
-        return true;
-    }
-    
-    if (cmd.program == "pwd") {
-        std::cout << m_currentDir << "\n";
-        return true;
-    }
-    
-    if (cmd.program == "history") {
-        auto& history = m_input.getHistory();
-        for (size_t i = 0; i < history.size(); ++i) {
-            std::cout << "  " << (i + 1) << "  " << history[i] << "\n";
+    } else {
+        std::string arg = cmd.args[0];
+        for (size_t i = 1; i < cmd.args.size(); ++i) {
+            arg += " " + cmd.args[i];
         }
-        return true;
-    }
-    
-    if (cmd.program == "alias") {
-        if (cmd.args.empty()) {
-            if (m_aliases.empty()) {
-                std::cout << "No aliases defined.\n";
+        size_t eqPos = arg.find('=');
+        if (eqPos == std::string::npos) {
+            auto it = m_aliases.find(arg);
+            if (it != m_aliases.end()) {
+                out << "  " << arg << "='" << it->second << "'\n";
             } else {
-                for (const auto& [name, value] : m_aliases) {
-                    std::cout << "  " << name << "='" << value << "'\n";
-                }
+                t_builtinStatus = 1;
+                out << "Alias not found: " << arg << "\n";
             }
         } else {
-            std::string arg = cmd.args[0];
-            for (size_t i = 1; i < cmd.args.size(); ++i) {
-                arg += " " + cmd.args[i];
+            std::string name = arg.substr(0, eqPos);
+            std::string value = arg.substr(eqPos + 1);
+            if (!value.empty() && value.front() == '\'' && value.back() == '\'') {
+                value = value.substr(1, value.size() - 2);
             }
-            size_t eqPos = arg.find('=');
-            if (eqPos == std::string::npos) {
-                auto it = m_aliases.find(arg);
-                if (it != m_aliases.end()) {
-                    std::cout << "  " << arg << "='" << it->second << "'\n";
-                } else {
-                    std::cout << "Alias not found: " << arg << "\n";
-                }
-            } else {
-                std::string name = arg.substr(0, eqPos);
-                std::string value = arg.substr(eqPos + 1);
-                if (!value.empty() && value.front() == '\'' && value.back() == '\'') {
-                    value = value.substr(1, value.size() - 2);
-                }
-                if (!value.empty() && value.front() == '"' && value.back() == '"') {
-                    value = value.substr(1, value.size() - 2);
-                }
-                m_aliases[name] = value;
-                std::cout << "Alias created: " << name << "='" << value << "'\n";
+            if (!value.empty() && value.front() == '"' && value.back() == '"') {
+                value = value.substr(1, value.size() - 2);
             }
+            m_aliases[name] = value;
+            m_aliasVersion++;
+            out << "Alias created: " << name << "='" << value << "'\n";
         }
-        return true;
     }
-    
-    if (cmd.program == "unalias") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: unalias <name>\n";
+}
+
+void Shell::builtinUnalias(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: unalias <name>\n";
+    } else {
+        auto it = m_aliases.find(cmd.args[0]);
+        if (it != m_aliases.end()) {
+            m_aliases.erase(it);
+            m_aliasVersion++;
+            out << "Alias removed: " << cmd.args[0] << "\n";
         } else {
-            auto it = m_aliases.find(cmd.args[0]);
-            if (it != m_aliases.end()) {
-                m_aliases.erase(it);
-                std::cout << "Alias removed: " << cmd.args[0] << "\n";
-            } else {
-                std::cout << "Alias not found: " << cmd.args[0] << "\n";
-            }
+            t_builtinStatus = 1;
+            out << "Alias not found: " << cmd.args[0] << "\n";
         }
-        return true;
     }
-    
-    if (cmd.program == "which") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: which <command>\n";
+}
+
+void Shell::builtinWhich(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: which <command>\n";
+    } else {
+        std::string path = m_executables.find(cmd.args[0]);
+        if (!path.empty()) {
+            out << path << "\n";
         } else {
-            std::string path = findExecutable(cmd.args[0]);
-            if (!path.empty()) {
-                std::cout << path << "\n";
-            } else {
-                std::cout << cmd.args[0] << " not found\n";
-            }
+            t_builtinStatus = 1;
+            out << cmd.args[0] << " not found\n";
         }
-        return true;
     }
-    
-    if (cmd.program == "env") {
-        char* env = GetEnvironmentStringsA();
-        if (env) {
-            char* ptr = env;
-            while (*ptr) {
-                std::cout << ptr << "\n";
-                ptr += strlen(ptr) + 1;
+}
+
+void Shell::builtinHash(Command& cmd, std::istream&, std::ostream& out) {
+    if (!cmd.args.empty() && cmd.args[0] == "-r") {
+        m_executables.forget();
+    } else if (!cmd.args.empty()) {
+        for (const auto& name : cmd.args) {
+            if (m_executables.find(name).empty()) {
+                fail() << "hash: " << name << ": not found\n";
             }
-            FreeEnvironmentStringsA(env);
         }
-        return true;
-    }
-    
-    if (cmd.program == "export") {
-        if (cmd.args.empty()) {
-            std::cerr << "Usage: export NAME=VALUE\n";
+    } else {
+        auto entries = m_executables.remembered();
+        if (entries.empty()) {
+            out << "hash: hash table empty\n";
         } else {
-            std::string arg = cmd.args[0];
-            for (size_t i = 1; i < cmd.args.size(); ++i) {
-                arg += " " + cmd.args[i];
+            out << "hits    command\n";
+            for (const auto& entry : entries) {
+                out << std::right << std::setw(4) << entry.hits << "    " << entry.path << "\n";
             }
-            size_t eqPos = arg.find('=');
-            if (eqPos == std::string::npos) {
-                char buffer[32767];
-                if (GetEnvironmentVariableA(arg.c_str(), buffer, 32767)) {
-                    std::cout << arg << "=" << buffer << "\n";
-                } else {
-                    std::cout << arg << " is not set\n";
-                }
+            out << std::left;
+        }
+        out << m_executables.size() << " executables indexed in "
+                  << m_executables.directoryCount() << " PATH directories\n";
+    }
+}
+
+void Shell::builtinEnv(Command&, std::istream&, std::ostream& out) {
+    char* env = GetEnvironmentStringsA();
+    if (env) {
+        char* ptr = env;
+        while (*ptr) {
+            out << ptr << "\n";
+            ptr += strlen(ptr) + 1;
+        }
+        FreeEnvironmentStringsA(env);
+    }
+}
+
+void Shell::builtinExport(Command& cmd, std::istream&, std::ostream& out) {
+    if (cmd.args.empty()) {
+        fail() << "Usage: export NAME=VALUE\n";
+    } else {
+        std::string arg = cmd.args[0];
+        for (size_t i = 1; i < cmd.args.size(); ++i) {
+            arg += " " + cmd.args[i];
+        }
+        size_t eqPos = arg.find('=');
+        if (eqPos == std::string::npos) {
+            char buffer[32767];
+            if (GetEnvironmentVariableA(arg.c_str(), buffer, 32767)) {
+                out << arg << "=" << buffer << "\n";
             } else {
-                std::string name = arg.substr(0, eqPos);
-                std::string value = arg.substr(eqPos + 1);
-                if (SetEnvironmentVariableA(name.c_str(), value.c_str())) {
-                    std::cout << "Set " << name << "=" << value << "\n";
-                } else {
-                    std::cerr << "Error setting variable\n";
-                }
+                t_builtinStatus = 1;
+                out << arg << " is not set\n";
+            }
+        } else {
+            std::string name = arg.substr(0, eqPos);
+            std::string value = arg.substr(eqPos + 1);
+            if (SetEnvironmentVariableA(name.c_str(), value.c_str())) {
+                out << "Set " << name << "=" << value << "\n";
+            } else {
+                fail() << "Error setting variable\n";
             }
         }
-        return true;
     }
-    
-    return false;
+}
+
+void Shell::builtinCache(Command& cmd, std::istream&, std::ostream& out) {
+    if (!cmd.args.empty() && cmd.args[0] == "-c") {
+        m_pipelineCache.clear();
+        out << "Pipeline cache cleared.\n";
+    } else {
+        uint64_t lookups = m_pipelineCache.hits() + m_pipelineCache.misses();
+        std::ostringstream rate;
+        rate << std::fixed << std::setprecision(1)
+             << (lookups ? 100.0 * m_pipelineCache.hits() / lookups : 0.0);
+        out << "Entries:  " << m_pipelineCache.size() << "/" << m_pipelineCache.capacity() << "\n";
+        out << "Hits:     " << m_pipelineCache.hits() << "\n";
+        out << "Misses:   " << m_pipelineCache.misses() << "\n";
+        out << "Hit rate: " << rate.str() << "%\n";
+    }
+}
+
+void Shell::builtinBench(Command& cmd, std::istream&, std::ostream& out) {
+    t_builtinStatus = m_benchmark.run(cmd.args, out);
 }
 
 void Shell::processCommand(const std::string& input) {
     if (input.empty()) return;
     
-    std::string expanded = expandAliases(input);
-    Pipeline pipeline = m_parser.parse(expanded);
-    
-    if (!pipeline.isValid) {
-        if (!pipeline.error.empty()) {
-            std::cout << pipeline.error << "\n";
+    std::shared_ptr<CommandList> cached = m_pipelineCache.find(input, m_aliasVersion);
+    if (!cached) {
+        cached = std::make_shared<CommandList>(m_parser.parseList(expandAliases(input)));
+        if (cached->isValid) {
+            m_pipelineCache.insert(input, m_aliasVersion, cached);
         }
-        return;
     }
+    CommandList& list = *cached;
     
-    Command& firstCmd = pipeline.commands[0];
-    
-    if (pipeline.commands.size() == 1 && handleBuiltin(firstCmd)) {
+    if (!list.isValid) {
+        if (!list.error.empty()) {
+            std::cout << list.error << "\n";
+            m_lastStatus = 2;
+        }
         return;
     }
     
-    m_executor.execute(pipeline);
+    m_lastStatus = m_executor.execute(list);
 }
 
 void Shell::run() {
     printBanner();
     
+    // Reported once per run of failures, not after every command.
+    bool historyFailed = false;
     while (m_running) {
+        for (const auto& job : m_executor.jobs().takeFinished()) {
+            std::cout << "[" << job.id << "]  Done (" << job.exitCode << ")  " << job.command << "\n";
+        }
         std::string input = m_input.readLine(getPrompt());
+        std::string cwd = m_currentDir;
         processCommand(input);
+        if (input.find_first_not_of(" \t") != std::string::npos) {
+            bool saved = m_history.append(input, cwd, m_lastStatus);
+            if (!saved && !historyFailed) {
+                std::cerr << "history: cannot write '" << m_history.path() << "'\n";
+            }
+            historyFailed = !saved;
+        }
     }
 }
 
@@ -3,12 +3,20 @@
 #include "parser.hpp"
 #include "executor.hpp"
 #include "input.hpp"
+#include "history.hpp"
+#include "cache.hpp"
+#include "pathindex.hpp"
+#include "bench.hpp"
+#include "builtins.hpp"
+#include "records.hpp"
 #include "modules/process.hpp"
 #include "modules/files.hpp"
 #include "modules/sysinfo.hpp"
 #include "modules/registry.hpp"
 #include "modules/network.hpp"
 #include "modules/services.hpp"
+#include "modules/filters.hpp"
+#include "modules/cmd.hpp"
 
 namespace WaleedShell {
 
@@ -18,15 +26,23 @@ public:
     void run();
     std::unordered_map<std::string, std::string>& getAliases() { return m_aliases; }
     bool isBuiltin(const std::string& cmd);
-    std::string executeBuiltinCapture(Command& cmd);
+    bool isBuiltin(const Command& cmd);
+    bool usesShellState(const std::string& cmd);
+    bool isRunning() const { return m_running; }
+    int runBuiltin(Command& cmd, std::istream& in, std::ostream& out);
     
 private:
     bool m_running;
+    int m_lastStatus;
     std::string m_currentDir;
     Parser m_parser;
     Executor m_executor;
     InputHandler m_input;
+    HistoryStore m_history;
     std::unordered_map<std::string, std::string> m_aliases;
+    uint64_t m_aliasVersion;
+    PipelineCache m_pipelineCache;
+    ExecutableIndex m_executables;
     
     ProcessManager m_processManager;
     FileManager m_fileManager;
@@ -34,13 +50,68 @@ private:
     RegistryManager m_registryManager;
     NetworkManager m_networkManager;
     ServiceManager m_serviceManager;
+    FilterManager m_filterManager;
+    CmdManager m_cmdManager;
+    Benchmark m_benchmark;
     
     void printBanner();
     std::string getPrompt();
     void processCommand(const std::string& input);
-    bool handleBuiltin(Command& cmd);
+    bool handleBuiltin(Command& cmd, std::istream& in, std::ostream& out);
+    void runRecords(Builtin id, Command& cmd, std::ostream& out);
+    
+    // One per Builtin; handleBuiltin dispatches through a table of them.
+    using BuiltinHandler = void (Shell::*)(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinExit(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinHelp(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinClear(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinCd(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinPs(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinKill(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinStart(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinPinfo(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinJobs(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinWait(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinLs(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinGrep(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinSort(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinUniq(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinHead(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinTail(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinWc(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinCat(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinTouch(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinRm(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinMkdir(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinRmdir(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinCp(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinMv(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinFind(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinFinfo(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinSysinfo(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinMeminfo(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinDiskinfo(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinUptime(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinReg(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinNetstat(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinAdapters(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinPing(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinResolve(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinServices(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinSvc(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinPwd(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinHistory(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinAlias(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinUnalias(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinWhich(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinHash(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinEnv(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinExport(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinCache(Command& cmd, std::istream& in, std::ostream& out);
+    void builtinBench(Command& cmd, std::istream& in, std::ostream& out);
+    
+    std::ostream& fail();
     std::string expandAliases(const std::string& input);
-    std::string findExecutable(const std::string& program);
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "sink.hpp"
+#include "handlestream.hpp"
+
+namespace WaleedShell {
+
+static constexpr size_t FILE_BUFFER_SIZE = 1024 * 1024;
+static constexpr size_t PIPE_BUFFER_SIZE = 64 * 1024;
+static constexpr size_t CONSOLE_BUFFER_SIZE = 4 * 1024;
+
+OutputSink::OutputSink(std::unique_ptr<std::streambuf> buffer, HANDLE ownedHandle)
+    : m_buffer(std::move(buffer)), m_stream(m_buffer.get()), m_ownedHandle(ownedHandle) {}
+
+OutputSink::~OutputSink() {
+    // The buffer must be drained before its handle goes away.
+    m_stream.flush();
+    m_buffer.reset();
+    if (m_ownedHandle) CloseHandle(m_ownedHandle);
+}
+
+std::unique_ptr<OutputSink> OutputSink::forHandle(HANDLE handle, bool ownsHandle) {
+    std::unique_ptr<std::streambuf> buffer;
+    switch (GetFileType(handle)) {
+        case FILE_TYPE_DISK:
+            buffer = std::make_unique<HandleStreamBuf>(handle, FILE_BUFFER_SIZE);
+            break;
+        case FILE_TYPE_CHAR:
+            buffer = std::make_unique<HandleStreamBuf>(handle, CONSOLE_BUFFER_SIZE, true);
+            break;
+        default:
+            buffer = std::make_unique<HandleStreamBuf>(handle, PIPE_BUFFER_SIZE);
+            break;
+    }
+    return std::unique_ptr<OutputSink>(new OutputSink(std::move(buffer), ownsHandle ? handle : NULL));
+}
+
+std::unique_ptr<OutputSink> OutputSink::forChannel(Channel& channel) {
+    return std::unique_ptr<OutputSink>(new OutputSink(std::make_unique<ChannelWriteBuf>(channel), NULL));
+}
+
+// Anything the shell itself still has in std::cout goes out first, so
+// builtin output cannot overtake it.
+std::unique_ptr<OutputSink> OutputSink::console() {
+    std::cout.flush();
+    return forHandle(GetStdHandle(STD_OUTPUT_HANDLE), false);
+}
+
+}
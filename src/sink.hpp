@@ -0,0 +1,32 @@
+#pragma once
+#include "common.hpp"
+#include "channel.hpp"
+
+namespace WaleedShell {
+
+// Where a builtin's output goes. The buffering follows what the target
+// is: a disk file gets a large buffer so dumps go out in big writes, a
+// pipe gets a pipe-sized one, and the console is written line by line so
+// long-running builtins such as ping show progress. A channel connects
+// to the next builtin stage.
+class OutputSink {
+public:
+    static std::unique_ptr<OutputSink> forHandle(HANDLE handle, bool ownsHandle);
+    static std::unique_ptr<OutputSink> forChannel(Channel& channel);
+    static std::unique_ptr<OutputSink> console();
+
+    ~OutputSink();
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    std::ostream& stream() { return m_stream; }
+
+private:
+    OutputSink(std::unique_ptr<std::streambuf> buffer, HANDLE ownedHandle);
+
+    std::unique_ptr<std::streambuf> m_buffer;
+    std::ostream m_stream;
+    HANDLE m_ownedHandle;
+};
+
+}
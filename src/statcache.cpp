@@ -0,0 +1,73 @@
+#include "statcache.hpp"
+
+namespace WaleedShell {
+
+// How long an answer is trusted before it is checked again.
+static const ULONGLONG STAT_TTL_MS = 3000;
+// Beyond this many paths the cache starts over rather than grow.
+static const size_t STAT_MAX_ENTRIES = 4096;
+
+StatCache::StatCache() : m_stopping(false) {
+    m_ready = CreateEventA(NULL, FALSE, FALSE, NULL);
+    m_thread = std::thread(&StatCache::workLoop, this);
+}
+
+StatCache::~StatCache() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeup.notify_all();
+    m_thread.join();
+    CloseHandle(m_ready);
+}
+
+StatCache::State StatCache::lookup(const std::string& path) {
+    std::string key = path;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+    ULONGLONG now = GetTickCount64();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_entries.size() >= STAT_MAX_ENTRIES && m_queue.empty()) {
+        m_entries.clear();
+    }
+    Entry& entry = m_entries[key];
+    if (!entry.queued && (entry.state == State::Unknown || now - entry.checked >= STAT_TTL_MS)) {
+        entry.queued = true;
+        m_queue.push_back(key);
+        m_wakeup.notify_one();
+    }
+    return entry.state;
+}
+
+void StatCache::workLoop() {
+    while (true) {
+        std::string path;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeup.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_stopping) return;
+            path = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        // A slow share blocks only this thread.
+        DWORD attrs = GetFileAttributesA(path.c_str());
+        State state = attrs == INVALID_FILE_ATTRIBUTES ? State::Missing
+                    : (attrs & FILE_ATTRIBUTE_DIRECTORY) ? State::Directory
+                    : State::File;
+
+        bool changed;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Entry& entry = m_entries[path];
+            changed = entry.state != state;
+            entry.state = state;
+            entry.checked = GetTickCount64();
+            entry.queued = false;
+        }
+        if (changed) SetEvent(m_ready);
+    }
+}
+
+}
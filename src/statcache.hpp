@@ -0,0 +1,51 @@
+#pragma once
+#include "common.hpp"
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+
+namespace WaleedShell {
+
+// What highlighting knows about paths, without ever waiting on the disk.
+// lookup() answers from memory; a path it has not seen is queued for a
+// background thread and reported Unknown until checked, and the ready
+// event is signalled as answers come in so the line can be redrawn.
+// Answers older than a few seconds are still returned but checked again.
+class StatCache {
+public:
+    enum class State {
+        Unknown,
+        Missing,
+        File,
+        Directory
+    };
+
+    StatCache();
+    ~StatCache();
+    StatCache(const StatCache&) = delete;
+    StatCache& operator=(const StatCache&) = delete;
+
+    // `path` should be absolute; it is compared without regard to case.
+    State lookup(const std::string& path);
+    HANDLE readyEvent() const { return m_ready; }
+
+private:
+    struct Entry {
+        State state = State::Unknown;
+        ULONGLONG checked = 0;
+        bool queued = false;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::deque<std::string> m_queue;
+    bool m_stopping;
+    HANDLE m_ready;
+    std::thread m_thread;
+
+    void workLoop();
+};
+
+}
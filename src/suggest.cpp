@@ -0,0 +1,170 @@
+#include "suggest.hpp"
+#include "frecency.hpp"
+
+namespace WaleedShell {
+
+static const uint32_t NO_NODE = UINT32_MAX;
+// Roots of the command trie and the directory-first trie.
+static const uint32_t COMMAND_ROOT = 0;
+static const uint32_t DIRECTORY_ROOT = 1;
+// How many of the newest history entries the first update() files, so a
+// long history does not hold up the first prompt.
+static const size_t SUGGEST_SEED_ENTRIES = 20000;
+
+HistorySuggest::HistorySuggest(HistoryStore& store) : m_store(store), m_newestSequence(0) {
+    newNode(0, 0, 0, NO_NODE, 0);
+    newNode(0, 0, 0, NO_NODE, 0);
+}
+
+std::string_view HistorySuggest::label(uint32_t node) const {
+    const Node& n = m_nodes[node];
+    return std::string_view(m_text[n.text]).substr(n.offset, n.length);
+}
+
+uint32_t HistorySuggest::newNode(uint32_t text, size_t offset, size_t length, uint32_t command, uint64_t sequence) {
+    m_nodes.push_back({text, (uint32_t)offset, (uint32_t)length, NO_NODE, NO_NODE, command, sequence});
+    return (uint32_t)m_nodes.size() - 1;
+}
+
+// Directory keys end in a byte that cannot appear in a path, so one
+// directory's commands never run into a longer directory name.
+std::string HistorySuggest::directoryKey(const std::string& cwd, const std::string& command) {
+    return Frecency::normalizePath(cwd) + '\x1f' + command;
+}
+
+// `text` indexes a stored copy of `key`, or is NO_NODE when the key is only
+// stored if the trie needs a new label from it.
+void HistorySuggest::insert(uint32_t root, const std::string& key, uint32_t text, uint32_t command, uint64_t sequence) {
+    uint32_t node = root;
+    size_t pos = 0;
+    m_nodes[node].newest = command;
+    m_nodes[node].sequence = sequence;
+
+    while (pos < key.size()) {
+        uint32_t previous = NO_NODE;
+        uint32_t child = m_nodes[node].firstChild;
+        while (child != NO_NODE && label(child)[0] != key[pos]) {
+            previous = child;
+            child = m_nodes[child].nextSibling;
+        }
+
+        if (child == NO_NODE) {
+            if (text == NO_NODE) {
+                text = (uint32_t)m_text.size();
+                m_text.push_back(key);
+            }
+            uint32_t leaf = newNode(text, pos, key.size() - pos, command, sequence);
+            m_nodes[leaf].nextSibling = m_nodes[node].firstChild;
+            m_nodes[node].firstChild = leaf;
+            return;
+        }
+
+        std::string_view edge = label(child);
+        size_t common = 1;
+        while (common < edge.size() && pos + common < key.size() && edge[common] == key[pos + common]) {
+            ++common;
+        }
+
+        if (common < edge.size()) {
+            // The key leaves this edge part way: split it, and the new
+            // node in the middle takes over the child's place.
+            Node split = m_nodes[child];
+            uint32_t middle = newNode(split.text, split.offset, common, command, sequence);
+            m_nodes[middle].firstChild = child;
+            m_nodes[middle].nextSibling = split.nextSibling;
+            m_nodes[child].offset += (uint32_t)common;
+            m_nodes[child].length -= (uint32_t)common;
+            m_nodes[child].nextSibling = NO_NODE;
+            if (previous == NO_NODE) {
+                m_nodes[node].firstChild = middle;
+            } else {
+                m_nodes[previous].nextSibling = middle;
+            }
+            child = middle;
+        } else {
+            m_nodes[child].newest = command;
+            m_nodes[child].sequence = sequence;
+        }
+        node = child;
+        pos += common;
+    }
+}
+
+// The node where `prefix` ends, or NO_NODE.
+uint32_t HistorySuggest::lookup(uint32_t root, const std::string& prefix) const {
+    uint32_t node = root;
+    size_t pos = 0;
+    while (pos < prefix.size()) {
+        uint32_t child = m_nodes[node].firstChild;
+        while (child != NO_NODE && label(child)[0] != prefix[pos]) {
+            child = m_nodes[child].nextSibling;
+        }
+        if (child == NO_NODE) return NO_NODE;
+
+        std::string_view edge = label(child);
+        size_t length = std::min(edge.size(), prefix.size() - pos);
+        if (edge.substr(0, length) != std::string_view(prefix).substr(pos, length)) return NO_NODE;
+        node = child;
+        pos += length;
+    }
+    return node;
+}
+
+// The newest command below `node` that is longer than the `typed` bytes
+// that led there. When the newest is exactly what was typed, the longer
+// ones are in the subtrees of its children.
+uint32_t HistorySuggest::newestLonger(uint32_t node, size_t typed) const {
+    if (node == NO_NODE) return NO_NODE;
+    uint32_t command = m_nodes[node].newest;
+    if (command == NO_NODE || m_text[command].size() > typed) return command;
+
+    uint32_t best = NO_NODE;
+    for (uint32_t child = m_nodes[node].firstChild; child != NO_NODE; child = m_nodes[child].nextSibling) {
+        if (best == NO_NODE || m_nodes[child].sequence > m_nodes[best].sequence) {
+            best = child;
+        }
+    }
+    return best == NO_NODE ? NO_NODE : m_nodes[best].newest;
+}
+
+void HistorySuggest::update() {
+    m_store.refresh();
+
+    // Newest first from the store, filed oldest first so each entry is
+    // the newest on its path when it goes in.
+    std::vector<HistoryEntry> fresh;
+    HistoryEntry entry;
+    size_t limit = m_newestSequence == 0 ? SUGGEST_SEED_ENTRIES : SIZE_MAX;
+    while (fresh.size() < limit && m_store.entry(fresh.size(), entry) && entry.sequence > m_newestSequence) {
+        fresh.push_back(std::move(entry));
+    }
+
+    for (auto it = fresh.rbegin(); it != fresh.rend(); ++it) {
+        m_newestSequence = std::max(m_newestSequence, it->sequence);
+        if (it->command.empty()) continue;
+
+        uint32_t command;
+        auto found = m_byHash.find(it->hash);
+        if (found != m_byHash.end()) {
+            command = found->second;
+        } else {
+            command = (uint32_t)m_text.size();
+            m_text.push_back(it->command);
+            m_byHash.emplace(it->hash, command);
+        }
+        insert(COMMAND_ROOT, it->command, command, command, it->sequence);
+        insert(DIRECTORY_ROOT, directoryKey(it->cwd, it->command), NO_NODE, command, it->sequence);
+    }
+}
+
+std::string HistorySuggest::suggest(const std::string& prefix, const std::string& cwd) const {
+    if (prefix.empty()) return std::string();
+
+    uint32_t command = newestLonger(lookup(DIRECTORY_ROOT, directoryKey(cwd, prefix)), prefix.size());
+    if (command == NO_NODE) {
+        command = newestLonger(lookup(COMMAND_ROOT, prefix), prefix.size());
+    }
+    return command == NO_NODE ? std::string() : m_text[command];
+}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "common.hpp"
+#include "history.hpp"
+#include <deque>
+#include <string_view>
+
+namespace WaleedShell {
+
+// Fish-style autosuggestions: the newest history command that starts with
+// what has been typed, preferring commands run in the current directory.
+// Commands are filed in a radix trie, and every node remembers the newest
+// command below it, so a lookup walks the typed prefix and is done: the
+// cost grows with the length of the line, not of the history. A second
+// trie holds the same commands keyed by directory first. Entries arrive
+// in sequence order, so filing one simply makes it the newest on its
+// path. The first update() files the newest entries of the store; later
+// calls file whatever it has gained since.
+class HistorySuggest {
+public:
+    explicit HistorySuggest(HistoryStore& store);
+
+    void update();
+    // The whole suggested command, or empty when nothing longer than
+    // `prefix` starts with it.
+    std::string suggest(const std::string& prefix, const std::string& cwd) const;
+
+private:
+    // A node's label is `length` bytes of m_text[text] from `offset`;
+    // `newest` is the command filed through it last, at `sequence`.
+    struct Node {
+        uint32_t text;
+        uint32_t offset;
+        uint32_t length;
+        uint32_t firstChild;
+        uint32_t nextSibling;
+        uint32_t newest;
+        uint64_t sequence;
+    };
+
+    HistoryStore& m_store;
+    std::deque<std::string> m_text;
+    std::unordered_map<uint64_t, uint32_t> m_byHash;
+    std::vector<Node> m_nodes;
+    uint64_t m_newestSequence;
+
+    std::string_view label(uint32_t node) const;
+    uint32_t newNode(uint32_t text, size_t offset, size_t length, uint32_t command, uint64_t sequence);
+    void insert(uint32_t root, const std::string& key, uint32_t text, uint32_t command, uint64_t sequence);
+    uint32_t lookup(uint32_t root, const std::string& prefix) const;
+    uint32_t newestLonger(uint32_t node, size_t typed) const;
+    static std::string directoryKey(const std::string& cwd, const std::string& command);
+};
+
+}
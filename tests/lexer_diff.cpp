@@ -0,0 +1,89 @@
+// Differential test for Parser::lex: a parser fed a line one random edit
+// at a time, reusing its previous spans, must produce the spans a fresh
+// parser produces for the same line.
+//
+//   lexer_diff [edits] [seed]
+//
+// Exits with 1 and prints the line and both span lists on the first
+// mismatch.
+#include "parser.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace WaleedShell;
+
+// Operators, both quote characters, escapes and blanks, so edits keep
+// opening and closing quotes and splitting and joining operators.
+static const char ALPHABET[] = "ab c|&><;()\"' \tx\\";
+
+static char randomChar(std::mt19937& rng) {
+    return ALPHABET[rng() % (sizeof(ALPHABET) - 1)];
+}
+
+static bool sameSpans(const std::vector<LexSpan>& a, const std::vector<LexSpan>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].kind != b[i].kind || a[i].start != b[i].start || a[i].length != b[i].length ||
+            a[i].quoted != b[i].quoted || a[i].unterminated != b[i].unterminated) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void printSpans(const char* name, const std::vector<LexSpan>& spans) {
+    std::printf("%s:", name);
+    for (const LexSpan& span : spans) {
+        std::printf(" %d@%u+%u%s%s", (int)span.kind, span.start, span.length, span.quoted ? "q" : "",
+                    span.unterminated ? "u" : "");
+    }
+    std::printf("\n");
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long edits = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 300000;
+    unsigned long seed = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 3;
+    std::printf("lexer_diff: %lu edits, seed %lu\n", edits, seed);
+
+    std::mt19937 rng(seed);
+    Parser incremental;
+    std::string line;
+    for (unsigned long i = 0; i < edits; ++i) {
+        // Single keystrokes mostly, with the odd paste, cut and cleared
+        // line; the length is capped so edits land all over the line.
+        size_t at = rng() % (line.size() + 1);
+        switch (rng() % 6) {
+            case 0:
+            case 1:
+            case 2:
+                line.insert(at, 1, randomChar(rng));
+                break;
+            case 3:
+                if (!line.empty()) line.erase(rng() % line.size(), 1 + rng() % 3);
+                break;
+            case 4: {
+                std::string paste;
+                for (size_t n = rng() % 8; n > 0; --n) paste += randomChar(rng);
+                line.insert(at, paste);
+                break;
+            }
+            default:
+                if (rng() % 50 == 0) line.clear();
+                break;
+        }
+        if (line.size() > 80) line.erase(0, 20);
+
+        Parser fresh;
+        const std::vector<LexSpan>& expected = fresh.lex(line);
+        const std::vector<LexSpan>& actual = incremental.lex(line);
+        if (!sameSpans(actual, expected)) {
+            std::printf("mismatch after edit %lu on [%s]\n", i, line.c_str());
+            printSpans("incremental", actual);
+            printSpans("fresh", expected);
+            return 1;
+        }
+    }
+    std::printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,214 @@
+// Parser benchmark: nanoseconds and heap allocations per line for
+// Parser::parse and Parser::parseList, against the parser they replaced
+// (kept below as Legacy, as it was before tokens became string_views).
+//
+//   parser_bench [iterations]
+//
+// Exits with 1 if the two parsers disagree on any of the sample lines.
+#include "parser.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace WaleedShell;
+
+static size_t g_allocations = 0;
+
+void* operator new(size_t size) {
+    ++g_allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace Legacy {
+
+// Appends per character and copies each token twice: into the token list,
+// then into the command.
+static std::vector<std::string> tokenize(const std::string& input) {
+    std::vector<std::string> tokens;
+    std::string current;
+    bool inQuotes = false;
+    char quoteChar = 0;
+
+    for (size_t i = 0; i < input.size(); ++i) {
+        char c = input[i];
+        if (inQuotes) {
+            if (c == quoteChar) {
+                inQuotes = false;
+            } else {
+                current += c;
+            }
+        } else if (c == '"' || c == '\'') {
+            inQuotes = true;
+            quoteChar = c;
+        } else if (c == ' ' || c == '\t') {
+            if (!current.empty()) {
+                tokens.push_back(current);
+                current.clear();
+            }
+        } else if (c == '|' || c == '<') {
+            if (!current.empty()) {
+                tokens.push_back(current);
+                current.clear();
+            }
+            tokens.push_back(std::string(1, c));
+        } else if (c == '>') {
+            if (!current.empty()) {
+                tokens.push_back(current);
+                current.clear();
+            }
+            if (i + 1 < input.size() && input[i + 1] == '>') {
+                tokens.push_back(">>");
+                ++i;
+            } else {
+                tokens.push_back(">");
+            }
+        } else {
+            current += c;
+        }
+    }
+    if (!current.empty()) {
+        tokens.push_back(current);
+    }
+    return tokens;
+}
+
+static Command parseCommand(const std::vector<std::string>& tokens) {
+    Command cmd;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const std::string& token = tokens[i];
+        if (token == "<") {
+            if (i + 1 < tokens.size()) {
+                cmd.inputRedirect.type = RedirectType::Input;
+                cmd.inputRedirect.filename = tokens[++i];
+            }
+        } else if (token == ">") {
+            if (i + 1 < tokens.size()) {
+                cmd.outputRedirect.type = RedirectType::Output;
+                cmd.outputRedirect.filename = tokens[++i];
+            }
+        } else if (token == ">>") {
+            if (i + 1 < tokens.size()) {
+                cmd.outputRedirect.type = RedirectType::Append;
+                cmd.outputRedirect.filename = tokens[++i];
+            }
+        } else if (cmd.program.empty()) {
+            cmd.program = token;
+        } else {
+            cmd.args.push_back(token);
+        }
+    }
+    return cmd;
+}
+
+static Pipeline parse(const std::string& input) {
+    Pipeline pipeline;
+    std::vector<std::string> tokens = tokenize(input);
+    if (tokens.empty()) {
+        pipeline.isValid = false;
+        return pipeline;
+    }
+
+    std::vector<std::string> currentTokens;
+    for (const auto& token : tokens) {
+        if (token == "|") {
+            if (currentTokens.empty()) {
+                pipeline.isValid = false;
+                pipeline.error = "Syntax error: unexpected '|'";
+                return pipeline;
+            }
+            pipeline.commands.push_back(parseCommand(currentTokens));
+            currentTokens.clear();
+        } else {
+            currentTokens.push_back(token);
+        }
+    }
+    if (currentTokens.empty()) {
+        pipeline.isValid = false;
+        pipeline.error = "Syntax error: expected command after '|'";
+        return pipeline;
+    }
+    pipeline.commands.push_back(parseCommand(currentTokens));
+    return pipeline;
+}
+
+}
+
+// Lines of the kind automation feeds through processCommand. None uses
+// the list operators the legacy parser did not know.
+static const char* const SAMPLE_LINES[] = {
+    "ls",
+    "cd C:\\Users\\build\\work",
+    "ps | grep chrome | sort | head -n 5",
+    "git log --oneline -n 20 > C:\\temp\\log.txt",
+    "findstr /s /i \"connection refused\" C:\\logs\\service\\*.log | sort | uniq",
+    "cl /nologo /O2 /EHsc /I include /I src src\\main.cpp src\\parser.cpp /Fe:bin\\app.exe",
+    "type 'C:\\Program Files\\App\\config.ini' | findstr Port >> settings.txt",
+    "netstat | where lport == 443 | first 5",
+};
+
+static bool samePipeline(const Pipeline& a, const Pipeline& b) {
+    if (a.isValid != b.isValid || a.commands.size() != b.commands.size()) return false;
+    for (size_t i = 0; i < a.commands.size(); ++i) {
+        const Command& x = a.commands[i];
+        const Command& y = b.commands[i];
+        if (x.program != y.program || x.args != y.args ||
+            x.inputRedirect.type != y.inputRedirect.type || x.inputRedirect.filename != y.inputRedirect.filename ||
+            x.outputRedirect.type != y.outputRedirect.type || x.outputRedirect.filename != y.outputRedirect.filename) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename ParseLine>
+static void measure(const char* name, unsigned long iterations, ParseLine parseLine) {
+    const size_t lines = sizeof(SAMPLE_LINES) / sizeof(SAMPLE_LINES[0]);
+    std::vector<std::string> inputs(SAMPLE_LINES, SAMPLE_LINES + lines);
+
+    // One untimed pass so the parser's reused buffers are already grown.
+    size_t commands = 0;
+    for (const auto& input : inputs) commands += parseLine(input);
+
+    size_t allocationsBefore = g_allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; ++i) {
+        for (const auto& input : inputs) commands += parseLine(input);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    size_t allocations = g_allocations - allocationsBefore;
+
+    double parsed = (double)iterations * (double)lines;
+    std::printf("%-18s %8.0f ns/line  %6.1f allocations/line  (%zu commands)\n", name,
+                std::chrono::duration<double, std::nano>(elapsed).count() / parsed,
+                (double)allocations / parsed, commands);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+
+    Parser parser;
+    for (const char* line : SAMPLE_LINES) {
+        if (!samePipeline(parser.parse(line), Legacy::parse(line))) {
+            std::printf("parsers disagree on: %s\n", line);
+            return 1;
+        }
+    }
+
+    std::printf("parser_bench: %lu passes over %zu lines\n", iterations,
+                sizeof(SAMPLE_LINES) / sizeof(SAMPLE_LINES[0]));
+    measure("legacy parse", iterations, [](const std::string& line) {
+        return Legacy::parse(line).commands.size();
+    });
+    measure("Parser::parse", iterations, [&parser](const std::string& line) {
+        return parser.parse(line).commands.size();
+    });
+    measure("Parser::parseList", iterations, [&parser](const std::string& line) {
+        return parser.parseList(line).items.size();
+    });
+    return 0;
+}
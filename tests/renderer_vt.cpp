@@ -0,0 +1,390 @@
+// Screen test for LineRenderer: random edits of a GapBuffer are rendered
+// and the bytes played on a small VT screen emulator, which must then
+// show the prompt, the line and the hint in the right colours, nothing
+// past them, and the cursor where the line's cursor is. Covers the
+// rewrite and both shift paths, wrapping at several widths, menu rows and
+// finish().
+//
+//   renderer_vt [trials] [seed]
+//
+// Exits with 1 and prints the screen on the first mismatch.
+#include "renderer.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace WaleedShell;
+
+// SGR foreground and underline of each Ink, as renderer.cpp writes them.
+static const struct { size_t fg; bool underline; } INK_ATTRS[] = {
+    {39, false}, {90, false}, {92, false}, {91, false}, {33, false}, {36, false}, {35, false}, {31, true}
+};
+
+// Cells record their ink as one character: '.' for Default, a digit for
+// the others, '?' for a colour no Ink has.
+static char inkCell(Ink ink) {
+    return ink == Ink::Default ? '.' : (char)('0' + (int)ink);
+}
+
+// A screen `width` columns wide with as many rows as are written to. Only
+// what LineRenderer sends is understood: relative moves, CHA, EL, ED, ICH,
+// DCH and SGR. Like a real console it defers the wrap after the last
+// column until the next character.
+struct Screen {
+    size_t width;
+    std::vector<std::string> text;
+    std::vector<std::string> inks;
+    size_t row = 0;
+    size_t col = 0;
+    bool wrapPending = false;
+    size_t fg = 39;
+    bool underline = false;
+    std::string error;
+
+    explicit Screen(size_t columns) : width(columns) { addRow(); }
+
+    void addRow() {
+        text.push_back(std::string(width, ' '));
+        inks.push_back(std::string(width, '.'));
+    }
+
+    void clear(size_t r, size_t from) {
+        for (size_t c = from; c < width; ++c) {
+            text[r][c] = ' ';
+            inks[r][c] = '.';
+        }
+    }
+
+    char pen() const {
+        for (size_t i = 0; i < sizeof(INK_ATTRS) / sizeof(INK_ATTRS[0]); ++i) {
+            if (INK_ATTRS[i].fg == fg && INK_ATTRS[i].underline == underline) return inkCell((Ink)i);
+        }
+        return '?';
+    }
+
+    bool csi(const std::string& data, size_t& i) {
+        std::vector<size_t> params(1, 0);
+        bool given = false;
+        for (i += 2; i < data.size() && (isdigit((unsigned char)data[i]) || data[i] == ';'); ++i) {
+            if (data[i] == ';') {
+                params.push_back(0);
+            } else {
+                params.back() = params.back() * 10 + (data[i] - '0');
+                given = true;
+            }
+        }
+        if (i == data.size()) return fail("truncated escape sequence");
+
+        char op = data[i];
+        size_t n = given ? params[0] : (op == 'J' || op == 'K' || op == 'm' ? 0 : 1);
+        if (op != 'm') wrapPending = false;
+        switch (op) {
+            case 'A':
+                if (n > row) return fail("cursor moved above the first row");
+                row -= n;
+                break;
+            case 'B':
+                if (row + n >= text.size()) return fail("cursor moved below the last row");
+                row += n;
+                break;
+            case 'C': col = std::min(width - 1, col + n); break;
+            case 'D': col = col > n ? col - n : 0; break;
+            case 'G': col = std::min(width, std::max<size_t>(n, 1)) - 1; break;
+            case 'K': clear(row, col); break;
+            case 'J':
+                clear(row, col);
+                for (size_t r = row + 1; r < text.size(); ++r) clear(r, 0);
+                break;
+            case '@':
+                text[row].insert(col, n, ' ');
+                text[row].resize(width);
+                inks[row].insert(col, n, '.');
+                inks[row].resize(width);
+                break;
+            case 'P':
+                text[row].erase(col, std::min(n, width - col));
+                text[row].resize(width, ' ');
+                inks[row].erase(col, std::min(n, width - col));
+                inks[row].resize(width, '.');
+                break;
+            case 'm':
+                for (size_t value : params) {
+                    if (value == 4) underline = true;
+                    else if (value == 24) underline = false;
+                    else if (value == 39 || (value >= 30 && value <= 37) || (value >= 90 && value <= 97)) fg = value;
+                }
+                break;
+            default:
+                return fail(std::string("unexpected sequence ESC [ ") + op);
+        }
+        return true;
+    }
+
+    bool feed(const std::string& data) {
+        for (size_t i = 0; i < data.size(); ++i) {
+            char c = data[i];
+            if (c == '\x1b') {
+                if (i + 1 >= data.size() || data[i + 1] != '[') return fail("escape without '['");
+                if (!csi(data, i)) return false;
+            } else if (c == '\r') {
+                col = 0;
+                wrapPending = false;
+            } else if (c == '\n') {
+                if (++row == text.size()) addRow();
+                wrapPending = false;
+            } else if (c == '\b') {
+                if (wrapPending) wrapPending = false;
+                else if (col > 0) --col;
+            } else {
+                if (wrapPending) {
+                    if (++row == text.size()) addRow();
+                    col = 0;
+                    wrapPending = false;
+                }
+                text[row][col] = c;
+                inks[row][col] = pen();
+                if (col == width - 1) wrapPending = true;
+                else ++col;
+            }
+        }
+        return true;
+    }
+
+    bool fail(const std::string& what) {
+        error = what;
+        return false;
+    }
+
+    // The first `rows` rows run together.
+    std::string rowsText(size_t rows, const std::vector<std::string>& from) const {
+        std::string all;
+        for (size_t r = 0; r < rows && r < from.size(); ++r) all += from[r];
+        return all;
+    }
+
+    bool blankFrom(size_t first) const {
+        for (size_t r = first; r < text.size(); ++r) {
+            if (text[r] != std::string(width, ' ')) return false;
+        }
+        return true;
+    }
+
+    void print() const {
+        for (size_t r = 0; r < text.size(); ++r) {
+            std::printf("  |%s|  %s%s\n", text[r].c_str(), inks[r].c_str(), r == row ? "  <" : "");
+        }
+        std::printf("  cursor at row %zu column %zu%s\n", row, col, wrapPending ? ", wrap pending" : "");
+    }
+};
+
+// menu() and finish() write straight to the renderer's handle, so it is
+// given a temporary file and take() reads back what was written since the
+// last call.
+class Capture {
+public:
+    Capture() {
+        char dir[MAX_PATH];
+        char path[MAX_PATH];
+        GetTempPathA(MAX_PATH, dir);
+        GetTempFileNameA(dir, "vt", 0, path);
+        m_file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                             FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    }
+    ~Capture() {
+        if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+    }
+    Capture(const Capture&) = delete;
+    Capture& operator=(const Capture&) = delete;
+
+    HANDLE handle() const { return m_file; }
+
+    std::string take() {
+        std::string data;
+        char buffer[4096];
+        DWORD got;
+        SetFilePointer(m_file, 0, NULL, FILE_BEGIN);
+        while (ReadFile(m_file, buffer, sizeof(buffer), &got, NULL) && got > 0) {
+            data.append(buffer, got);
+        }
+        SetFilePointer(m_file, 0, NULL, FILE_BEGIN);
+        SetEndOfFile(m_file);
+        return data;
+    }
+
+private:
+    HANDLE m_file;
+};
+
+static std::string randomText(std::mt19937& rng, size_t length, char first) {
+    std::string text(length, ' ');
+    for (char& c : text) c = (char)(first + rng() % 26);
+    return text;
+}
+
+// Colours the way highlighting would: mostly following the characters, so
+// an edit moves them along with the text, now and then all recoloured.
+static void colour(std::mt19937& rng, const std::string& line, std::vector<Ink>& inks) {
+    if (inks.size() == line.size() && rng() % 4 != 0) return;
+    inks.assign(line.size(), Ink::Default);
+    for (size_t i = 0; i < line.size(); ++i) {
+        if (line[i] % 7 == 0) inks[i] = (Ink)(2 + rng() % 6);
+        else if (line[i] < 'a') inks[i] = Ink::String;
+    }
+}
+
+static bool mismatch(const char* what, size_t width, const Screen& screen) {
+    std::printf("width %zu: %s\n", width, what);
+    if (!screen.error.empty()) std::printf("  %s\n", screen.error.c_str());
+    screen.print();
+    return false;
+}
+
+static bool trial(std::mt19937& rng, size_t width, Capture& capture) {
+    static const std::string PREFIX = "> ";
+    LineRenderer renderer(capture.handle());
+    Screen screen(width);
+    renderer.reset(PREFIX, width, true);
+    screen.feed(PREFIX);
+
+    GapBuffer line;
+    std::string expected;
+    size_t cursor = 0;
+    std::string hint;
+    std::vector<Ink> inks;
+
+    for (int step = 0; step < 600; ++step) {
+        switch (rng() % 8) {
+            case 0:
+            case 1:
+            case 2: {
+                char c = (char)('a' + rng() % 26);
+                line.insert(cursor, c);
+                expected.insert(cursor++, 1, c);
+                break;
+            }
+            case 3:
+                if (cursor == 0) break;
+                line.erase(--cursor, 1);
+                expected.erase(cursor, 1);
+                break;
+            case 4:
+                cursor = rng() % (expected.size() + 1);
+                break;
+            case 5:
+                if (rng() % 10 != 0) break;
+                expected = randomText(rng, rng() % 50, 'a');
+                line.assign(expected);
+                cursor = expected.size();
+                break;
+            case 6:
+                // Deletes and pastes of up to two rows, so shifts cross
+                // row boundaries.
+                if (cursor < expected.size()) {
+                    size_t count = 1 + rng() % std::min(expected.size() - cursor, 2 * width);
+                    line.erase(cursor, count);
+                    expected.erase(cursor, count);
+                } else {
+                    std::string paste = randomText(rng, 1 + rng() % (2 * width), 'A');
+                    line.insert(cursor, paste);
+                    expected.insert(cursor, paste);
+                    cursor += paste.size();
+                }
+                break;
+            default: {
+                if (rng() % 20 != 0) break;
+                std::vector<std::string> rows = {"one", "two", "three"};
+                rows.resize(rng() % 4);
+                renderer.menu(rows, 0);
+                if (!screen.feed(capture.take())) return mismatch("menu() sent bytes the screen rejects", width, screen);
+
+                size_t at = PREFIX.size() + cursor;
+                size_t lastRow = (PREFIX.size() + expected.size() + hint.size()) / width;
+                if (screen.row != at / width || screen.col != at % width) {
+                    return mismatch("menu() moved the cursor off the line", width, screen);
+                }
+                for (size_t r = 0; r < rows.size(); ++r) {
+                    if (screen.text[lastRow + 1 + r].compare(0, rows[r].size(), rows[r]) != 0) {
+                        return mismatch("menu row missing", width, screen);
+                    }
+                }
+                renderer.menu({}, 0);
+                if (!screen.feed(capture.take())) return mismatch("menu() sent bytes the screen rejects", width, screen);
+                if (screen.row != at / width || screen.col != at % width || !screen.blankFrom(lastRow + 1)) {
+                    return mismatch("menu rows not erased", width, screen);
+                }
+                continue;
+            }
+        }
+        if (line.str() != expected) {
+            std::printf("gap buffer holds [%s], expected [%s]\n", line.str().c_str(), expected.c_str());
+            return false;
+        }
+
+        hint.clear();
+        if (cursor == expected.size() && rng() % 2) hint = randomText(rng, rng() % (2 * width), 'a');
+        colour(rng, expected, inks);
+
+        if (!screen.feed(renderer.compose(PREFIX, line, cursor, hint, inks))) {
+            return mismatch("compose() sent bytes the screen rejects", width, screen);
+        }
+
+        std::string shown = PREFIX + expected + hint;
+        size_t rows = shown.size() / width + 1;
+        shown.resize(rows * width, ' ');
+        std::string shownInks(PREFIX.size(), '.');
+        for (Ink ink : inks) shownInks += inkCell(ink);
+        shownInks.append(hint.size(), inkCell(Ink::Hint));
+        shownInks.resize(rows * width, '.');
+
+        size_t at = PREFIX.size() + cursor;
+        if (screen.rowsText(rows, screen.text) != shown || !screen.blankFrom(rows)) {
+            return mismatch("wrong text on screen", width, screen);
+        }
+        if (screen.rowsText(rows, screen.inks) != shownInks) return mismatch("wrong colours on screen", width, screen);
+        if (screen.fg != 39 || screen.underline) return mismatch("colour left switched on", width, screen);
+        if (screen.row != at / width || screen.col != at % width || screen.wrapPending) {
+            return mismatch("cursor in the wrong place", width, screen);
+        }
+    }
+
+    // finish() erases the hint and leaves the cursor at the start of the
+    // row after the line.
+    renderer.finish();
+    if (!screen.feed(capture.take())) return mismatch("finish() sent bytes the screen rejects", width, screen);
+    size_t typed = PREFIX.size() + expected.size();
+    std::string shown = PREFIX + expected;
+    shown.resize((typed / width + 1) * width, ' ');
+    size_t nextRow = typed == 0 ? 1 : (typed - 1) / width + 1;
+    if (screen.rowsText(typed / width + 1, screen.text) != shown || screen.col != 0 || screen.row != nextRow ||
+        screen.wrapPending || !screen.blankFrom(nextRow)) {
+        return mismatch("finish() left the line wrong", width, screen);
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long trials = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+    unsigned long seed = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 7;
+    std::printf("renderer_vt: %lu trials per width, seed %lu\n", trials, seed);
+
+    Capture capture;
+    if (capture.handle() == INVALID_HANDLE_VALUE) {
+        std::printf("cannot create a temporary file\n");
+        return 1;
+    }
+
+    // A width of 10 puts the prompt and hint across several rows; 13 is
+    // odd so wrap points never line up with the edit sizes.
+    const size_t widths[] = {10, 13, 40};
+    std::mt19937 rng(seed);
+    for (size_t width : widths) {
+        for (unsigned long i = 0; i < trials; ++i) {
+            if (!trial(rng, width, capture)) {
+                std::printf("failed in trial %lu\n", i);
+                return 1;
+            }
+        }
+    }
+    std::printf("ok\n");
+    return 0;
+}